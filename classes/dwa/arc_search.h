@@ -0,0 +1,67 @@
+//
+// Fused collision check and scoring of the rollout lattice. Arcs are searched in parallel, each one walked from the robot
+// outwards and cut at its first colliding point, and only the best point of each arc takes part in the reduction
+//
+
+#ifndef DWA_ARC_SEARCH_H
+#define DWA_ARC_SEARCH_H
+
+#include <dwa/rollout.h>
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+class ArcSearch
+{
+    public:
+        struct Best
+        {
+            float cost = std::numeric_limits<float>::max();
+            std::uint32_t index = npos;                 // into the samples
+            bool valid() const                          { return index != npos; };
+        };
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+        // reachable(i) -> bool and cost(i) -> float take a sample index. Both are called concurrently from several threads
+        template <typename Reachable, typename Cost>
+        Best search(const Rollout::Samples &samples, const Reachable &reachable, const Cost &cost)
+        {
+            const std::size_t num_arcs = samples.num_arcs();
+            if (arc_index.size() != num_arcs)
+            {
+                arc_index.resize(num_arcs);
+                std::iota(arc_index.begin(), arc_index.end(), 0u);
+            }
+            reachable_count.resize(num_arcs);
+            return std::transform_reduce(std::execution::par, arc_index.begin(), arc_index.end(), Best{},
+                  [](const Best &a, const Best &b)
+                  {
+                      // ties go to the lower index, so the result does not depend on the scheduling
+                      if (a.cost != b.cost) return a.cost < b.cost ? a : b;
+                      return a.index < b.index ? a : b;
+                  },
+                  [&](std::uint32_t arc)
+                  {
+                      Best best;
+                      const std::uint32_t begin = samples.arc_begin[arc], end = samples.arc_begin[arc + 1];
+                      std::uint32_t i = begin;
+                      for (; i < end and reachable(i); i++)
+                          if (const float c = cost(i); c < best.cost)
+                              best = Best{c, i};
+                      reachable_count[arc] = i - begin;
+                      return best;
+                  });
+        };
+
+        // leading points of each arc that were found reachable in the last search. The rest were not checked
+        const std::vector<std::uint32_t> &reachable_points() const     { return reachable_count; };
+
+    private:
+        std::vector<std::uint32_t> arc_index;
+        std::vector<std::uint32_t> reachable_count;
+};
+
+#endif //DWA_ARC_SEARCH_H
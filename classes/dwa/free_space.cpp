@@ -0,0 +1,55 @@
+//
+// Polar free-space table built from a laser scan
+//
+
+#include "free_space.h"
+#include <algorithm>
+#include <limits>
+
+FreeSpace::FreeSpace(int num_bins) : range2(num_bins, 0.f), covered(num_bins, false)
+{}
+
+int FreeSpace::bin(float angle) const
+{
+    const int num_bins = (int)range2.size();
+    int b = (int)std::floor((angle + M_PI) / (2.0 * M_PI) * num_bins) % num_bins;
+    return b < 0 ? b + num_bins : b;
+}
+
+void FreeSpace::begin_update()
+{
+    std::fill(range2.begin(), range2.end(), std::numeric_limits<float>::max());
+    std::fill(covered.begin(), covered.end(), false);
+}
+
+void FreeSpace::add_edge(float a0, float d0, float a1, float d1)
+{
+    // closest point of the edge to the laser
+    const float x0 = d0 * std::sin(a0), y0 = d0 * std::cos(a0);
+    const float x1 = d1 * std::sin(a1), y1 = d1 * std::cos(a1);
+    const float dx = x1 - x0, dy = y1 - y0;
+    const float len2 = dx * dx + dy * dy;
+    const float u = len2 > 0.f ? std::clamp(-(x0 * dx + y0 * dy) / len2, 0.f, 1.f) : 0.f;
+    const float cx = x0 + u * dx, cy = y0 + u * dy;
+    const float dist2 = cx * cx + cy * cy;
+
+    // bins swept by the edge, going the short way round
+    float delta = std::remainder(a1 - a0, 2.f * (float)M_PI);
+    int b = bin(delta >= 0 ? a0 : a1);
+    const int last = bin(delta >= 0 ? a1 : a0);
+    const int num_bins = (int)range2.size();
+    while (true)
+    {
+        range2[b] = std::min(range2[b], dist2);
+        covered[b] = true;
+        if (b == last) break;
+        b = (b + 1) % num_bins;
+    }
+}
+
+void FreeSpace::end_update(float blind_range)
+{
+    for (std::size_t b = 0; b < range2.size(); b++)
+        if (not covered[b])
+            range2[b] = blind_range * blind_range;
+}
@@ -0,0 +1,45 @@
+//
+// Free space seen in a laser scan, as a polar table of the free range per direction. Built once per scan,
+// it answers whether a point is inside the laser polygon in O(1), without a crossing test against all its edges
+//
+
+#ifndef DWA_FREE_SPACE_H
+#define DWA_FREE_SPACE_H
+
+#include <cmath>
+#include <vector>
+
+class FreeSpace
+{
+    public:
+        explicit FreeSpace(int num_bins = 1024);
+
+        // beams as (angle, dist) in the laser frame, ordered by angle, with x = dist*sin(angle) and y = dist*cos(angle).
+        // Directions that no pair of consecutive beams covers get blind_range
+        template <typename LaserData>
+        void update(const LaserData &ldata, float blind_range = 0.f)
+        {
+            begin_update();
+            for (std::size_t k = 1; k < ldata.size(); k++)
+                add_edge(ldata[k-1].angle, ldata[k-1].dist, ldata[k].angle, ldata[k].dist);
+            end_update(blind_range);
+        };
+
+        // true if (x, y), in the laser frame, is inside the polygon joining the beam ends
+        bool is_free(float x, float y) const
+        {
+            return x * x + y * y < range2[bin(std::atan2(x, y))];
+        };
+        float free_range(float angle) const          { return std::sqrt(range2[bin(angle)]); };
+
+    private:
+        // each bin keeps the distance to the closest polygon edge crossing it, so the table never overestimates
+        std::vector<float> range2;
+        std::vector<bool> covered;
+        int bin(float angle) const;
+        void begin_update();
+        void add_edge(float a0, float d0, float a1, float d1);
+        void end_update(float blind_range);
+};
+
+#endif //DWA_FREE_SPACE_H
@@ -0,0 +1,72 @@
+//
+// Continuous refinement of the dynamic window winner
+//
+
+#include "refine.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+VelocityRefiner::Candidate VelocityRefiner::refine(const Candidate &best, float t, const Rollout::Lattice &lattice,
+                                                   const CostFunction &cost) const
+{
+    if (best.adv <= 0.f or t <= 0.f)
+        return best;
+    const float time = t / best.adv;            // the point moves with (adv, rot) but stays at the same time along its arc
+    const float adv_half = lattice.adv_step() / 2.f, rot_half = lattice.rot_step() / 2.f;
+    const float adv_lo = std::max(best.adv - adv_half, 1.f), adv_hi = std::min(best.adv + adv_half, lattice.max_adv);
+    const float rot_lo = std::max(best.rot - rot_half, -lattice.max_rot), rot_hi = std::min(best.rot + rot_half, lattice.max_rot);
+    if (adv_hi <= adv_lo and rot_hi <= rot_lo)
+        return best;
+
+    // vertices are scaled to the box, so the simplex is not degenerate in one of the axes
+    int evaluations = 0;
+    auto evaluate = [&](float u, float v)
+    {
+        Candidate c;
+        c.adv = std::clamp(best.adv + u * adv_half, adv_lo, adv_hi);
+        c.rot = std::clamp(best.rot + v * rot_half, rot_lo, rot_hi);
+        Rollout::arc_point(c.adv, c.rot, c.adv * time, c.x, c.y, c.ang);
+        c.cost = cost(c.x, c.y, c.adv, c.rot, c.ang);
+        evaluations++;
+        return c;
+    };
+    struct Vertex { float u, v; Candidate c; };
+    auto make_vertex = [&evaluate](float u, float v) { return Vertex{u, v, evaluate(u, v)}; };
+    std::array<Vertex, 3> simplex{Vertex{0.f, 0.f, best}, make_vertex(0.5f, 0.f), make_vertex(0.f, 0.5f)};
+
+    const float u_tol = adv_half > 0.f ? options.adv_tolerance / adv_half : 1.f;
+    const float v_tol = rot_half > 0.f ? options.rot_tolerance / rot_half : 1.f;
+    while (evaluations < options.max_evaluations)
+    {
+        std::ranges::sort(simplex, [](const auto &a, const auto &b){ return a.c.cost < b.c.cost; });
+        const auto &[b, g, w] = simplex;
+        if (std::max(std::fabs(g.u - b.u), std::fabs(w.u - b.u)) < u_tol and
+            std::max(std::fabs(g.v - b.v), std::fabs(w.v - b.v)) < v_tol)
+            break;
+        const float cu = (b.u + g.u) / 2.f, cv = (b.v + g.v) / 2.f;   // centroid of the two best
+        const auto r = make_vertex(2.f * cu - w.u, 2.f * cv - w.v);
+        if (r.c.cost < b.c.cost)
+        {
+            const auto e = make_vertex(3.f * cu - 2.f * w.u, 3.f * cv - 2.f * w.v);
+            simplex[2] = e.c.cost < r.c.cost ? e : r;
+        }
+        else if (r.c.cost < g.c.cost)
+            simplex[2] = r;
+        else
+        {
+            // contraction towards the better of r and w, or shrink towards the best
+            const auto &o = r.c.cost < w.c.cost ? r : w;
+            const auto k = make_vertex((cu + o.u) / 2.f, (cv + o.v) / 2.f);
+            if (k.c.cost < o.c.cost)
+                simplex[2] = k;
+            else
+            {
+                simplex[1] = make_vertex((b.u + g.u) / 2.f, (b.v + g.v) / 2.f);
+                simplex[2] = make_vertex((b.u + w.u) / 2.f, (b.v + w.v) / 2.f);
+            }
+        }
+    }
+    const auto &winner = std::ranges::min(simplex, [](const auto &a, const auto &b){ return a.c.cost < b.c.cost; });
+    return winner.c.cost < best.cost ? winner.c : best;
+}
@@ -0,0 +1,40 @@
+//
+// Continuous refinement of the dynamic window winner. A Nelder-Mead search over (adv, rot) inside the lattice cell of
+// the best sample, keeping the time along the arc of that sample. It only moves to points that improve the cost,
+// so the result is never worse than the lattice winner
+//
+
+#ifndef DWA_REFINE_H
+#define DWA_REFINE_H
+
+#include <dwa/rollout.h>
+#include <functional>
+
+class VelocityRefiner
+{
+    public:
+        struct Candidate
+        {
+            float x, y, adv, rot, ang;                  // same convention as the rollout samples
+            float cost;
+        };
+        // cost of reaching (x, y, ang) with (adv, rot). It must return infinity for points that are not reachable
+        using CostFunction = std::function<float(float x, float y, float adv, float rot, float ang)>;
+        struct Options
+        {
+            int max_evaluations = 30;
+            float adv_tolerance = 5;                    // mm/s, size of the final simplex
+            float rot_tolerance = 0.01;                 // rad/s
+        };
+
+        VelocityRefiner() = default;
+        explicit VelocityRefiner(const Options &options_) : options(options_) {};
+
+        // best is the lattice winner and t its arc length. The search box is half a lattice step around it, within the limits
+        Candidate refine(const Candidate &best, float t, const Rollout::Lattice &lattice, const CostFunction &cost) const;
+
+    private:
+        Options options;
+};
+
+#endif //DWA_REFINE_H
@@ -0,0 +1,113 @@
+//
+// Batched trajectory rollout for the dynamic window controllers
+//
+
+#include "rollout.h"
+#include <cmath>
+
+namespace
+{
+    // branch free sin and cos, error below 1e-7 rad. Unlike std::sin/cos it lets the compiler vectorize the loops using it
+    inline void fast_sincos(float a, float &s, float &c)
+    {
+        const float q = std::nearbyint(a * 0.63661977236f);                 // quadrant, a = q*pi/2 + r
+        const float r = (a - q * 1.5707963705f) + q * 4.3711390e-8f;
+        const float r2 = r * r;
+        const float ps = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+        const float pc = 1.f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+        const int qi = (int)q;
+        const float ss = (qi & 1) ? pc : ps;
+        const float cc = (qi & 1) ? ps : pc;
+        s = (qi & 2) ? -ss : ss;
+        c = ((qi + 1) & 2) ? -cc : cc;
+    }
+    // end point of an arc of length t that turns ang radians. Written with the half angle,
+    // x = 2t sin²(a/2)/a and y = 2t sin(a/2)cos(a/2)/a, so it has no cancellation and tends to (0, t) when a -> 0
+    inline void chord(float t, float ang, float &x, float &y)
+    {
+        float sh, ch;
+        fast_sincos(0.5f * ang, sh, ch);
+        const float k = std::fabs(ang) > 1e-6f ? sh / ang : 0.5f;
+        x = 2.f * t * sh * k;
+        y = 2.f * t * ch * k;
+    }
+}
+
+const Rollout::Samples &Rollout::compute(float current_adv, float current_rot)
+{
+    // arcs of the lattice and their number of points, so the buffers are sized once
+    arcs.clear();
+    std::size_t total = 0;
+    const float adv_step = lattice.adv_step();
+    const float rot_step = lattice.rot_step();
+    for (int i = 0; i < lattice.adv_samples; i++)
+    {
+        const float new_adv = current_adv + lattice.adv_min + i * adv_step;
+        if (std::fabs(new_adv) > lattice.max_adv)
+            continue;
+        for (int j = 0; j < lattice.rot_samples; j++)
+        {
+            const float new_rot = -current_rot + lattice.rot_min + j * rot_step;
+            if (std::fabs(new_rot) > lattice.max_rot)
+                continue;
+            const float length = new_adv * lattice.time_ahead;    // points at step, 2*step, ... below length
+            const auto n = length > lattice.step_along_arc ? (std::uint32_t)(std::ceil(length / lattice.step_along_arc) - 1) : 0u;
+            arcs.push_back(Arc{new_adv, new_rot, n});
+            total += n;
+        }
+    }
+    samples.x.resize(total); samples.y.resize(total);
+    samples.adv.resize(total); samples.rot.resize(total); samples.ang.resize(total);
+    samples.t.resize(total);
+
+    // parameters of every point
+    std::size_t p = 0;
+    for (const auto &arc : arcs)
+        for (std::uint32_t k = 1; k <= arc.num_points; k++, p++)
+        {
+            const float t = k * lattice.step_along_arc;
+            samples.t[p] = t;
+            samples.adv[p] = arc.adv;
+            samples.rot[p] = arc.rot;
+            samples.ang[p] = t * arc.rot / arc.adv;     // adv > 0 for arcs with points
+        }
+
+    // coordinates, vectorized
+    {
+        const float *__restrict t = samples.t.data();
+        const float *__restrict ang = samples.ang.data();
+        float *__restrict x = samples.x.data();
+        float *__restrict y = samples.y.data();
+        for (std::size_t i = 0; i < total; i++)
+            chord(t[i], ang[i], x[i], y[i]);
+    }
+
+    // drop the points inside the robot, keeping the arcs contiguous
+    const float min_dist2 = lattice.min_distance * lattice.min_distance;
+    samples.arc_begin.clear();
+    std::size_t out = 0;
+    p = 0;
+    for (const auto &arc : arcs)
+    {
+        samples.arc_begin.push_back(out);
+        for (std::uint32_t k = 0; k < arc.num_points; k++, p++)
+            if (samples.x[p] * samples.x[p] + samples.y[p] * samples.y[p] > min_dist2)
+            {
+                samples.x[out] = samples.x[p]; samples.y[out] = samples.y[p];
+                samples.adv[out] = samples.adv[p]; samples.rot[out] = samples.rot[p]; samples.ang[out] = samples.ang[p];
+                samples.t[out] = samples.t[p];
+                out++;
+            }
+    }
+    samples.arc_begin.push_back(out);
+    samples.x.resize(out); samples.y.resize(out);
+    samples.adv.resize(out); samples.rot.resize(out); samples.ang.resize(out);
+    samples.t.resize(out);
+    return samples;
+}
+
+void Rollout::arc_point(float adv, float rot, float t, float &x, float &y, float &ang)
+{
+    ang = adv != 0.f ? t * rot / adv : 0.f;
+    chord(t, ang, x, y);
+}
@@ -0,0 +1,61 @@
+//
+// Batched trajectory rollout for the dynamic window controllers (local_grid and dwa-cpp).
+// Every (v, w, t) point of the velocity lattice is generated in one go, in structure-of-arrays form,
+// into buffers that keep their capacity from one cycle to the next
+//
+
+#ifndef DWA_ROLLOUT_H
+#define DWA_ROLLOUT_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+class Rollout
+{
+    public:
+        // velocity lattice around the current velocities and sampling along each arc
+        struct Lattice
+        {
+            float adv_min = -100, adv_max = 800;        // increments over the current advance speed, mm/s
+            int adv_samples = 10;
+            float rot_min = -2, rot_max = 2;            // increments over the current rotation speed, rad/s
+            int rot_samples = 21;
+            float max_adv = std::numeric_limits<float>::max();  // candidates beyond these are skipped
+            float max_rot = std::numeric_limits<float>::max();
+            float step_along_arc = 200;                 // mm
+            float time_ahead = 1.4;                     // s
+            float min_distance = 400;                   // points closer than this to the robot are dropped
+            float adv_step() const                      { return adv_samples > 1 ? (adv_max - adv_min) / (adv_samples - 1) : 0.f; };
+            float rot_step() const                      { return rot_samples > 1 ? (rot_max - rot_min) / (rot_samples - 1) : 0.f; };
+        };
+
+        // one entry per point, in robot coordinates. Points of an arc are contiguous and ordered along it
+        struct Samples
+        {
+            std::vector<float> x, y, adv, rot, ang;
+            std::vector<float> t;                       // arc length of the point
+            std::vector<std::uint32_t> arc_begin;       // first point of each arc, plus one past the last point
+            std::size_t size() const                    { return x.size(); };
+            std::size_t num_arcs() const                { return arc_begin.empty() ? 0 : arc_begin.size() - 1; };
+        };
+
+        Rollout() = default;
+        explicit Rollout(const Lattice &lattice_) : lattice(lattice_) {};
+        void set_lattice(const Lattice &lattice_)       { lattice = lattice_; };
+        const Lattice &get_lattice() const              { return lattice; };
+
+        // the returned reference is valid until the next call
+        const Samples &compute(float current_adv, float current_rot);
+
+        // single point at arc length t on the arc of (adv, rot). Same convention as the lattice points
+        static void arc_point(float adv, float rot, float t, float &x, float &y, float &ang);
+
+    private:
+        struct Arc { float adv, rot; std::uint32_t num_points; };
+        Lattice lattice;
+        Samples samples;
+        std::vector<Arc> arcs;
+};
+
+#endif //DWA_ROLLOUT_H
@@ -0,0 +1,114 @@
+//
+// Batched circles and segments for the component viewers
+//
+
+#include "scene_items.h"
+#include <QPainter>
+#include <algorithm>
+
+PointsItem::PointsItem(QGraphicsItem *parent) : QGraphicsItem(parent)
+{
+    setAcceptedMouseButtons(Qt::NoButton);      // clicks go to the scene, e.g. to set a target
+}
+
+void PointsItem::set_style(qreal diameter, const QPen &pen_, const QBrush &brush_)
+{
+    radius = diameter / 2;
+    pen = pen_;
+    brush = brush_;
+    update_bounds();
+}
+
+void PointsItem::set_points(const std::vector<QPointF> &centers_)
+{
+    centers = centers_;
+    radii.clear();
+    update_bounds();
+}
+
+void PointsItem::set_circles(const std::vector<QPointF> &centers_, const std::vector<qreal> &radii_)
+{
+    centers = centers_;
+    radii = radii_;
+    radii.resize(centers.size(), radius);
+    update_bounds();
+}
+
+void PointsItem::update_bounds()
+{
+    QRectF b;
+    if (not centers.empty())
+    {
+        qreal x0 = centers[0].x(), x1 = x0, y0 = centers[0].y(), y1 = y0;
+        for (std::size_t i = 0; i < centers.size(); i++)
+        {
+            const qreal r = radii.empty() ? radius : radii[i];
+            x0 = std::min(x0, centers[i].x() - r); x1 = std::max(x1, centers[i].x() + r);
+            y0 = std::min(y0, centers[i].y() - r); y1 = std::max(y1, centers[i].y() + r);
+        }
+        const qreal m = pen.widthF() / 2;
+        b = QRectF(QPointF(x0 - m, y0 - m), QPointF(x1 + m, y1 + m));
+    }
+    if (b != bounds)
+    {
+        prepareGeometryChange();
+        bounds = b;
+    }
+    update();
+}
+
+void PointsItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
+{
+    painter->setPen(pen);
+    painter->setBrush(brush);
+    for (std::size_t i = 0; i < centers.size(); i++)
+    {
+        const qreal r = radii.empty() ? radius : radii[i];
+        painter->drawEllipse(centers[i], r, r);
+    }
+}
+
+LinesItem::LinesItem(QGraphicsItem *parent) : QGraphicsItem(parent)
+{
+    setAcceptedMouseButtons(Qt::NoButton);
+}
+
+void LinesItem::set_pen(const QPen &pen_)
+{
+    pen = pen_;
+    update_bounds();
+}
+
+void LinesItem::set_lines(const std::vector<QLineF> &lines_)
+{
+    lines = lines_;
+    update_bounds();
+}
+
+void LinesItem::update_bounds()
+{
+    QRectF b;
+    if (not lines.empty())
+    {
+        qreal x0 = lines[0].x1(), x1 = x0, y0 = lines[0].y1(), y1 = y0;
+        for (const auto &l : lines)
+        {
+            x0 = std::min({x0, l.x1(), l.x2()}); x1 = std::max({x1, l.x1(), l.x2()});
+            y0 = std::min({y0, l.y1(), l.y2()}); y1 = std::max({y1, l.y1(), l.y2()});
+        }
+        const qreal m = pen.widthF() / 2;
+        b = QRectF(QPointF(x0 - m, y0 - m), QPointF(x1 + m, y1 + m));
+    }
+    if (b != bounds)
+    {
+        prepareGeometryChange();
+        bounds = b;
+    }
+    update();
+}
+
+void LinesItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
+{
+    painter->setPen(pen);
+    painter->drawLines(lines.data(), (int)lines.size());
+}
@@ -0,0 +1,123 @@
+//
+// Retained drawing for the component viewers. Items are created once and updated in place every cycle instead of being
+// removed from the scene, which never deleted them, and added again. ItemPool keeps the items of one layer, e.g. the
+// partition polygons, and hides those not used in a cycle. PointsItem and LinesItem draw a whole set of circles or
+// segments as a single item with one paint call, so a path of a hundred points is one item of the scene index, not a
+// hundred. All of them belong to the scene, which deletes them. Only for the GUI thread
+//
+
+#ifndef GRAPHICS_SCENE_ITEMS_H
+#define GRAPHICS_SCENE_ITEMS_H
+
+#include <QBrush>
+#include <QGraphicsItem>
+#include <QGraphicsScene>
+#include <QLineF>
+#include <QPen>
+#include <QPointF>
+#include <functional>
+#include <vector>
+
+// items of one type reused from cycle to cycle, in the z order of the layer
+template <typename Item>
+class ItemPool
+{
+    public:
+        using Init = std::function<void(Item *)>;
+
+        // init is called once for each new item, e.g. to set its pen, brush or opacity
+        explicit ItemPool(qreal z = 0, Init init_ = {}) : z_value(z), init(std::move(init_)) {};
+
+        // starts a cycle: every item becomes free. The scene is the one of the first call
+        void begin(QGraphicsScene *scene_)
+        {
+            if (scene == nullptr)
+                scene = scene_;
+            used = 0;
+        };
+        // a free item, visible. New items are only created when all of them are in use
+        Item *next()
+        {
+            if (used == items.size())
+            {
+                auto item = new Item();
+                item->setZValue(z_value);
+                if (init)
+                    init(item);
+                scene->addItem(item);
+                items.push_back(item);
+            }
+            auto item = items[used++];
+            item->setVisible(true);
+            return item;
+        };
+        // ends a cycle hiding the items that were not used
+        void end()
+        {
+            for (std::size_t i = used; i < items.size(); i++)
+                items[i]->setVisible(false);
+        };
+        // a layer with a single item: begin, next and end
+        Item *one(QGraphicsScene *scene_)
+        {
+            begin(scene_);
+            auto item = next();
+            end();
+            return item;
+        };
+        void hide(QGraphicsScene *scene_)      { begin(scene_); end(); };
+        std::size_t size() const                { return used; };
+
+    private:
+        QGraphicsScene *scene = nullptr;
+        std::vector<Item *> items;
+        std::size_t used = 0;
+        qreal z_value;
+        Init init;
+};
+
+// circles of the same style, all in one item. Coordinates are those of the item parent, the scene if it has none
+class PointsItem : public QGraphicsItem
+{
+    public:
+        PointsItem(QGraphicsItem *parent = nullptr);
+        void set_style(qreal diameter, const QPen &pen, const QBrush &brush);
+        // circles of the style diameter
+        void set_points(const std::vector<QPointF> &centers);
+        // circles of different radii
+        void set_circles(const std::vector<QPointF> &centers, const std::vector<qreal> &radii);
+        std::size_t size() const                { return centers.size(); };
+
+        QRectF boundingRect() const override    { return bounds; };
+        void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+    private:
+        std::vector<QPointF> centers;
+        std::vector<qreal> radii;               // empty for the style diameter
+        qreal radius = 50;
+        QPen pen;
+        QBrush brush;
+        QRectF bounds;
+        void update_bounds();
+};
+
+// segments of the same pen, all in one item
+class LinesItem : public QGraphicsItem
+{
+    public:
+        LinesItem(QGraphicsItem *parent = nullptr);
+        void set_pen(const QPen &pen);
+        void set_lines(const std::vector<QLineF> &lines);
+        std::size_t size() const                { return lines.size(); };
+
+        QRectF boundingRect() const override    { return bounds; };
+        void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+    private:
+        std::vector<QLineF> lines;
+        QPen pen;
+        QRectF bounds;
+        void update_bounds();
+};
+
+#endif //GRAPHICS_SCENE_ITEMS_H
@@ -0,0 +1,46 @@
+//
+// Lock-free hand over of snapshots from the control loop to the viewer. The producer fills back() and publishes it; the
+// consumer fetches the last published one and reads it from front() for as long as it wants, while the producer keeps
+// writing the third slot. Neither side waits for the other and frames the consumer had no time to fetch are overwritten,
+// so a slow viewer drops frames instead of slowing the loop. Slots are reused, so the vectors of a frame keep their
+// capacity from cycle to cycle. One producer and one consumer, which may live in different threads
+//
+
+#ifndef GRAPHICS_TRIPLE_BUFFER_H
+#define GRAPHICS_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+template <typename Frame>
+class TripleBuffer
+{
+    public:
+        // producer side: the slot to fill, and its hand over as the newest frame
+        Frame &back()                           { return slots[back_index]; };
+        void publish()
+        {
+            back_index = shared.exchange(back_index | FRESH, std::memory_order_acq_rel) & INDEX;
+        };
+
+        // consumer side: true if a new frame was published since the last fetch, which is then in front()
+        bool fetch()
+        {
+            if((shared.load(std::memory_order_relaxed) & FRESH) == 0)
+                return false;
+            front_index = shared.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+            return true;
+        };
+        const Frame &front() const              { return slots[front_index]; };
+
+    private:
+        static constexpr std::uint8_t INDEX = 0x3;
+        static constexpr std::uint8_t FRESH = 0x4;      // set by publish, cleared by fetch
+        std::array<Frame, 3> slots;
+        std::atomic<std::uint8_t> shared{1};            // slot in between, and whether it holds a frame not yet fetched
+        std::uint8_t back_index = 0;                    // only touched by the producer
+        std::uint8_t front_index = 2;                   // only touched by the consumer
+};
+
+#endif //GRAPHICS_TRIPLE_BUFFER_H
@@ -0,0 +1,141 @@
+//
+// In-place laser filtering in a single pass over the scan. On the polar beams: range gating, and median based outlier
+// rejection (or a plain median filter). On the contour built from them: spike removal by the cosine of the angle at
+// each vertex. Nothing is allocated and each stage is linear in the number of beams
+//
+
+#ifndef LASER_FILTER_H
+#define LASER_FILTER_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+class LaserFilter
+{
+    public:
+        // beams out of [min_range, max_range] are dropped, or take the range of the previous valid beam (the crossed limit
+        // if there is none yet)
+        enum class Gate {DROP, HOLD};
+        struct Options
+        {
+            float min_range = 0.f, max_range = 1e9f;            // mm
+            Gate gate = Gate::DROP;
+            int median_window = 0;                              // odd, up to MAX_WINDOW. 0 or 1 disables the median stage
+            float outlier_threshold = 0.f;                      // mm from the window median to be an outlier. 0 filters every beam
+            float max_spiking_angle = 0.f;                      // rad. Vertices with a sharper angle are removed. 0 disables it
+        };
+        struct Stats { std::size_t gated = 0, replaced = 0, spikes = 0; };
+        static constexpr int MAX_WINDOW = 9;
+
+        LaserFilter() = default;
+        explicit LaserFilter(const Options &options_) : options(options_) {};
+        void set_options(const Options &options_)           { options = options_; };
+        const Options &get_options() const                  { return options; };
+        const Stats &get_stats() const                      { return stats; };
+
+        // beams with .dist and .angle, e.g. RoboCompLaser::TLaserData. Beams at both ends that do not fill a window
+        // are only gated
+        template <typename LaserData>
+        void filter_beams(LaserData &ldata)
+        {
+            using Beam = typename LaserData::value_type;
+            stats.gated = stats.replaced = 0;
+            const int window = options.median_window > 1 ? std::min(options.median_window | 1, MAX_WINDOW) : 1;
+            const int half = window / 2;
+            std::array<Beam, MAX_WINDOW> ring;                  // last gated beams, the window is centered on the oldest half
+            std::array<float, MAX_WINDOW> sorted;
+            std::size_t read = 0, written = 0, count = 0;
+            bool has_valid = false;
+            float last_valid = 0.f;
+            for (; read < ldata.size(); read++)
+            {
+                Beam beam = ldata[read];
+                if (beam.dist < options.min_range or beam.dist > options.max_range)
+                {
+                    stats.gated++;
+                    if (options.gate == Gate::DROP)
+                        continue;
+                    beam.dist = has_valid ? last_valid : std::clamp(beam.dist, options.min_range, options.max_range);
+                }
+                else
+                {
+                    has_valid = true;
+                    last_valid = beam.dist;
+                }
+                ring[count % window] = beam;
+                count++;
+                if (window == 1)
+                    ldata[written++] = beam;
+                else if (count < (std::size_t)window)
+                {
+                    if (count <= (std::size_t)half)             // leading beams without a full window
+                        ldata[written++] = beam;
+                }
+                else
+                {
+                    for (int k = 0; k < window; k++)
+                        sorted[k] = ring[k].dist;
+                    std::nth_element(sorted.begin(), sorted.begin() + half, sorted.begin() + window);
+                    const float median = sorted[half];
+                    Beam center = ring[(count - 1 - half) % window];
+                    if (options.outlier_threshold <= 0.f or std::fabs(center.dist - median) > options.outlier_threshold)
+                    {
+                        if (center.dist != median) stats.replaced++;
+                        center.dist = median;
+                    }
+                    ldata[written++] = center;
+                }
+            }
+            // trailing beams without a full window
+            if (window > 1)
+            {
+                const std::size_t first = count >= (std::size_t)window ? count - half : std::min(count, (std::size_t)half);
+                for (std::size_t c = first; c < count; c++)
+                    ldata[written++] = ring[c % window];
+            }
+            ldata.resize(written);
+        };
+
+        // vertices with .x() and .y(), e.g. QPolygonF or std::vector<Eigen::Vector2f>. Every vertex is tested against
+        // its original neighbours, so removing one spike does not create or hide another
+        template <typename Polygon>
+        void remove_spikes(Polygon &poly)
+        {
+            stats.spikes = 0;
+            if (options.max_spiking_angle <= 0.f or poly.size() < 3)
+                return;
+            // angle < max  <=>  cos > cos(max)  <=>  a.b > cos(max) |a| |b|, squared when both sides are positive
+            const float c = std::cos(options.max_spiking_angle);
+            const float c2 = c * c;
+            auto spike = [c, c2](float ax, float ay, float bx, float by)
+            {
+                const float dot = ax * bx + ay * by;
+                const float norms2 = (ax * ax + ay * ay) * (bx * bx + by * by);
+                if (norms2 == 0.f) return false;
+                if (c >= 0.f) return dot > 0.f and dot * dot > c2 * norms2;
+                return dot > 0.f or dot * dot < c2 * norms2;
+            };
+            auto prev = poly[0], curr = poly[1];
+            std::size_t written = 1;
+            for (std::size_t i = 1; i + 1 < (std::size_t)poly.size(); i++)
+            {
+                const auto next = poly[i + 1];
+                if (spike(prev.x() - curr.x(), prev.y() - curr.y(), next.x() - curr.x(), next.y() - curr.y()))
+                    stats.spikes++;
+                else
+                    poly[written++] = curr;
+                prev = curr;
+                curr = next;
+            }
+            poly[written++] = curr;
+            poly.resize(written);
+        };
+
+    private:
+        Options options;
+        Stats stats;
+};
+
+#endif //LASER_FILTER_H
@@ -0,0 +1,161 @@
+//
+// Benchmark of LaserFilter::remove_spikes against the acos + remove_if filter it replaces in comp-one read_laser,
+// and cost of the polar stage, gating plus median outlier rejection.
+// Scans are read from a text file with one scan per line, as "angle dist angle dist ...", or synthesized when no file
+// is given.
+//
+//   g++ -std=c++20 -O2 -I.. filter_benchmark.cpp -o filter_benchmark
+//   ./filter_benchmark [scans.txt] [repetitions]
+//
+
+#include "filter.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Beam { float angle, dist; };
+using Scan = std::vector<Beam>;
+struct Point
+{
+    float px, py;
+    float x() const { return px; };
+    float y() const { return py; };
+    bool operator==(const Point &p) const { return px == p.px and py == p.py; };
+};
+using Polygon = std::vector<Point>;
+
+std::vector<Scan> read_scans(const std::string &file)
+{
+    std::vector<Scan> scans;
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream s(line);
+        Scan scan;
+        Beam b;
+        while (s >> b.angle >> b.dist)
+            scan.push_back(b);
+        if (not scan.empty())
+            scans.push_back(std::move(scan));
+    }
+    return scans;
+}
+
+// rectangular room seen from random poses, with gaussian noise and a few isolated spikes
+std::vector<Scan> synthesize_scans(std::size_t num_scans, std::size_t beams)
+{
+    std::mt19937 mt(1);
+    std::normal_distribution<float> noise(0.f, 10.f);
+    std::uniform_real_distribution<float> pos(-1500.f, 1500.f);
+    std::uniform_int_distribution<std::size_t> beam(0, beams - 1);
+    std::vector<Scan> scans(num_scans);
+    for (auto &scan : scans)
+    {
+        const float x0 = pos(mt), y0 = pos(mt);
+        scan.resize(beams);
+        for (std::size_t i = 0; i < beams; i++)
+        {
+            const float a = -2.f + 4.f * i / (beams - 1);
+            const float s = std::sin(a), c = std::cos(a);
+            float d = 1e9f;
+            if (s > 0) d = std::min(d, (2500.f - x0) / s);
+            if (s < 0) d = std::min(d, (-2500.f - x0) / s);
+            if (c > 0) d = std::min(d, (2500.f - y0) / c);
+            if (c < 0) d = std::min(d, (-2500.f - y0) / c);
+            scan[i] = Beam{a, d + noise(mt)};
+        }
+        for (int k = 0; k < 10; k++)
+            scan[beam(mt)].dist *= 0.3f;
+    }
+    return scans;
+}
+
+Polygon to_polygon(const Scan &scan)
+{
+    Polygon poly(scan.size());
+    for (std::size_t i = 0; i < scan.size(); i++)
+        poly[i] = Point{scan[i].dist * std::sin(scan[i].angle), scan[i].dist * std::cos(scan[i].angle)};
+    return poly;
+}
+
+// the filter as it was in comp-one read_laser
+void remove_spikes_acos(Polygon &poly, float max_angle)
+{
+    std::vector<Point> removed;
+    for (std::size_t i = 1; i + 1 < poly.size(); i++)
+    {
+        float ax = poly[i-1].px - poly[i].px, ay = poly[i-1].py - poly[i].py;
+        float bx = poly[i+1].px - poly[i].px, by = poly[i+1].py - poly[i].py;
+        const float na = std::hypot(ax, ay), nb = std::hypot(bx, by);
+        if (na > 0) { ax /= na; ay /= na; }
+        if (nb > 0) { bx /= nb; by /= nb; }
+        if (max_angle > std::acos(ax * bx + ay * by))
+            removed.push_back(poly[i]);
+    }
+    for (const auto &r : removed)
+        poly.erase(std::remove_if(poly.begin(), poly.end(), [r](const auto &p) { return p == r; }), poly.end());
+}
+
+int main(int argc, char *argv[])
+{
+    const auto scans = argc > 1 ? read_scans(argv[1]) : synthesize_scans(200, 720);
+    const int repetitions = argc > 2 ? std::stoi(argv[2]) : 20;
+    if (scans.empty())
+    {
+        std::cout << "No scans read" << std::endl;
+        return 1;
+    }
+    std::vector<Polygon> polygons;
+    for (const auto &s : scans)
+        polygons.push_back(to_polygon(s));
+
+    const float max_angle = 0.2f;   // comp-one MAX_SPIKING_ANGLE_rads
+    LaserFilter filter(LaserFilter::Options{.max_spiking_angle = max_angle});
+    std::size_t removed_old = 0, removed_new = 0, different = 0;
+    double time_old = 0, time_new = 0;
+    using clock = std::chrono::steady_clock;
+    for (int r = 0; r < repetitions; r++)
+        for (const auto &p : polygons)
+        {
+            Polygon a = p, b = p;
+            auto t0 = clock::now();
+            remove_spikes_acos(a, max_angle);
+            auto t1 = clock::now();
+            filter.remove_spikes(b);
+            auto t2 = clock::now();
+            time_old += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            time_new += std::chrono::duration<double, std::micro>(t2 - t1).count();
+            if (r == 0)
+            {
+                removed_old += p.size() - a.size();
+                removed_new += p.size() - b.size();
+                different += a != b;
+            }
+        }
+    const double calls = (double)repetitions * polygons.size();
+    std::cout << scans.size() << " scans, " << polygons.front().size() << " beams in the first one" << std::endl;
+    std::cout << "acos + remove_if: " << time_old / calls << " us/scan, " << removed_old << " points removed" << std::endl;
+    std::cout << "LaserFilter:      " << time_new / calls << " us/scan, " << removed_new << " points removed" << std::endl;
+    std::cout << "scans with a different result: " << different << std::endl;
+
+    LaserFilter beams_filter(LaserFilter::Options{.min_range = 50, .max_range = 10000, .median_window = 5, .outlier_threshold = 200});
+    double time_beams = 0;
+    std::size_t replaced = 0;
+    for (int r = 0; r < repetitions; r++)
+        for (const auto &s : scans)
+        {
+            Scan scan = s;
+            auto t0 = clock::now();
+            beams_filter.filter_beams(scan);
+            time_beams += std::chrono::duration<double, std::micro>(clock::now() - t0).count();
+            if (r == 0) replaced += beams_filter.get_stats().replaced;
+        }
+    std::cout << "gating + median 5: " << time_beams / calls << " us/scan, " << replaced << " outliers replaced" << std::endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+//
+// Openings in a laser scan, tracked across scans
+//
+
+#include "gaps.h"
+#include <algorithm>
+
+void GapDetector::track()
+{
+    // both lists are sorted by angle. Each new opening takes the id of the closest previous one within the window,
+    // scanning forward from where the last match left off, so every previous opening is looked at a bounded number of times
+    std::ranges::sort(current, {}, &Gap::angle);
+    std::size_t first = 0;
+    taken.assign(gaps.size(), 0);
+    for (auto &g : current)
+    {
+        while (first < gaps.size() and gaps[first].angle < g.angle - options.match_angle)
+            first++;
+        std::size_t best = gaps.size();
+        float best_dist = options.match_distance;
+        for (std::size_t j = first; j < gaps.size() and gaps[j].angle <= g.angle + options.match_angle; j++)
+            if (const float d = (gaps[j].center - g.center).norm(); not taken[j] and d <= best_dist)
+            {
+                best = j;
+                best_dist = d;
+            }
+        if (best < gaps.size())
+        {
+            taken[best] = 1;
+            g.id = gaps[best].id;
+            g.age = gaps[best].age + 1;
+        }
+        else
+            g.id = next_id++;
+    }
+    std::swap(gaps, current);
+    if (selected.has_value() and not find(selected.value()).has_value())
+        selected.reset();
+}
+
+std::optional<GapDetector::Gap> GapDetector::find(std::uint32_t id) const
+{
+    if (auto it = std::ranges::find(gaps, id, &Gap::id); it != gaps.end())
+        return *it;
+    return {};
+}
+
+std::optional<GapDetector::Gap> GapDetector::nearest(const Eigen::Vector2f &point) const
+{
+    if (gaps.empty())
+        return {};
+    return *std::ranges::min_element(gaps, [point](const auto &a, const auto &b)
+                { return (a.center - point).squaredNorm() < (b.center - point).squaredNorm(); });
+}
+
+std::optional<GapDetector::Gap> GapDetector::nearest_direction(float angle) const
+{
+    if (gaps.empty())
+        return {};
+    // binary search on the sorted angles, then the closer of both neighbours
+    const auto it = std::ranges::lower_bound(gaps, angle, {}, &Gap::angle);
+    if (it == gaps.begin())
+        return *it;
+    if (it == gaps.end())
+        return gaps.back();
+    return std::fabs(it->angle - angle) < std::fabs(std::prev(it)->angle - angle) ? *it : *std::prev(it);
+}
+
+std::optional<GapDetector::Gap> GapDetector::select(const Eigen::Vector2f &point, float hysteresis)
+{
+    const auto best = nearest(point);
+    if (not best.has_value())
+    {
+        selected.reset();
+        return {};
+    }
+    if (selected.has_value() and selected.value() != best->id)
+        if (const auto previous = find(selected.value()); previous.has_value() and
+            (previous->center - point).norm() <= (1.f + hysteresis) * (best->center - point).norm())
+            return previous;
+    selected = best->id;
+    return best;
+}
@@ -0,0 +1,80 @@
+//
+// Openings in a laser scan, found where the range jumps between consecutive beams, and tracked from one scan to the next
+// so that each one keeps its id while it stays in view. Detection is a single pass over the beams and tracking is a merge
+// of two lists sorted by angle. Queries return the opening closest to a point or to a direction, and a selection that
+// sticks to the previous choice unless another opening is clearly better. Everything is in the robot frame, in mm
+//
+
+#ifndef LASER_GAPS_H
+#define LASER_GAPS_H
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+class GapDetector
+{
+    public:
+        struct Options
+        {
+            float threshold = 500.f;            // mm of range jump between consecutive beams
+            float match_angle = 0.1f;           // rad. Max angle between an opening and its previous self
+            float match_distance = 400.f;       // mm. Max distance between an opening and its previous self
+        };
+        struct Gap
+        {
+            std::uint32_t id;
+            std::uint32_t beam;                 // second beam of the jump
+            float angle;                        // of the center
+            float near_dist, far_dist;          // ranges at both sides of the jump
+            Eigen::Vector2f center;             // midpoint of the ends of both beams
+            std::uint32_t age = 0;              // scans it has been tracked
+        };
+
+        GapDetector() = default;
+        explicit GapDetector(const Options &options_) : options(options_) {};
+        void set_options(const Options &options_)   { options = options_; };
+        const Options &get_options() const          { return options; };
+
+        // beams with .dist and .angle, e.g. RoboCompLaser::TLaserData, sorted by angle
+        template <typename LaserData>
+        const std::vector<Gap> &update(const LaserData &ldata)
+        {
+            current.clear();
+            for (std::size_t k = 1; k < ldata.size(); k++)
+            {
+                const auto &a = ldata[k - 1], &b = ldata[k];
+                if (std::fabs(b.dist - a.dist) <= options.threshold)
+                    continue;
+                const Eigen::Vector2f one(a.dist * std::sin(a.angle), a.dist * std::cos(a.angle));
+                const Eigen::Vector2f two(b.dist * std::sin(b.angle), b.dist * std::cos(b.angle));
+                const Eigen::Vector2f center = (one + two) / 2.f;
+                current.push_back(Gap{.id = 0, .beam = (std::uint32_t)k, .angle = std::atan2(center.x(), center.y()),
+                                      .near_dist = std::min(a.dist, b.dist), .far_dist = std::max(a.dist, b.dist),
+                                      .center = center});
+            }
+            track();
+            return gaps;
+        };
+        // openings of the last scan, sorted by angle
+        const std::vector<Gap> &get_gaps() const    { return gaps; };
+        std::optional<Gap> find(std::uint32_t id) const;
+
+        // opening whose center is closest to a point, or whose angle is closest to a direction
+        std::optional<Gap> nearest(const Eigen::Vector2f &point) const;
+        std::optional<Gap> nearest_direction(float angle) const;
+        // nearest opening to a point, keeping the previous selection while its distance is within (1 + hysteresis) of the best
+        std::optional<Gap> select(const Eigen::Vector2f &point, float hysteresis = 0.2f);
+
+    private:
+        Options options;
+        std::vector<Gap> gaps, current;
+        std::vector<std::uint8_t> taken;
+        std::uint32_t next_id = 1;
+        std::optional<std::uint32_t> selected;
+        void track();
+};
+
+#endif //LASER_GAPS_H
@@ -0,0 +1,103 @@
+//
+// One laser scan converted once and shared by every consumer of the cycle
+//
+
+#include "laser_frame.h"
+#include <cmath>
+
+void LaserFrame::build_table()
+{
+    const std::size_t n = angle_.size();
+    table_angle = angle_;
+    table_sin.resize(n);
+    table_cos.resize(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        table_sin[i] = std::sin(angle_[i]);
+        table_cos[i] = std::cos(angle_[i]);
+    }
+}
+
+void LaserFrame::to_cartesian()
+{
+    const std::size_t n = angle_.size();
+    x_.resize(n);
+    y_.resize(n);
+    const float *__restrict d = dist_.data();
+    const float *__restrict s = table_sin.data();
+    const float *__restrict c = table_cos.data();
+    float *__restrict x = x_.data();
+    float *__restrict y = y_.data();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        x[i] = d[i] * s[i];
+        y[i] = d[i] * c[i];
+    }
+    polygon_valid = points_meters_valid = external_points_valid = external_polygon_valid = false;
+}
+
+void LaserFrame::set_transform(const Eigen::Matrix3f &robot_to_external)
+{
+    transform = robot_to_external;
+    external_points_valid = external_polygon_valid = false;
+}
+
+void LaserFrame::set_pose(float x, float y, float angle)
+{
+    Eigen::Matrix3f m;
+    m << std::cos(angle), -std::sin(angle), x,
+         std::sin(angle), std::cos(angle), y,
+         0.f, 0.f, 1.f;
+    set_transform(m);
+}
+
+const QPolygonF &LaserFrame::polygon() const
+{
+    if (not polygon_valid)
+    {
+        polygon_.resize(x_.size());
+        for (std::size_t i = 0; i < x_.size(); i++)
+            polygon_[i] = QPointF(x_[i], y_[i]);
+        polygon_valid = true;
+    }
+    return polygon_;
+}
+
+const std::vector<Eigen::Vector2d> &LaserFrame::points_meters() const
+{
+    if (not points_meters_valid)
+    {
+        points_meters_.resize(x_.size());
+        for (std::size_t i = 0; i < x_.size(); i++)
+            points_meters_[i] = Eigen::Vector2d(x_[i] / 1000.0, y_[i] / 1000.0);
+        points_meters_valid = true;
+    }
+    return points_meters_;
+}
+
+const std::vector<Eigen::Vector2f> &LaserFrame::external_points() const
+{
+    if (not external_points_valid)
+    {
+        const Eigen::Matrix2f r = transform.topLeftCorner<2, 2>();
+        const Eigen::Vector2f t = transform.topRightCorner<2, 1>();
+        external_points_.resize(x_.size());
+        for (std::size_t i = 0; i < x_.size(); i++)
+            external_points_[i] = r * Eigen::Vector2f(x_[i], y_[i]) + t;
+        external_points_valid = true;
+    }
+    return external_points_;
+}
+
+const QPolygonF &LaserFrame::external_polygon() const
+{
+    if (not external_polygon_valid)
+    {
+        const auto &points = external_points();
+        external_polygon_.resize(points.size());
+        for (std::size_t i = 0; i < points.size(); i++)
+            external_polygon_[i] = QPointF(points[i].x(), points[i].y());
+        external_polygon_valid = true;
+    }
+    return external_polygon_;
+}
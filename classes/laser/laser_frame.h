@@ -0,0 +1,69 @@
+//
+// One laser scan converted once and shared by every consumer of the cycle. Beams are kept as structure-of-arrays, in
+// the robot frame, with sin and cos taken from a table that is only rebuilt when the beam angles change. Views in other
+// forms (Qt polygons for drawing, Eigen points for the MPC, an external frame such as the world or the grid) are built
+// the first time they are asked for and kept until the next scan or pose. They are not thread safe
+//
+
+#ifndef LASER_LASER_FRAME_H
+#define LASER_LASER_FRAME_H
+
+#include <Eigen/Dense>
+#include <QPolygonF>
+#include <span>
+#include <vector>
+
+class LaserFrame
+{
+    public:
+        // beams with .angle and .dist, e.g. RoboCompLaser::TLaserData. x = dist*sin(angle), y = dist*cos(angle)
+        template <typename LaserData>
+        void update(const LaserData &ldata)
+        {
+            const std::size_t n = ldata.size();
+            angle_.resize(n); dist_.resize(n);
+            bool same_angles = table_angle.size() == n;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                angle_[i] = ldata[i].angle;
+                dist_[i] = ldata[i].dist;
+                same_angles = same_angles and table_angle[i] == angle_[i];
+            }
+            if (not same_angles)
+                build_table();
+            to_cartesian();
+        };
+        // transform from the robot to the external frame, as a homogeneous 2D matrix
+        void set_transform(const Eigen::Matrix3f &robot_to_external);
+        // robot pose in the world, mm and rad
+        void set_pose(float x, float y, float angle);
+
+        std::size_t size() const                                { return angle_.size(); };
+        bool empty() const                                      { return angle_.empty(); };
+        std::span<const float> angle() const                    { return angle_; };
+        std::span<const float> dist() const                     { return dist_; };
+        // robot frame, mm
+        std::span<const float> x() const                        { return x_; };
+        std::span<const float> y() const                        { return y_; };
+
+        // lazy views
+        const QPolygonF &polygon() const;                       // robot frame, mm
+        const std::vector<Eigen::Vector2d> &points_meters() const;    // robot frame, m
+        const std::vector<Eigen::Vector2f> &external_points() const;
+        const QPolygonF &external_polygon() const;
+
+    private:
+        std::vector<float> angle_, dist_, x_, y_;
+        std::vector<float> table_angle, table_sin, table_cos;
+        Eigen::Matrix3f transform = Eigen::Matrix3f::Identity();
+
+        mutable QPolygonF polygon_, external_polygon_;
+        mutable std::vector<Eigen::Vector2d> points_meters_;
+        mutable std::vector<Eigen::Vector2f> external_points_;
+        mutable bool polygon_valid = false, points_meters_valid = false, external_points_valid = false, external_polygon_valid = false;
+
+        void build_table();
+        void to_cartesian();
+};
+
+#endif //LASER_LASER_FRAME_H
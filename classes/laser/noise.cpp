@@ -0,0 +1,74 @@
+//
+// Simulated laser noise from a counter based generator
+//
+
+#include "noise.h"
+#include <array>
+#include <cmath>
+
+namespace
+{
+    // Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011)
+    using Counter = std::array<std::uint32_t, 4>;
+    inline Counter philox(Counter c, std::uint64_t seed)
+    {
+        constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57, W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+        std::uint32_t k0 = (std::uint32_t)seed, k1 = (std::uint32_t)(seed >> 32);
+        for (int r = 0; r < 10; r++)
+        {
+            const std::uint64_t p0 = (std::uint64_t)M0 * c[0];
+            const std::uint64_t p1 = (std::uint64_t)M1 * c[2];
+            c = Counter{(std::uint32_t)(p1 >> 32) ^ c[1] ^ k0, (std::uint32_t)p1,
+                        (std::uint32_t)(p0 >> 32) ^ c[3] ^ k1, (std::uint32_t)p0};
+            k0 += W0; k1 += W1;
+        }
+        return c;
+    }
+    // streams of a scan
+    constexpr std::uint32_t GAUSSIAN = 0, HARD = 1;
+    inline Counter counter(std::uint32_t block, std::uint64_t scan, std::uint32_t stream)
+    { return Counter{block, (std::uint32_t)scan, (std::uint32_t)(scan >> 32), stream}; }
+    // (0, 1] and [0, 1)
+    inline float open_unit(std::uint32_t u)     { return ((float)(u >> 8) + 1.f) * 0x1p-24f; }
+    inline float unit(std::uint32_t u)          { return (float)(u >> 8) * 0x1p-24f; }
+}
+
+void LaserNoise::fill_normal(std::span<float> out, std::uint64_t seed, std::uint64_t scan)
+{
+    // Box-Muller, four samples per block
+    constexpr float two_pi = 6.28318530718f;
+    auto block = [seed, scan](std::size_t b, float *z)
+    {
+        const Counter r = philox(counter((std::uint32_t)b, scan, GAUSSIAN), seed);
+        const float m0 = std::sqrt(-2.f * std::log(open_unit(r[0]))), a0 = two_pi * unit(r[1]);
+        const float m1 = std::sqrt(-2.f * std::log(open_unit(r[2]))), a1 = two_pi * unit(r[3]);
+        z[0] = m0 * std::cos(a0); z[1] = m0 * std::sin(a0);
+        z[2] = m1 * std::cos(a1); z[3] = m1 * std::sin(a1);
+    };
+    const std::size_t n = out.size();
+    const std::size_t full = n / 4;
+    for (std::size_t b = 0; b < full; b++)      // blocks are independent, without branches
+        block(b, out.data() + 4 * b);
+    if (n % 4 != 0)
+    {
+        float z[4];
+        block(full, z);
+        for (std::size_t k = 0; k < n % 4; k++)
+            out[4 * full + k] = z[k];
+    }
+}
+
+LaserNoise::Draw LaserNoise::hard_draw(std::uint64_t seed, std::uint64_t scan, int k, std::size_t beams)
+{
+    const Counter r = philox(counter((std::uint32_t)k, scan, HARD), seed);
+    // multiply-shift maps the 32 bits to [0, beams) without a division
+    return Draw{(std::size_t)(((std::uint64_t)r[0] * beams) >> 32), unit(r[1])};
+}
+
+LaserNoise::Profile LaserNoise::profile_from_string(std::string_view name)
+{
+    if (name == "gaussian") return Profile::GAUSSIAN;
+    if (name == "hard") return Profile::HARD;
+    if (name == "gaussian_hard") return Profile::GAUSSIAN_HARD;
+    return Profile::NONE;
+}
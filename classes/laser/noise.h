@@ -0,0 +1,74 @@
+//
+// Simulated laser noise: gaussian radial noise on every beam, with a fixed and a range proportional part, and hard noise
+// on a few random beams that are shortened as if hit by something close. Random numbers come from a counter based
+// generator (Philox4x32-10) keyed by the seed and indexed by scan and beam, so any scan can be reproduced on its own and
+// a whole scan is generated in one batch. Buffers are kept from one scan to the next
+//
+
+#ifndef LASER_NOISE_H
+#define LASER_NOISE_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+class LaserNoise
+{
+    public:
+        enum class Profile {NONE, GAUSSIAN, HARD, GAUSSIAN_HARD};
+        struct Options
+        {
+            Profile profile = Profile::NONE;
+            float sigma = 0.f;                      // mm
+            float range_sigma = 0.f;                // fraction of the range
+            int hard_rays = 0;                      // beams drawn per scan for hard noise
+            float hard_probability = 1.f;           // of a drawn beam being affected
+            float hard_divisor = 5.f;               // affected beams are divided by it
+            std::uint64_t seed = 0;
+        };
+        // none, gaussian, hard or gaussian_hard. Unknown names are NONE
+        static Profile profile_from_string(std::string_view name);
+
+        LaserNoise() = default;
+        explicit LaserNoise(const Options &options_) : options(options_) {};
+        void set_options(const Options &options_)   { options = options_; };
+        const Options &get_options() const          { return options; };
+        // number of the next scan. Setting it back replays the same noise
+        void set_scan(std::uint64_t scan_)          { scan = scan_; };
+        std::uint64_t get_scan() const              { return scan; };
+
+        // beams with .dist, e.g. RoboCompLaser::TLaserData
+        template <typename LaserData>
+        void apply(LaserData &ldata)
+        {
+            const std::size_t n = ldata.size();
+            const bool gaussian = options.profile == Profile::GAUSSIAN or options.profile == Profile::GAUSSIAN_HARD;
+            const bool hard = options.profile == Profile::HARD or options.profile == Profile::GAUSSIAN_HARD;
+            if (gaussian and n > 0)
+            {
+                normals.resize(n);
+                fill_normal(normals, options.seed, scan);
+                for (std::size_t i = 0; i < n; i++)
+                    ldata[i].dist += normals[i] * (options.sigma + options.range_sigma * ldata[i].dist);
+            }
+            if (hard and n > 0)
+                for (int k = 0; k < options.hard_rays; k++)
+                    if (const auto [beam, accept] = hard_draw(options.seed, scan, k, n); accept < options.hard_probability)
+                        ldata[beam].dist /= options.hard_divisor;
+            scan++;
+        };
+
+        // standard normal samples for the beams of a scan, out[i] depending only on seed, scan and i
+        static void fill_normal(std::span<float> out, std::uint64_t seed, std::uint64_t scan);
+
+    private:
+        Options options;
+        std::uint64_t scan = 0;
+        std::vector<float> normals;
+
+        struct Draw { std::size_t beam; float accept; };
+        static Draw hard_draw(std::uint64_t seed, std::uint64_t scan, int k, std::size_t beams);
+};
+
+#endif //LASER_NOISE_H
@@ -0,0 +1,100 @@
+//
+// Index over a laser contour: closest point and inside test
+//
+
+#include "polyline_index.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+void PolylineIndex::build(std::span<const float> x_, std::span<const float> y_, std::span<const float> angle_)
+{
+    x = x_; y = y_; angle = angle_;
+    const std::size_t segments = x.size() > 1 ? x.size() - 1 : 0;
+    const std::size_t blocks = (segments + BLOCK - 1) / BLOCK;
+    leaves = std::bit_ceil(std::max<std::size_t>(blocks, 1));
+    const float inf = std::numeric_limits<float>::infinity();
+    const Box empty{Eigen::Vector2f(inf, inf), Eigen::Vector2f(-inf, -inf)};
+    boxes.assign(2 * leaves, empty);
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+        Box &box = boxes[leaves + b];
+        for (std::size_t i = b * BLOCK; i <= std::min((b + 1) * BLOCK, segments); i++)
+        {
+            box.min = box.min.cwiseMin(Eigen::Vector2f(x[i], y[i]));
+            box.max = box.max.cwiseMax(Eigen::Vector2f(x[i], y[i]));
+        }
+    }
+    for (std::size_t n = leaves - 1; n > 0; n--)
+        boxes[n] = Box{boxes[2 * n].min.cwiseMin(boxes[2 * n + 1].min), boxes[2 * n].max.cwiseMax(boxes[2 * n + 1].max)};
+}
+
+float PolylineIndex::squared_distance(const Box &b, const Eigen::Vector2f &p)
+{
+    // empty boxes are at infinity
+    const Eigen::Vector2f d = (b.min - p).cwiseMax(p - b.max).cwiseMax(0.f);
+    return d.squaredNorm();
+}
+
+Eigen::Vector2f PolylineIndex::project(std::size_t segment, const Eigen::Vector2f &p) const
+{
+    const Eigen::Vector2f a(x[segment], y[segment]), b(x[segment + 1], y[segment + 1]);
+    const Eigen::Vector2f d = b - a;
+    const float len2 = d.squaredNorm();
+    if (len2 == 0.f)
+        return a;
+    return a + std::clamp((p - a).dot(d) / len2, 0.f, 1.f) * d;
+}
+
+std::optional<PolylineIndex::Closest> PolylineIndex::closest(const Eigen::Vector2f &p) const
+{
+    const std::size_t segments = x.size() > 1 ? x.size() - 1 : 0;
+    if (segments == 0)
+        return {};
+    float best = std::numeric_limits<float>::infinity();
+    Closest result{};
+    auto &nodes = stack;
+    nodes.clear();
+    nodes.push_back(1);
+    while (not nodes.empty())
+    {
+        const std::uint32_t n = nodes.back();
+        nodes.pop_back();
+        if (squared_distance(boxes[n], p) >= best)
+            continue;
+        if (n >= leaves)
+        {
+            const std::size_t first = (n - leaves) * BLOCK;
+            for (std::size_t s = first; s < std::min(first + BLOCK, segments); s++)
+                if (const Eigen::Vector2f q = project(s, p); (q - p).squaredNorm() < best)
+                {
+                    best = (q - p).squaredNorm();
+                    result.point = q;
+                    result.segment = (std::uint32_t)s;
+                }
+            continue;
+        }
+        // the closer child is pushed last, to be searched first
+        const float dl = squared_distance(boxes[2 * n], p), dr = squared_distance(boxes[2 * n + 1], p);
+        if (dl < dr) { nodes.push_back(2 * n + 1); nodes.push_back(2 * n); }
+        else { nodes.push_back(2 * n); nodes.push_back(2 * n + 1); }
+    }
+    result.distance = std::sqrt(best);
+    return result;
+}
+
+bool PolylineIndex::contains(const Eigen::Vector2f &p) const
+{
+    if (x.size() < 2)
+        return false;
+    const float a = std::atan2(p.x(), p.y());
+    if (a < angle.front() or a > angle.back())
+        return false;
+    // beams i and i+1 around the angle of p, and p on the sensor side of the segment joining them
+    const std::size_t i = std::min<std::size_t>(std::ranges::upper_bound(angle, a) - angle.begin(), x.size() - 1) - 1;
+    const Eigen::Vector2f u(x[i], y[i]), v(x[i + 1], y[i + 1]);
+    const auto cross = [](const Eigen::Vector2f &s, const Eigen::Vector2f &t) { return s.x() * t.y() - s.y() * t.x(); };
+    // the origin and p must be on the same side of uv
+    return cross(v - u, p - u) * cross(v - u, -u) > 0.f;
+}
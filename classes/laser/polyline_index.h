@@ -0,0 +1,50 @@
+//
+// Index over a laser contour for the two queries of target handling: closest point of the contour to a point, and whether
+// a point is inside the laser polygon. The contour is split in blocks of consecutive segments, and a tree of their bounding
+// boxes is searched closest box first, discarding boxes farther than the best point found, in O(log n) for typical scans.
+// The laser polygon is the contour closed through the sensor, which is star shaped around it, so the inside test is a
+// binary search on the beam angles and one cross product. Built in O(n) once per scan. Coordinates in the robot frame
+//
+
+#ifndef LASER_POLYLINE_INDEX_H
+#define LASER_POLYLINE_INDEX_H
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+class PolylineIndex
+{
+    public:
+        struct Closest
+        {
+            Eigen::Vector2f point;
+            float distance;
+            std::uint32_t segment;              // from point segment to segment + 1
+        };
+
+        // contour points and the angles of their beams, increasing, with x = dist*sin(angle) and y = dist*cos(angle).
+        // The spans are borrowed until the next build, e.g. from LaserFrame
+        void build(std::span<const float> x, std::span<const float> y, std::span<const float> angle);
+        std::size_t size() const                    { return x.size(); };
+
+        // closest point to p on the segments joining consecutive points
+        std::optional<Closest> closest(const Eigen::Vector2f &p) const;
+        // p inside the polygon made by the contour and the sensor at the origin
+        bool contains(const Eigen::Vector2f &p) const;
+
+    private:
+        static constexpr std::size_t BLOCK = 8;     // segments per leaf
+        std::span<const float> x, y, angle;
+        struct Box { Eigen::Vector2f min, max; };
+        std::vector<Box> boxes;                     // implicit complete binary tree, root at 1, leaves from `leaves`
+        std::size_t leaves = 0;
+        mutable std::vector<std::uint32_t> stack;   // scratch of the queries, so they are not thread safe
+
+        static float squared_distance(const Box &b, const Eigen::Vector2f &p);
+        Eigen::Vector2f project(std::size_t segment, const Eigen::Vector2f &p) const;
+};
+
+#endif //LASER_POLYLINE_INDEX_H
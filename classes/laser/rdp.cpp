@@ -0,0 +1,217 @@
+//
+// Ramer-Douglas-Peucker simplification of laser contours
+//
+
+#include "rdp.h"
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+const std::vector<std::uint32_t> &RamerDouglasPeucker::simplify(std::span<const float> x, std::span<const float> y,
+                                                                 float epsilon, Method method)
+{
+    const std::size_t n = std::min(x.size(), y.size());
+    kept.clear();
+    if (n < 2)
+    {
+        if (n == 1) kept.push_back(0);
+        return kept;
+    }
+    if (method == Method::HULL_TREE)
+        build_tree(x, y);
+    // AUTO scans until the work goes beyond that of well balanced splits, and then builds the tree
+    const std::size_t budget = 2 * n * (std::bit_width(n) + 1);
+    std::size_t scanned = 0;
+
+    keep.assign(n, 0);
+    keep.front() = keep.back() = 1;
+    const float epsilon2 = epsilon * epsilon;
+    stack.clear();
+    stack.push_back(Range{0, (std::uint32_t)(n - 1)});
+    while (not stack.empty())
+    {
+        const Range r = stack.back();
+        stack.pop_back();
+        if (r.last - r.first < 2)
+            continue;
+        if (method == Method::AUTO and (scanned += r.last - r.first) > budget)
+        {
+            build_tree(x, y);
+            method = Method::HULL_TREE;
+        }
+        float dist2;
+        const auto k = method == Method::HULL_TREE ? farthest_tree(x, y, r, dist2) : farthest_linear(x, y, r, dist2);
+        if (dist2 > epsilon2)
+        {
+            keep[k] = 1;
+            stack.push_back(Range{k, r.last});
+            stack.push_back(Range{r.first, k});
+        }
+    }
+    for (std::uint32_t i = 0; i < n; i++)
+        if (keep[i])
+            kept.push_back(i);
+    return kept;
+}
+
+void RamerDouglasPeucker::simplify(std::span<const Polyline> polylines, float epsilon, Batch &out, Method method)
+{
+    out.indices.clear();
+    out.begin.assign(1, 0);
+    for (const auto &p : polylines)
+    {
+        const auto &k = simplify(p.x, p.y, epsilon, method);
+        out.indices.insert(out.indices.end(), k.begin(), k.end());
+        out.begin.push_back((std::uint32_t)out.indices.size());
+    }
+}
+
+std::uint32_t RamerDouglasPeucker::farthest_linear(std::span<const float> x, std::span<const float> y, Range r, float &best) const
+{
+    const float ax = x[r.first], ay = y[r.first];
+    const float dx = x[r.last] - ax, dy = y[r.last] - ay;
+    const float d2 = dx * dx + dy * dy;
+    std::uint32_t k = r.first + 1;
+    float max = -1.f;
+    if (d2 > 0.f)
+    {
+        // distance to the line times the length of the segment
+        for (std::uint32_t i = r.first + 1; i < r.last; i++)
+            if (const float g = std::fabs(dx * (y[i] - ay) - dy * (x[i] - ax)); g > max)
+            {
+                max = g;
+                k = i;
+            }
+        best = max * max / d2;
+    }
+    else
+    {
+        // closed range, distance to the end point
+        for (std::uint32_t i = r.first + 1; i < r.last; i++)
+            if (const float g = (x[i] - ax) * (x[i] - ax) + (y[i] - ay) * (y[i] - ay); g > max)
+            {
+                max = g;
+                k = i;
+            }
+        best = max;
+    }
+    return k;
+}
+
+void RamerDouglasPeucker::build_tree(std::span<const float> x, std::span<const float> y)
+{
+    const std::size_t n = std::min(x.size(), y.size());
+    const std::size_t num_leaves = (n + LEAF - 1) / LEAF;
+    std::size_t num_levels = 1;
+    while ((std::size_t(1) << (num_levels - 1)) < num_leaves)
+        num_levels++;
+    if (levels.size() < num_levels)
+        levels.resize(num_levels);
+
+    auto by_x = [x, y](std::uint32_t a, std::uint32_t b) { return x[a] < x[b] or (x[a] == x[b] and y[a] < y[b]); };
+    auto cross = [x, y](std::uint32_t o, std::uint32_t a, std::uint32_t b)
+        { return (x[a] - x[o]) * (y[b] - y[o]) - (y[a] - y[o]) * (x[b] - x[o]); };
+    for (std::size_t l = 0; l < num_levels; l++)
+    {
+        auto &level = levels[l];
+        const std::size_t width = LEAF << l;
+        const std::size_t num_nodes = (n + width - 1) / width;
+        level.sorted.resize(n); level.upper.resize(n); level.lower.resize(n);
+        level.upper_size.resize(num_nodes); level.lower_size.resize(num_nodes);
+        for (std::size_t b = 0; b < num_nodes; b++)
+        {
+            const std::size_t s = b * width, e = std::min(s + width, n);
+            if (l == 0)
+            {
+                std::iota(level.sorted.begin() + s, level.sorted.begin() + e, (std::uint32_t)s);
+                std::sort(level.sorted.begin() + s, level.sorted.begin() + e, by_x);
+            }
+            else
+            {
+                const auto &child = levels[l - 1].sorted;
+                const std::size_t mid = std::min(s + width / 2, e);
+                std::merge(child.begin() + s, child.begin() + mid, child.begin() + mid, child.begin() + e,
+                           level.sorted.begin() + s, by_x);
+            }
+            // monotone chain, collinear points dropped
+            std::uint32_t *upper = level.upper.data() + s, *lower = level.lower.data() + s;
+            std::uint32_t nu = 0, nl = 0;
+            for (std::size_t i = s; i < e; i++)
+            {
+                const auto p = level.sorted[i];
+                while (nl >= 2 and cross(lower[nl - 2], lower[nl - 1], p) <= 0.f) nl--;
+                lower[nl++] = p;
+                while (nu >= 2 and cross(upper[nu - 2], upper[nu - 1], p) >= 0.f) nu--;
+                upper[nu++] = p;
+            }
+            level.upper_size[b] = nu;
+            level.lower_size[b] = nl;
+        }
+    }
+}
+
+std::uint32_t RamerDouglasPeucker::farthest_tree(std::span<const float> x, std::span<const float> y, Range r, float &best) const
+{
+    const float ax = x[r.first], ay = y[r.first];
+    const float dx = x[r.last] - ax, dy = y[r.last] - ay;
+    const float d2 = dx * dx + dy * dy;
+    if (d2 == 0.f)
+        return farthest_linear(x, y, r, best);
+
+    // g(p) = (p - a) x d is linear in p, so its extremes over a set of points are on the convex hull. Along an x-monotone
+    // convex chain the sign of g on the edges changes at most once, which allows a binary search
+    auto g = [&](std::uint32_t i) { return dx * (y[i] - ay) - dy * (x[i] - ax); };
+    auto extreme = [&](const std::uint32_t *chain, std::uint32_t m, float sign)
+    {
+        if (m == 1) return chain[0];
+        auto rising = [&](std::uint32_t i) { return sign * (g(chain[i + 1]) - g(chain[i])) > 0.f; };
+        if (rising(0))
+        {
+            std::uint32_t lo = 1, hi = m - 1;   // first edge not rising, or m-1
+            while (lo < hi)
+            {
+                const std::uint32_t mid = (lo + hi) / 2;
+                if (rising(mid)) lo = mid + 1; else hi = mid;
+            }
+            return chain[lo];
+        }
+        return sign * g(chain[m - 1]) > sign * g(chain[0]) ? chain[m - 1] : chain[0];
+    };
+
+    std::uint32_t k = r.first + 1;
+    float max = -1.f;
+    auto consider = [&](std::uint32_t i)
+    {
+        if (const float v = std::fabs(g(i)); v > max or (v == max and i < k))
+        {
+            max = v;
+            k = i;
+        }
+    };
+    // the interior points [first+1, last) are the ragged ends, scanned, and whole leaves, split into tree nodes
+    std::size_t lo = r.first + 1, hi = r.last;
+    std::size_t lo_leaf = (lo + LEAF - 1) / LEAF, hi_leaf = hi / LEAF;
+    if (lo_leaf >= hi_leaf)
+        lo_leaf = hi_leaf = lo / LEAF;          // no whole leaf, scan it all
+    for (std::size_t i = lo; i < std::min(hi, lo_leaf * LEAF); i++) consider(i);
+    for (std::size_t i = std::max(lo, hi_leaf * LEAF); i < hi; i++) consider(i);
+    lo = lo_leaf; hi = hi_leaf;
+    for (std::size_t l = 0; lo < hi; l++, lo >>= 1, hi >>= 1)
+    {
+        const auto &level = levels[l];
+        auto visit = [&](std::size_t b)
+        {
+            const std::size_t s = b * (LEAF << l);
+            const std::uint32_t *upper = level.upper.data() + s, *lower = level.lower.data() + s;
+            for (const float sign : {1.f, -1.f})
+            {
+                consider(extreme(upper, level.upper_size[b], sign));
+                consider(extreme(lower, level.lower_size[b], sign));
+            }
+        };
+        if (lo & 1) visit(lo++);
+        if (hi & 1) visit(--hi);
+    }
+    best = max * max / d2;
+    return k;
+}
@@ -0,0 +1,76 @@
+//
+// Ramer-Douglas-Peucker simplification of laser contours. Iterative, with an explicit stack of index ranges and squared
+// distances, and with every buffer kept from one call to the next. The result is the list of indices of the kept points.
+// Two ways to find the farthest point of a range: a linear scan, O(n) per range, and a tree of convex hulls built once
+// per contour in O(n log n), that answers each range in O(log² n). Scanning is faster on typical scans, where the splits
+// are balanced, but it is quadratic when they are not
+//
+
+#ifndef LASER_RDP_H
+#define LASER_RDP_H
+
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class RamerDouglasPeucker
+{
+    public:
+        // AUTO starts scanning and moves to the tree when the splits are unbalanced enough to make scanning quadratic
+        enum class Method {LINEAR, HULL_TREE, AUTO};
+
+        struct Polyline { std::span<const float> x, y; };
+        // kept indices of all the polylines of a batch, those of polyline k in [begin[k], begin[k+1])
+        struct Batch
+        {
+            std::vector<std::uint32_t> indices, begin;
+            std::span<const std::uint32_t> operator[](std::size_t k) const
+            { return {indices.data() + begin[k], indices.data() + begin[k + 1]}; };
+            std::size_t size() const        { return begin.empty() ? 0 : begin.size() - 1; };
+        };
+
+        // indices of the kept points, in order and with the first and last ones. Valid until the next call
+        const std::vector<std::uint32_t> &simplify(std::span<const float> x, std::span<const float> y, float epsilon,
+                                                   Method method = Method::AUTO);
+        // same for a laser scan, with x = dist*sin(angle) and y = dist*cos(angle). Coordinates are in points_x() and points_y()
+        template <typename LaserData>
+        const std::vector<std::uint32_t> &simplify_scan(const LaserData &ldata, float epsilon, Method method = Method::AUTO)
+        {
+            scan_x.resize(ldata.size());
+            scan_y.resize(ldata.size());
+            for (std::size_t i = 0; i < ldata.size(); i++)
+            {
+                scan_x[i] = ldata[i].dist * std::sin(ldata[i].angle);
+                scan_y[i] = ldata[i].dist * std::cos(ldata[i].angle);
+            }
+            return simplify(scan_x, scan_y, epsilon, method);
+        };
+        const std::vector<float> &points_x() const      { return scan_x; };
+        const std::vector<float> &points_y() const      { return scan_y; };
+        // several polylines, e.g. the scans of all the lasers, in one call
+        void simplify(std::span<const Polyline> polylines, float epsilon, Batch &out, Method method = Method::AUTO);
+
+    private:
+        struct Range { std::uint32_t first, last; };
+        std::vector<Range> stack;
+        std::vector<std::uint8_t> keep;
+        std::vector<std::uint32_t> kept;
+        std::vector<float> scan_x, scan_y;
+
+        // merge sort tree over the points: level l has the nodes covering [b*LEAF*2^l, (b+1)*LEAF*2^l), each one with its
+        // points sorted by x and its upper and lower hulls, stored in place at the node offset
+        static constexpr std::size_t LEAF = 32;
+        struct Level
+        {
+            std::vector<std::uint32_t> sorted, upper, lower;
+            std::vector<std::uint32_t> upper_size, lower_size;    // per node
+        };
+        std::vector<Level> levels;
+        void build_tree(std::span<const float> x, std::span<const float> y);
+        // index in (first, last) of the point with the largest |(p - a) x d|, and that value squared
+        std::uint32_t farthest_linear(std::span<const float> x, std::span<const float> y, Range r, float &best) const;
+        std::uint32_t farthest_tree(std::span<const float> x, std::span<const float> y, Range r, float &best) const;
+};
+
+#endif //LASER_RDP_H
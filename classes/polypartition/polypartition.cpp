@@ -40,25 +40,28 @@ using namespace std;
 
 TPPLPoly::TPPLPoly() { 
 	hole = false;
-	numpoints = 0;
-	points = NULL;
 }
 
-TPPLPoly::~TPPLPoly() {
-	if(points) delete [] points;
+TPPLPoly::TPPLPoly(const allocator_type &alloc) : points(alloc) {
+	hole = false;
+}
+
+TPPLPoly::TPPLPoly(const TPPLPoly &src, const allocator_type &alloc) : points(src.points, alloc) {
+	hole = src.hole;
+}
+
+TPPLPoly::TPPLPoly(TPPLPoly &&src, const allocator_type &alloc) : points(std::move(src.points), alloc) {
+	hole = src.hole;
 }
 
 void TPPLPoly::Clear() {
-	if(points) delete [] points;
 	hole = false;
-	numpoints = 0;
-	points = NULL;
+	points.clear();
 }
 
 void TPPLPoly::Init(long numpoints) {
 	Clear();
-	this->numpoints = numpoints;
-	points = new TPPLPoint[numpoints];
+	points.resize(numpoints);
 }
 
 void TPPLPoly::Triangle(TPPLPoint &p1, TPPLPoint &p2, TPPLPoint &p3) {
@@ -68,31 +71,9 @@ void TPPLPoly::Triangle(TPPLPoint &p1, TPPLPoint &p2, TPPLPoint &p3) {
 	points[2] = p3;
 }
 
-TPPLPoly::TPPLPoly(const TPPLPoly &src) : TPPLPoly() {
-	hole = src.hole;
-	numpoints = src.numpoints;
-
-	if(numpoints > 0) {
-		points = new TPPLPoint[numpoints];
-		memcpy(points, src.points, numpoints*sizeof(TPPLPoint));
-	}
-}
-
-TPPLPoly& TPPLPoly::operator=(const TPPLPoly &src) {
-	Clear();
-	hole = src.hole;
-	numpoints = src.numpoints;
-	
-	if(numpoints > 0) {
-		points = new TPPLPoint[numpoints];
-		memcpy(points, src.points, numpoints*sizeof(TPPLPoint));
-	}
-	
-	return *this;
-}
-
 int TPPLPoly::GetOrientation() const {
 	long i1,i2;
+	long numpoints = GetNumPoints();
 	tppl_float area = 0;
 	for(i1=0; i1<numpoints; i1++) {
 		i2 = i1+1;
@@ -112,7 +93,7 @@ void TPPLPoly::SetOrientation(int orientation) {
 }
 
 void TPPLPoly::Invert() {
-	std::reverse(points, points + numpoints);
+	std::reverse(points.begin(), points.end());
 }
 
 TPPLPartition::PartitionVertex::PartitionVertex() : previous(NULL), next(NULL) {
@@ -172,13 +153,13 @@ int TPPLPartition::Intersects(TPPLPoint &p11, TPPLPoint &p12, TPPLPoint &p21, TP
 
 //removes holes from inpolys by merging them with non-holes
 int TPPLPartition::RemoveHoles(TPPLPolyList *inpolys, TPPLPolyList *outpolys) {
-	TPPLPolyList polys;
+	TPPLPolyList polys(&arena);
 	TPPLPolyList::iterator holeiter,polyiter,iter,iter2;
 	long i,i2,holepointindex,polypointindex;
 	TPPLPoint holepoint,polypoint,bestpolypoint;
 	TPPLPoint linep1,linep2;
 	TPPLPoint v1,v2;
-	TPPLPoly newpoly;
+	TPPLPoly newpoly(&arena);
 	bool hasholes;
 	bool pointvisible;
 	bool pointfound;
@@ -200,26 +181,28 @@ int TPPLPartition::RemoveHoles(TPPLPolyList *inpolys, TPPLPolyList *outpolys) {
 
 	polys = *inpolys;
 
-	while(1) {
-		//find the hole point with the largest x
-		hasholes = false;
-		for(iter = polys.begin(); iter!=polys.end(); iter++) {
-			if(!iter->IsHole()) continue;
-
-			if(!hasholes) {
-				hasholes = true;
-				holeiter = iter;
-				holepointindex = 0;
-			}
-
-			for(i=0; i < iter->GetNumPoints(); i++) {
-				if(iter->GetPoint(i).x > holeiter->GetPoint(holepointindex).x) {
-					holeiter = iter;
-					holepointindex = i;
-				}
-			}
+	//holes in the order they are merged: decreasing x of their rightmost vertex, the first one of the list on ties.
+	//Merging only adds non-holes, so this is the order of the original scan over all the hole vertices in each step
+	struct HoleRef {
+		TPPLPolyList::iterator iter;
+		long pointindex;
+	};
+	std::pmr::vector<HoleRef> holes(&arena);
+	for(iter = polys.begin(); iter!=polys.end(); iter++) {
+		if(!iter->IsHole()) continue;
+		holepointindex = 0;
+		for(i=1; i < iter->GetNumPoints(); i++) {
+			if(iter->GetPoint(i).x > iter->GetPoint(holepointindex).x) holepointindex = i;
 		}
-		if(!hasholes) break;
+		holes.push_back(HoleRef{iter, holepointindex});
+	}
+	std::stable_sort(holes.begin(), holes.end(), [](const HoleRef &a, const HoleRef &b) {
+		return a.iter->GetPoint(a.pointindex).x > b.iter->GetPoint(b.pointindex).x;
+	});
+
+	for(const HoleRef &hole : holes) {
+		holeiter = hole.iter;
+		holepointindex = hole.pointindex;
 		holepoint = holeiter->GetPoint(holepointindex);
 		
 		pointfound = false;
@@ -392,7 +375,8 @@ int TPPLPartition::Triangulate_EC(TPPLPoly *poly, TPPLPolyList *triangles) {
 
 	numvertices = poly->GetNumPoints();
 
-	vertices = new PartitionVertex[numvertices];
+	ecVertices.resize(numvertices);
+	vertices = ecVertices.data();
 	for(i=0;i<numvertices;i++) {
 		vertices[i].isActive = true;
 		vertices[i].p = poly->GetPoint(i);
@@ -421,7 +405,6 @@ int TPPLPartition::Triangulate_EC(TPPLPoly *poly, TPPLPolyList *triangles) {
 			}
 		}
 		if(!earfound) {
-			delete [] vertices;
 			return 0;
 		}
 
@@ -445,13 +428,11 @@ int TPPLPartition::Triangulate_EC(TPPLPoly *poly, TPPLPolyList *triangles) {
 		}
 	}
 
-	delete [] vertices;
-
 	return 1;
 }
 
 int TPPLPartition::Triangulate_EC(TPPLPolyList *inpolys, TPPLPolyList *triangles) {
-	TPPLPolyList outpolys;
+	TPPLPolyList outpolys(&arena);
 	TPPLPolyList::iterator iter;
 	
 	if(!RemoveHoles(inpolys,&outpolys)) return 0;
@@ -464,10 +445,10 @@ int TPPLPartition::Triangulate_EC(TPPLPolyList *inpolys, TPPLPolyList *triangles
 int TPPLPartition::ConvexPartition_HM(TPPLPoly *poly, TPPLPolyList *parts) {
 	if(!poly->Valid()) return 0;
 	
-	TPPLPolyList triangles;
+	TPPLPolyList triangles(&arena);
 	TPPLPolyList::iterator iter1,iter2;
 	TPPLPoly *poly1 = NULL,*poly2 = NULL;
-	TPPLPoly newpoly;
+	TPPLPoly newpoly(&arena);
 	TPPLPoint d1,d2,p1,p2,p3;
 	long i11,i12,i21,i22,i13,i23,j,k;
 	bool isdiagonal;
@@ -564,7 +545,7 @@ int TPPLPartition::ConvexPartition_HM(TPPLPoly *poly, TPPLPolyList *parts) {
 }
 
 int TPPLPartition::ConvexPartition_HM(TPPLPolyList *inpolys, TPPLPolyList *parts) {
-	TPPLPolyList outpolys;
+	TPPLPolyList outpolys(&arena);
 	TPPLPolyList::iterator iter;
 	
 	if(!RemoveHoles(inpolys,&outpolys)) return 0;
@@ -574,6 +555,117 @@ int TPPLPartition::ConvexPartition_HM(TPPLPolyList *inpolys, TPPLPolyList *parts
 	return 1;
 }
 
+int TPPLPartition::ConvexPartition_MONO(TPPLPoly *poly, TPPLPolyList *parts) {
+	if(!poly->Valid()) return 0;
+
+	long i,numpoints;
+
+	//check if the poly is already convex
+	numpoints = poly->GetNumPoints();
+	for(i=0;i<numpoints;i++) {
+		if(IsReflex(poly->GetPoint((i+numpoints-1)%numpoints),poly->GetPoint(i),poly->GetPoint((i+1)%numpoints))) break;
+	}
+	if(i == numpoints) {
+		parts->push_back(*poly);
+		return 1;
+	}
+
+	TPPLPolyList polys(&arena);
+	polys.push_back(*poly);
+	return ConvexPartition_MONO(&polys, parts);
+}
+
+int TPPLPartition::ConvexPartition_MONO(TPPLPolyList *inpolys, TPPLPolyList *parts) {
+	TPPLPolyList triangles(&arena);
+
+	if(!Triangulate_MONO(inpolys,&triangles)) return 0;
+	return MergeTriangles(&triangles,parts);
+}
+
+int TPPLPartition::MergeTriangles(TPPLPolyList *triangles, TPPLPolyList *parts) {
+	TPPLPolyList::iterator iter;
+	long i,j,k,n,h,t,size;
+	TPPLPoly part(&arena);
+
+	//three half-edges per triangle, linked in counter-clockwise order
+	n = 0;
+	hmEdges.resize(3*triangles->size());
+	for(iter = triangles->begin(); iter != triangles->end(); iter++) {
+		if(iter->GetNumPoints() != 3) return 0;
+		for(i=0;i<3;i++) {
+			HalfEdge &e = hmEdges[n+i];
+			e.p = iter->GetPoint(i);
+			e.next = n+(i+1)%3;
+			e.previous = n+(i+2)%3;
+			e.twin = -1;
+			e.removed = false;
+		}
+		n += 3;
+	}
+
+	//twins are found by sorting the half-edges by their endpoints, lowest first
+	auto lower = [](const TPPLPoint &a, const TPPLPoint &b) {
+		return (a.x < b.x) || ((a.x == b.x) && (a.y < b.y));
+	};
+	auto low = [&](long e) -> const TPPLPoint & {
+		const TPPLPoint &p1 = hmEdges[e].p, &p2 = hmEdges[hmEdges[e].next].p;
+		return lower(p2,p1) ? p2 : p1;
+	};
+	auto high = [&](long e) -> const TPPLPoint & {
+		const TPPLPoint &p1 = hmEdges[e].p, &p2 = hmEdges[hmEdges[e].next].p;
+		return lower(p2,p1) ? p1 : p2;
+	};
+	hmOrder.resize(n);
+	for(i=0;i<n;i++) hmOrder[i] = i;
+	std::sort(hmOrder.begin(),hmOrder.end(),[&](long e1, long e2) {
+		if(lower(low(e1),low(e2))) return true;
+		if(lower(low(e2),low(e1))) return false;
+		return lower(high(e1),high(e2));
+	});
+	for(k=0;k+1<n;k++) {
+		h = hmOrder[k];
+		t = hmOrder[k+1];
+		if(hmEdges[h].p != hmEdges[hmEdges[t].next].p) continue;
+		if(hmEdges[t].p != hmEdges[hmEdges[h].next].p) continue;
+		hmEdges[h].twin = t;
+		hmEdges[t].twin = h;
+		k++;
+	}
+
+	//removing a diagonal only opens the angles at its ends, so a diagonal kept once is kept for good
+	//and a single pass leaves no removable diagonal
+	for(h=0;h<n;h++) {
+		t = hmEdges[h].twin;
+		if(t < h) continue;
+
+		HalfEdge &eh = hmEdges[h], &et = hmEdges[t];
+		if(!IsConvex(hmEdges[eh.previous].p,eh.p,hmEdges[hmEdges[et.next].next].p)) continue;
+		if(!IsConvex(hmEdges[et.previous].p,et.p,hmEdges[hmEdges[eh.next].next].p)) continue;
+
+		hmEdges[eh.previous].next = et.next;
+		hmEdges[et.next].previous = eh.previous;
+		hmEdges[et.previous].next = eh.next;
+		hmEdges[eh.next].previous = et.previous;
+		eh.removed = true;
+		et.removed = true;
+	}
+
+	//each remaining cycle is a part. The removed flag marks the half-edges already output
+	for(h=0;h<n;h++) {
+		if(hmEdges[h].removed) continue;
+		size = 1;
+		for(j=hmEdges[h].next;j!=h;j=hmEdges[j].next) size++;
+		part.Init(size);
+		for(i=0,j=h;i<size;i++,j=hmEdges[j].next) {
+			part[i] = hmEdges[j].p;
+			hmEdges[j].removed = true;
+		}
+		parts->push_back(part);
+	}
+
+	return 1;
+}
+
 //minimum-weight polygon triangulation by dynamic programming
 //O(n^3) time complexity
 //O(n^2) space complexity
@@ -586,15 +678,18 @@ int TPPLPartition::Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles) {
 	long bestvertex;
 	tppl_float weight,minweight,d1,d2;
 	Diagonal diagonal,newdiagonal;
-	DiagonalList diagonals;
+	DiagonalList diagonals(&arena);
 	TPPLPoly triangle;
 	int ret = 1;
 
+	//lower triangular table in a single buffer, row i with i states
 	n = poly->GetNumPoints();
-	dpstates = new DPState *[n];
+	optStates.resize(n*(n-1)/2);
+	optRows.resize(n);
 	for(i=1;i<n;i++) {
-		dpstates[i] = new DPState[i];
+		optRows[i] = optStates.data() + i*(i-1)/2;
 	}
+	dpstates = optRows.data();
 
 	//init states and visibility
 	for(i=0;i<(n-1);i++) {
@@ -663,11 +758,6 @@ int TPPLPartition::Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles) {
 				}
 			}
 			if(bestvertex == -1) {
-				for(i=1;i<n;i++) {
-					delete [] dpstates[i];
-				}
-				delete [] dpstates;
-
 				return 0;
 			}
 			
@@ -701,11 +791,6 @@ int TPPLPartition::Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles) {
 		}
 	}
 
-	for(i=1;i<n;i++) {
-		delete [] dpstates[i];
-	}
-	delete [] dpstates;
-
 	return ret;
 }
 
@@ -804,23 +889,32 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) {
 	PartitionVertex *vertices = NULL;
 	DPState2 **dpstates = NULL;
 	long i,j,k,n,gap;
-	DiagonalList diagonals,diagonals2;
+	DiagonalList diagonals(&arena),diagonals2(&arena);
 	Diagonal diagonal,newdiagonal;
 	DiagonalList *pairs = NULL,*pairs2 = NULL;
 	DiagonalList::iterator iter,iter2;
 	int ret;
 	TPPLPoly newpoly;
-	vector<long> indices;
-	vector<long>::iterator iiter;
+	std::pmr::vector<long> indices(&arena);
+	std::pmr::vector<long>::iterator iiter;
 	bool ijreal,jkreal;
 
 	n = poly->GetNumPoints();
-	vertices = new PartitionVertex[n];
+	optVertices.resize(n);
+	vertices = optVertices.data();
 
-	dpstates = new DPState2 *[n];
+	//n x n table in a single buffer. The states of previous calls keep their lists, emptied here
+	while((long)cpStates.size() < n*n) {
+		cpStates.emplace_back(&arena);
+	}
+	for(i=0;i<n*n;i++) {
+		cpStates[i].pairs.clear();
+	}
+	cpRows.resize(n);
 	for(i=0;i<n;i++) {
-		dpstates[i] = new DPState2[n];
+		cpRows[i] = cpStates.data() + i*n;
 	}
+	dpstates = cpRows.data();
 
 	//init vertex information
 	for(i=0;i<n;i++) {
@@ -981,12 +1075,6 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) {
 	}
 
 	if(ret == 0) {
-		for(i=0;i<n;i++) {
-			delete [] dpstates[i];
-		}
-		delete [] dpstates;
-		delete [] vertices;
-
 		return ret;
 	}
 
@@ -1051,12 +1139,6 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) {
 		parts->push_back(newpoly);
 	}
 
-	for(i=0;i<n;i++) {
-		delete [] dpstates[i];
-	}
-	delete [] dpstates;
-	delete [] vertices;
-
 	return ret;
 }
 
@@ -1082,7 +1164,8 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
 	}
 
 	maxnumvertices = numvertices*3;
-	vertices = new MonotoneVertex[maxnumvertices];
+	monoVertices.resize(maxnumvertices);
+	vertices = monoVertices.data();
 	newnumvertices = numvertices;
 
 	polystartindex = 0;
@@ -1100,12 +1183,14 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
 	}
 
 	//construct the priority queue
-	long *priority = new long [numvertices];
+	monoPriority.resize(numvertices);
+	long *priority = monoPriority.data();
 	for(i=0;i<numvertices;i++) priority[i] = i;
 	std::sort(priority,&(priority[numvertices]),VertexSorter(vertices));
 
 	//determine vertex types
-	char *vertextypes = new char[maxnumvertices];
+	monoVertexTypes.resize(maxnumvertices);
+	char *vertextypes = monoVertexTypes.data();
 	for(i=0;i<numvertices;i++) {
 		v = &(vertices[i]);
 		vprev = &(vertices[v->previous]);
@@ -1130,17 +1215,19 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
 	}
 
 	//helpers
-	long *helpers = new long[maxnumvertices];
+	monoHelpers.resize(maxnumvertices);
+	long *helpers = monoHelpers.data();
 
 	//binary search tree that holds edges intersecting the scanline
 	//note that while set doesn't actually have to be implemented as a tree
 	//complexity requirements for operations are the same as for the balanced binary search tree
-	set<ScanLineEdge> edgeTree;
+	ScanLineEdgeTree edgeTree(&arena);
 	//store iterators to the edge tree elements
 	//this makes deleting existing edges much faster
-	set<ScanLineEdge>::iterator *edgeTreeIterators,edgeIter;
-	edgeTreeIterators = new set<ScanLineEdge>::iterator[maxnumvertices];
-	pair<set<ScanLineEdge>::iterator,bool> edgeTreeRet;
+	ScanLineEdgeTree::iterator *edgeTreeIterators,edgeIter;
+	monoEdgeTreeIterators.resize(maxnumvertices);
+	edgeTreeIterators = monoEdgeTreeIterators.data();
+	pair<ScanLineEdgeTree::iterator,bool> edgeTreeRet;
 	for(i = 0; i<numvertices; i++) edgeTreeIterators[i] = edgeTree.end();
 
 	//for each vertex
@@ -1287,13 +1374,13 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
 		if(error) break;
 	}
 
-	char *used = new char[newnumvertices];
-	memset(used,0,newnumvertices*sizeof(char));
+	monoUsed.assign(newnumvertices,0);
+	char *used = monoUsed.data();
 
 	if(!error) {
 		//return result
 		long size;
-		TPPLPoly mpoly;
+		TPPLPoly mpoly(&arena);
 		for(i=0;i<newnumvertices;i++) {
 			if(used[i]) continue;
 			v = &(vertices[i]);
@@ -1320,14 +1407,6 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
 		}
 	}
 
-	//cleanup
-	delete [] vertices;
-	delete [] priority;
-	delete [] vertextypes;
-	delete [] edgeTreeIterators;
-	delete [] helpers;
-	delete [] used;
-
 	if(error) {
 		return 0;
 	} else {
@@ -1337,8 +1416,8 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
 
 //adds a diagonal to the doubly-connected list of vertices
 void TPPLPartition::AddDiagonal(MonotoneVertex *vertices, long *numvertices, long index1, long index2, 
-								char *vertextypes, set<ScanLineEdge>::iterator *edgeTreeIterators, 
-								set<ScanLineEdge> *edgeTree, long *helpers) 
+								char *vertextypes, ScanLineEdgeTree::iterator *edgeTreeIterators, 
+								ScanLineEdgeTree *edgeTree, long *helpers) 
 {
 	long newindex1,newindex2;
 
@@ -1458,8 +1537,10 @@ int TPPLPartition::TriangulateMonotone(TPPLPoly *inPoly, TPPLPolyList *triangles
 		i = i2;
 	}
 
-	char *vertextypes = new char[numpoints];
-	long *priority = new long[numpoints];
+	triVertexTypes.resize(numpoints);
+	triPriority.resize(numpoints);
+	char *vertextypes = triVertexTypes.data();
+	long *priority = triPriority.data();
 
 	//merge left and right vertex chains
 	priority[0] = topindex;
@@ -1490,7 +1571,8 @@ int TPPLPartition::TriangulateMonotone(TPPLPoly *inPoly, TPPLPolyList *triangles
 	priority[i] = bottomindex;
 	vertextypes[bottomindex] = 0;
 
-	long *stack = new long[numpoints];
+	triStack.resize(numpoints);
+	long *stack = triStack.data();
 	long stackptr = 0;
 
 	stack[0] = priority[0];
@@ -1548,15 +1630,11 @@ int TPPLPartition::TriangulateMonotone(TPPLPoly *inPoly, TPPLPolyList *triangles
 		triangles->push_back(triangle);
 	}
 
-	delete [] priority;
-	delete [] vertextypes;
-	delete [] stack;
-
 	return 1;
 }
 
 int TPPLPartition::Triangulate_MONO(TPPLPolyList *inpolys, TPPLPolyList *triangles) {
-	TPPLPolyList monotone;
+	TPPLPolyList monotone(&arena);
 	TPPLPolyList::iterator iter;
 
 	if(!MonotonePartition(inpolys,&monotone)) return 0;
@@ -1567,7 +1645,7 @@ int TPPLPartition::Triangulate_MONO(TPPLPolyList *inpolys, TPPLPolyList *triangl
 }
 
 int TPPLPartition::Triangulate_MONO(TPPLPoly *poly, TPPLPolyList *triangles) {
-	TPPLPolyList polys;
+	TPPLPolyList polys(&arena);
 	polys.push_back(*poly);
 
 	return Triangulate_MONO(&polys, triangles);
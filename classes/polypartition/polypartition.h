@@ -18,11 +18,17 @@
 //OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 //THE SOFTWARE.
 
+//Modified for the components of this repository: shared by all of them, polygons keep their points in a contiguous
+//vector, lists are std::pmr containers and a TPPLPartition keeps its scratch buffers and a memory pool from one
+//call to the next, so a partition object kept alive does not allocate from the heap in steady state
+
 #ifndef POLYPARTITION_H
 #define POLYPARTITION_H
 
 #include <list>
 #include <set>
+#include <vector>
+#include <memory_resource>
 
 typedef double tppl_float;
 
@@ -72,25 +78,30 @@ struct TPPLPoint
 
 
 //Polygon implemented as an array of points with a 'hole' flag
+//the points are allocated from the memory resource of the list that holds the polygon
 class TPPLPoly
 {
     protected:
-        TPPLPoint *points;
-        long numpoints;
+        std::pmr::vector<TPPLPoint> points;
         bool hole;
         
     public:
-        
+        using allocator_type = std::pmr::polymorphic_allocator<TPPLPoint>;
+
         //constructors/destructors
         TPPLPoly();
-        ~TPPLPoly();
+        explicit TPPLPoly(const allocator_type &alloc);
         
-        TPPLPoly(const TPPLPoly &src);
-        TPPLPoly& operator=(const TPPLPoly &src);
+        TPPLPoly(const TPPLPoly &src) = default;
+        TPPLPoly(const TPPLPoly &src, const allocator_type &alloc);
+        TPPLPoly(TPPLPoly &&src) noexcept = default;
+        TPPLPoly(TPPLPoly &&src, const allocator_type &alloc);
+        TPPLPoly& operator=(const TPPLPoly &src) = default;
+        TPPLPoly& operator=(TPPLPoly &&src) = default;
         
         //getters and setters
         long GetNumPoints() const {
-            return numpoints;
+            return (long)points.size();
         }
         
         bool IsHole() const {
@@ -110,7 +121,7 @@ class TPPLPoly
         }
 
         TPPLPoint *GetPoints() {
-            return points;
+            return points.data();
         }
         
         TPPLPoint& operator[] (int i) {
@@ -124,7 +135,7 @@ class TPPLPoly
         //clears the polygon points
         void Clear();
         
-        //inits the polygon with numpoints vertices
+        //inits the polygon with numpoints vertices. The storage is reused when it is big enough
         void Init(long numpoints);
         
         //creates a triangle with points p1,p2,p3
@@ -147,14 +158,10 @@ class TPPLPoly
         void SetOrientation(int orientation);
 
         //checks whether a polygon is valid or not
-        inline bool Valid() const { return this->numpoints >= 3; }
+        inline bool Valid() const { return this->points.size() >= 3; }
 };
 
-#ifdef TPPL_ALLOCATOR
-typedef std::list<TPPLPoly, TPPL_ALLOCATOR(TPPLPoly)> TPPLPolyList;
-#else
-typedef std::list<TPPLPoly> TPPLPolyList;
-#endif
+typedef std::pmr::list<TPPLPoly> TPPLPolyList;
 
 class TPPLPartition {
     protected:
@@ -188,12 +195,18 @@ class TPPLPartition {
             long index1;
             long index2;
         };
+        
+        //half-edge of a triangle, used by ConvexPartition_MONO
+        //removing a diagonal links the half-edges of its two faces into a single cycle
+        struct HalfEdge {
+            TPPLPoint p;
+            long previous;
+            long next;
+            long twin;
+            bool removed;
+        };
 
-#ifdef TPPL_ALLOCATOR
-        typedef std::list<Diagonal, TPPL_ALLOCATOR(Diagonal)> DiagonalList;
-#else
-        typedef std::list<Diagonal> DiagonalList;
-#endif
+        typedef std::pmr::list<Diagonal> DiagonalList;
         
         //dynamic programming state for minimum-weight triangulation
         struct DPState {
@@ -204,9 +217,10 @@ class TPPLPartition {
         
         //dynamic programming state for convex partitioning
         struct DPState2 {
-            bool visible;
-            long weight;
+            bool visible = false;
+            long weight = 0;
             DiagonalList pairs;
+            explicit DPState2(std::pmr::memory_resource *resource) : pairs(resource) {}
         };
         
         //edge that intersects the scanline
@@ -220,6 +234,25 @@ class TPPLPartition {
             
             bool IsConvex(const TPPLPoint& p1, const TPPLPoint& p2, const TPPLPoint& p3) const;
         };
+        typedef std::pmr::set<ScanLineEdge> ScanLineEdgeTree;
+
+        //every temporary list, tree and polygon of a call is allocated from this pool, and given back to it at the end
+        std::pmr::unsynchronized_pool_resource arena;
+
+        //scratch buffers, kept between calls. Each one belongs to a single method, so they are never in use twice
+        std::vector<PartitionVertex> ecVertices, optVertices;
+        std::vector<DPState> optStates;
+        std::vector<DPState *> optRows;
+        std::vector<DPState2> cpStates;
+        std::vector<DPState2 *> cpRows;
+        std::vector<MonotoneVertex> monoVertices;
+        std::vector<long> monoPriority, monoHelpers;
+        std::vector<char> monoVertexTypes, monoUsed;
+        std::vector<ScanLineEdgeTree::iterator> monoEdgeTreeIterators;
+        std::vector<long> triPriority, triStack;
+        std::vector<char> triVertexTypes;
+        std::vector<HalfEdge> hmEdges;
+        std::vector<long> hmOrder;
         
         //standard helper functions
         bool IsConvex(TPPLPoint& p1, TPPLPoint& p2, TPPLPoint& p3);
@@ -246,16 +279,23 @@ class TPPLPartition {
         //helper functions for MonotonePartition
         bool Below(TPPLPoint &p1, TPPLPoint &p2);
         void AddDiagonal(MonotoneVertex *vertices, long *numvertices, long index1, long index2,
-            char *vertextypes, std::set<ScanLineEdge>::iterator *edgeTreeIterators,
-            std::set<ScanLineEdge> *edgeTree, long *helpers);
+            char *vertextypes, ScanLineEdgeTree::iterator *edgeTreeIterators,
+            ScanLineEdgeTree *edgeTree, long *helpers);
         
         //triangulates a monotone polygon, used in Triangulate_MONO
         int TriangulateMonotone(TPPLPoly *inPoly, TPPLPolyList *triangles);
         
+        //Hertel-Mehlhorn merging of a list of counter-clockwise triangles, used in ConvexPartition_MONO
+        int MergeTriangles(TPPLPolyList *triangles, TPPLPolyList *parts);
+        
     public:
+        TPPLPartition() = default;
+        TPPLPartition(const TPPLPartition &) = delete;
+        TPPLPartition& operator=(const TPPLPartition &) = delete;
         
         //simple heuristic procedure for removing holes from a list of polygons
         //works by creating a diagonal from the rightmost hole vertex to some visible vertex
+        //holes are merged in decreasing order of their rightmost vertex, which is computed once
         //time complexity: O(h*(n^2)), h is the number of holes, n is the number of vertices
         //space complexity: O(n)
         //params:
@@ -357,6 +397,33 @@ class TPPLPartition {
         //returns 1 on success, 0 on failure
         int ConvexPartition_HM(TPPLPolyList *inpolys, TPPLPolyList *parts);
         
+        //partitions a polygon into convex polygons by using Hertel-Mehlhorn algorithm
+        //on the triangulation obtained with Triangulate_MONO instead of ear clipping
+        //the triangles are linked by their shared edges in a half-edge structure,
+        //so each diagonal is tested and removed in constant time
+        //same bound of four times the optimal number of parts, though the parts differ from those of ConvexPartition_HM
+        //and there are usually a few more, as monotone triangulations have more slivers than ear clipping ones
+        //time complexity O(n*log(n)), n is the number of vertices
+        //space complexity: O(n)
+        //params:
+        //   poly : an input polygon to be partitioned
+        //          vertices have to be in counter-clockwise order
+        //   parts : resulting list of convex polygons
+        //returns 1 on success, 0 on failure
+        int ConvexPartition_MONO(TPPLPoly *poly, TPPLPolyList *parts);
+        
+        //partitions a list of polygons into convex parts by using Hertel-Mehlhorn algorithm
+        //on the triangulation obtained with Triangulate_MONO, which handles the holes directly
+        //time complexity O(n*log(n)), n is the number of vertices
+        //space complexity: O(n)
+        //params:
+        //   inpolys : an input list of polygons to be partitioned
+        //             vertices of all non-hole polys have to be in counter-clockwise order
+        //             vertices of all hole polys have to be in clockwise order
+        //   parts : resulting list of convex polygons
+        //returns 1 on success, 0 on failure
+        int ConvexPartition_MONO(TPPLPolyList *inpolys, TPPLPolyList *parts);
+        
         //optimal convex partitioning (in terms of number of resulting convex polygons)
         //using the Keil-Snoeyink algorithm
         //M. Keil, J. Snoeyink, "On the time bound for convex decomposition of simple polygons", 1998
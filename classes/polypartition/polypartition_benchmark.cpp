@@ -0,0 +1,126 @@
+//
+// Benchmark of the partition and triangulation algorithms on the polygons the components give them: laser contours
+// closed through the sensor, decimated as comp-one does before partitioning, and the map rectangle with the obstacles
+// as holes. The same TPPLPartition object is used for every call, as the components keep it.
+//
+//   g++ -std=c++20 -O2 polypartition_benchmark.cpp polypartition.cpp -o polypartition_benchmark
+//   ./polypartition_benchmark [repetitions]
+//
+
+#include "polypartition.h"
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// rectangular room with a few boxes, seen from random poses, keeping one beam in `step` and closed through the sensor
+std::vector<TPPLPoly> synthesize_contours(std::size_t num_scans, std::size_t beams, std::size_t step)
+{
+    std::mt19937 mt(1);
+    std::normal_distribution<double> noise(0., 10.);
+    std::uniform_real_distribution<double> pos(-1500., 1500.);
+    std::vector<TPPLPoly> polys;
+    for (std::size_t s = 0; s < num_scans; s++)
+    {
+        const double x0 = pos(mt), y0 = pos(mt);
+        std::vector<TPPLPoint> points;
+        for (std::size_t i = 0; i < beams; i += step)
+        {
+            const double a = -2. + 4. * i / (beams - 1);
+            const double sa = std::sin(a), ca = std::cos(a);
+            double d = 1e9;
+            if (sa > 0) d = std::min(d, (2500. - x0) / sa);
+            if (sa < 0) d = std::min(d, (-2500. - x0) / sa);
+            if (ca > 0) d = std::min(d, (2500. - y0) / ca);
+            if (ca < 0) d = std::min(d, (-2500. - y0) / ca);
+            if (std::fmod(a + 2., 0.5) < 0.12) d *= 0.6;     // boxes
+            d += noise(mt);
+            points.push_back(TPPLPoint{d * sa, d * ca, 0});
+        }
+        points.push_back(TPPLPoint{0., 0., 0});
+        TPPLPoly poly;
+        poly.Init((long)points.size());
+        for (std::size_t i = 0; i < points.size(); i++)
+            poly[(int)i] = points[i];
+        poly.SetOrientation(TPPL_CCW);
+        polys.push_back(poly);
+    }
+    return polys;
+}
+
+// world rectangle with a grid of square obstacles as holes
+TPPLPolyList synthesize_map(int rows, int cols)
+{
+    TPPLPolyList list;
+    TPPLPoly outer;
+    outer.Init(4);
+    outer[0] = TPPLPoint{-5000., -5000., 0}; outer[1] = TPPLPoint{5000., -5000., 0};
+    outer[2] = TPPLPoint{5000., 5000., 0};   outer[3] = TPPLPoint{-5000., 5000., 0};
+    outer.SetOrientation(TPPL_CCW);
+    list.push_back(outer);
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < cols; c++)
+        {
+            const double x = -4000. + 8000. * (c + 0.5) / cols + 37. * r, y = -4000. + 8000. * (r + 0.5) / rows + 23. * c;
+            TPPLPoly hole;
+            hole.Init(4);
+            hole[0] = TPPLPoint{x - 300., y - 200., 0}; hole[1] = TPPLPoint{x + 300., y - 200., 0};
+            hole[2] = TPPLPoint{x + 300., y + 200., 0}; hole[3] = TPPLPoint{x - 300., y + 200., 0};
+            hole.SetHole(true);
+            hole.SetOrientation(TPPL_CW);
+            list.push_back(hole);
+        }
+    return list;
+}
+
+void run(const std::string &name, int repetitions, std::size_t inputs, const std::function<int(std::size_t, TPPLPolyList &)> &f)
+{
+    using clock = std::chrono::steady_clock;
+    double time = 0;
+    std::size_t parts = 0, failed = 0;
+    for (int r = 0; r < repetitions; r++)
+        for (std::size_t i = 0; i < inputs; i++)
+        {
+            TPPLPolyList result;
+            auto t0 = clock::now();
+            const int ok = f(i, result);
+            time += std::chrono::duration<double, std::micro>(clock::now() - t0).count();
+            if (r == 0)
+            {
+                parts += result.size();
+                failed += ok == 0;
+            }
+        }
+    std::cout << name << time / (repetitions * inputs) << " us/call, " << parts << " parts, " << failed << " failed" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    const int repetitions = argc > 1 ? std::stoi(argv[1]) : 20;
+    TPPLPartition partition;
+    auto contours = synthesize_contours(200, 720, 12);
+    std::cout << contours.size() << " laser contours of " << contours.front().GetNumPoints() << " points" << std::endl;
+    run("ConvexPartition_HM:  ", repetitions, contours.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.ConvexPartition_HM(&contours[i], &out); });
+    run("ConvexPartition_MONO:", repetitions, contours.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.ConvexPartition_MONO(&contours[i], &out); });
+    run("Triangulate_EC:      ", repetitions, contours.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.Triangulate_EC(&contours[i], &out); });
+    run("Triangulate_MONO:    ", repetitions, contours.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.Triangulate_MONO(&contours[i], &out); });
+    run("Triangulate_OPT:     ", std::max(repetitions / 10, 1), contours.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.Triangulate_OPT(&contours[i], &out); });
+    run("ConvexPartition_OPT: ", std::max(repetitions / 10, 1), contours.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.ConvexPartition_OPT(&contours[i], &out); });
+
+    // full scans, as compute_laser_partitions gets them without decimation
+    auto scans = synthesize_contours(50, 720, 1);
+    std::cout << scans.size() << " laser contours of " << scans.front().GetNumPoints() << " points" << std::endl;
+    run("ConvexPartition_HM:  ", std::max(repetitions / 10, 1), scans.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.ConvexPartition_HM(&scans[i], &out); });
+    run("ConvexPartition_MONO:", repetitions, scans.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.ConvexPartition_MONO(&scans[i], &out); });
+    run("Triangulate_MONO:    ", repetitions, scans.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.Triangulate_MONO(&scans[i], &out); });
+
+    std::vector<TPPLPolyList> maps{synthesize_map(2, 3), synthesize_map(4, 5), synthesize_map(8, 8)};
+    std::cout << "maps with 6, 20 and 64 holes" << std::endl;
+    run("map ConvexPartition_HM:   ", repetitions, maps.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.ConvexPartition_HM(&maps[i], &out); });
+    run("map ConvexPartition_MONO: ", repetitions, maps.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.ConvexPartition_MONO(&maps[i], &out); });
+    run("map Triangulate_MONO:     ", repetitions, maps.size(), [&](std::size_t i, TPPLPolyList &out) { return partition.Triangulate_MONO(&maps[i], &out); });
+    return 0;
+}
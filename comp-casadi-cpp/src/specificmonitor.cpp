@@ -86,10 +86,22 @@ bool SpecificMonitor::sendParamsToWorker(RoboCompCommonBehavior::ParameterList p
 ///We need to supply a list of accepted values to each call
 void SpecificMonitor::readConfig(RoboCompCommonBehavior::ParameterList &params )
 {
-//	RoboCompCommonBehavior::Parameter aux;
-//	aux.editable = true;
+	RoboCompCommonBehavior::Parameter aux;
+	aux.editable = true;
 //	configGetString( "","InnerModelPath", aux.value, "nofile");
 //	params["InnerModelPath"] = aux;
+
+	configGetString( "","laser_noise", aux.value, "hard");
+	params["laser_noise"] = aux;
+
+	configGetString( "","laser_noise_seed", aux.value, "random");
+	params["laser_noise_seed"] = aux;
+
+	configGetString( "","partition", aux.value, "mono");
+	params["partition"] = aux;
+
+	configGetString( "","render_fps", aux.value, "25");
+	params["render_fps"] = aux;
 }
 
 //Check parameters and transform them to worker structure
@@ -44,6 +44,15 @@ SpecificWorker::~SpecificWorker()
 
 bool SpecificWorker::setParams(RoboCompCommonBehavior::ParameterList params)
 {
+    // simulated laser noise: profile and seed, "random" for a different one in each run
+    const auto seed = params.at("laser_noise_seed").value;
+    laser_noise.set_options(LaserNoise::Options{.profile = LaserNoise::profile_from_string(params.at("laser_noise").value),
+                                                .sigma = consts.laser_noise_sigma,
+                                                .hard_rays = consts.num_lidar_affected_rays_by_hard_noise,
+                                                .hard_divisor = 5.f,
+                                                .seed = seed == "random" ? std::random_device{}() : std::stoull(seed)});
+    partition_mode = params.at("partition").value == "hm" ? PartitionMode::HM : PartitionMode::MONO;
+    render_fps = std::stoi(params.at("render_fps").value);
 	return true;
 }
 
@@ -76,6 +85,15 @@ void SpecificWorker::initialize(int period)
                                 previous_control_of_solution.clear();
                             });
 
+        // viewer, drawn at its own rate from the frames left by compute()
+        if(render_fps > 0)
+        {
+            connect(&render_timer, &QTimer::timeout, this, &SpecificWorker::render);
+            render_timer.start(1000 / render_fps);
+        }
+        else
+            qInfo() << __FUNCTION__ << "Headless, nothing will be drawn";
+
         //timer.setSingleShot(true);
         timer.start(Period);
     }
@@ -92,8 +110,13 @@ void SpecificWorker::compute()
 
     // laser
     auto &&[laser_poly_robot, laser_poly_world, ldata] = read_laser(Eigen::Vector2d(current_pose.x, current_pose.z),
-                                                                    current_pose.alpha,
-                                                                    false);
+                                                                    current_pose.alpha);
+
+    // what this cycle leaves for the viewer
+    auto &frame = frames.back();
+    frame.clear();
+    frame.pose = current_pose;
+    frame.laser = laser_poly_robot;
     //auto laser_gaussians = fit_gaussians_to_laser(laser_poly_robot, current_pose, false);
     //std::vector<Gaussian> laser_gaussians;
 
@@ -107,9 +130,9 @@ void SpecificWorker::compute()
     {
         //Target s_target = sub_target(target, laser_poly_robot, ldata, Eigen::Vector2d(current_pose.x, current_pose.z), current_pose.alpha);
         Target s_target = target;
-        if (auto r = minimize_balls(s_target, current_pose_meters, ldata); r.has_value())
+        if (auto r = minimize_balls(s_target, current_pose_meters, laser_frame); r.has_value())
         {
-            robot_polygon->setBrush(QColor("Blue"));
+            frame.solved = true;
             auto [advance, rotation, solution, balls] = r.value();
             try
             {
@@ -119,7 +142,7 @@ void SpecificWorker::compute()
 
                 // draw
                 auto path = std::vector<double>(solution.value(pos));
-                draw_path(path, Eigen::Vector2d(current_pose.x, current_pose.z), current_pose.alpha, balls);
+                fill_path(path, Eigen::Vector2d(current_pose.x, current_pose.z), current_pose.alpha, balls, frame);
             }
             catch (...)
             { std::cout << "No solution found" << std::endl; }
@@ -127,7 +150,7 @@ void SpecificWorker::compute()
         else // do something to avoid go blind
         {
             move_robot(0, 0);
-            robot_polygon->setBrush(QColor("red"));
+            frame.solved = false;
             previous_values_of_solution.clear();
             previous_control_of_solution.clear();
         }
@@ -138,6 +161,7 @@ void SpecificWorker::compute()
         target.set_active(false);
         qInfo() << __FUNCTION__ << "Stopping";
     }
+    frames.publish();
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 SpecificWorker::Ball SpecificWorker::compute_free_ball(const Eigen::Vector2d &center, const std::vector<Eigen::Vector2d> &lpoints)
@@ -150,7 +174,7 @@ SpecificWorker::Ball SpecificWorker::compute_free_ball(const Eigen::Vector2d &ce
          return std::make_tuple(center, 1, Eigen::Vector2d());
 
     // compute the distance to all laser points for center and center +- dx, center +- dy
-    auto grad = [lpoints ](const Eigen::Vector2d &center) {
+    auto grad = [&lpoints](const Eigen::Vector2d &center) {
         auto dx = Eigen::Vector2d(0.1, 0.0);
         auto dy = Eigen::Vector2d(0.0, 0.1);
         auto min_dx_plus = std::ranges::min(lpoints, [c = center + dx](auto a, auto b) { return (a - c).norm() < (b - c).norm(); });
@@ -183,7 +207,7 @@ SpecificWorker::Ball SpecificWorker::compute_free_ball(const Eigen::Vector2d &ce
 }
 std::optional<std::tuple<double, double, casadi::OptiSol, SpecificWorker::Balls>> SpecificWorker::minimize_balls(const Target &my_target,
                                                                                     const Eigen::Vector3d &current_pose_meters,
-                                                                                    const RoboCompLaser::TLaserData &ldata)
+                                                                                    const LaserFrame &laser)
 {
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
     auto opti_local = opti.copy();
@@ -212,9 +236,8 @@ std::optional<std::tuple<double, double, casadi::OptiSol, SpecificWorker::Balls>
     opti.set_initial(slack_vector, slack_init);
 
     // add free balls constraints
-    std::vector<Eigen::Vector2d> lpoints(ldata.size());
-    for(auto &&[i, l] : ldata | iter::enumerate)
-        lpoints[i] = Eigen::Vector2d(l.dist*sin(l.angle)/1000.0, l.dist*cos(l.angle)/1000.0);
+    // laser points in meters
+    const auto &lpoints = laser.points_meters();
     Balls balls;
     balls.push_back(Ball{Eigen::Vector2d(0.0,0.0), 0.25, Eigen::Vector2d(0.2, 0.3)});  // first point on robot
     for (auto i: iter::range(0, consts.num_steps))
@@ -567,30 +590,20 @@ casadi::Opti SpecificWorker::initialize_differential(const int N)
 std::vector<SpecificWorker::Gaussian>
 SpecificWorker::fit_gaussians_to_laser(const QPolygonF &poly_laser_robot, const RoboCompGenericBase::TBaseState &bState, bool draw)
 {
-    static std::vector<QGraphicsItem *> balls;
-    static std::vector<QGraphicsItem *> elipses;
     std::vector<Gaussian> gaussians;
 
     const float log_thr = log(consts.gauss_value_for_point);
 
-    if(not balls.empty())
-        for(auto &b : balls) viewer_robot->scene.removeItem(b);
-    balls.clear();
-    if(not elipses.empty())
-        for(auto &b : elipses) viewer_robot->scene.removeItem(b);
-    elipses.clear();
-
     if(true)
     {
-        QPen tip_color_pen(QColor("DarkGreen"));
-        QBrush tip_color_brush(QColor("DarkGreen"));
-        for (const auto &l: poly_laser_robot)
-        {
-            QPointF pw(robot_polygon->mapToScene(QPointF(l.x(), l.y())));
-            balls.push_back(viewer_robot->scene.addEllipse(QRectF(pw.x()-100, pw.y()-100, 200, 200), tip_color_pen, tip_color_brush));
-        }
+        std::vector<QPointF> tips(poly_laser_robot.size());
+        for (auto &&[i, l]: iter::enumerate(poly_laser_robot))
+            tips[i] = robot_polygon->mapToScene(QPointF(l.x(), l.y()));
+        tips_layer.one(&viewer_robot->scene)->set_points(tips);
     }
 
+    gaussians_layer.begin(&viewer_robot->scene);
+
     for(auto &&par : iter::sliding_window(poly_laser_robot, 2))
     {
         const auto p1 = q2e(par[0]/1000.0);
@@ -617,12 +630,12 @@ SpecificWorker::fit_gaussians_to_laser(const QPolygonF &poly_laser_robot, const
             auto a_values = e_solver.eigenvalues();
             auto a_vectors = e_solver.eigenvectors();
             float d_angle = atan2(a_vectors.col(1)(1), a_vectors.col(1)(0));  // largest eigenvector
-            auto el_ptr = viewer_robot->scene.addEllipse(QRectF(-fabs(a_values(1) * 1000 * 1.5), -fabs(a_values(0) * 1000 * 1.5),
-                                                                3 * fabs(a_values(1) * 1000), 3 * fabs(a_values(0) * 1000)), QPen(QColor("blue"), 50));
+            auto el_ptr = gaussians_layer.next();
+            el_ptr->setRect(QRectF(-fabs(a_values(1) * 1000 * 1.5), -fabs(a_values(0) * 1000 * 1.5),
+                                   3 * fabs(a_values(1) * 1000), 3 * fabs(a_values(0) * 1000)));
             QPointF mean_w(robot_polygon->mapToScene(QPointF(mean.x() * 1000, mean.y() * 1000)));
             el_ptr->setPos(mean_w);
             el_ptr->setRotation(qRadiansToDegrees(d_angle) + qRadiansToDegrees(bState.alpha));
-            elipses.push_back(el_ptr);
         }
 
         // build return type
@@ -633,6 +646,7 @@ SpecificWorker::fit_gaussians_to_laser(const QPolygonF &poly_laser_robot, const
                                          casadi::MX::horzcat({iS(1,0), iS(1,1)})});
         gaussians.push_back(g);
     }
+    gaussians_layer.end();
     return gaussians;
 }
 SpecificWorker::Lines SpecificWorker::get_cube_lines(const Eigen::Vector2d &robot_tr, double robot_angle)
@@ -671,45 +685,21 @@ SpecificWorker::Target SpecificWorker::sub_target( const Target &target,
                                                    double robot_ang
                                                   )
 {
-    static QGraphicsRectItem *former_draw = nullptr;
-    if(former_draw != nullptr)
-        viewer_robot->scene.removeItem(former_draw);
+    subtarget_layer.hide(&viewer_robot->scene);
+
+    // locate openings. Tracked from scan to scan, so updated every cycle even if the target is in sight
+    gap_detector.update(ldata);
 
     // if target inside laser_polygon return
     auto target_in_robot = from_world_to_robot( target.to_eigen(), robot_tr_mm, robot_ang);
     if(poly.containsPoint(QPointF(target_in_robot.x(), target_in_robot.y()), Qt::WindingFill))
         return target;
 
-    // locate openings
-    std::vector<float> derivatives(ldata.size());
-    derivatives[0] = 0;
-    for (const auto &&[k, l]: iter::sliding_window(ldata, 2) | iter::enumerate)
-        derivatives[k + 1] = l[1].dist - l[0].dist;
-
-    // locate peaks
-    std::vector<Eigen::Vector2d> peaks;
-    for (const auto &&[k, der]: iter::enumerate(derivatives))
-        if (fabs(der) > consts.peak_threshold)
-        {
-            RoboCompLaser::TData l;
-            l = ldata.at(k - 1);
-            auto one = Eigen::Vector2d(l.dist * sin(l.angle), l.dist * cos(l.angle));
-            l = ldata.at(k);
-            auto two = Eigen::Vector2d(l.dist * sin(l.angle), l.dist * cos(l.angle));
-            peaks.push_back((one + two) / 2.f);
-//            Eigen::Vector2d m;
-//            if(one.norm() < two.norm()) m = one; else m = two;
-//            peaks.push_back(m);
-        }
-
-    // if no peaks return
-    if(peaks.empty())
+    // select closest opening to target, keeping the previous one if it is still close enough
+    auto gap = gap_detector.select(target_in_robot.cast<float>());
+    if(not gap.has_value())
         return target;
-
-    // select closest opening to robot
-    auto min = std::ranges::min_element(peaks, [target_in_robot](auto a, auto b)
-                    { return (target_in_robot-a).norm() < (target_in_robot-b).norm();});
-    auto candidate = *min;
+    Eigen::Vector2d candidate = gap->center.cast<double>();
 
     // if too close to subtarget ignore
     if( candidate.norm() < 200)
@@ -722,46 +712,39 @@ SpecificWorker::Target SpecificWorker::sub_target( const Target &target,
     // return target
     Target t;
     t.set_active(true);
-    auto pos = from_robot_to_world(*min, robot_tr_mm, robot_ang);
+    auto pos = from_robot_to_world(candidate, robot_tr_mm, robot_ang);
     t.set_pos(QPointF(pos.x(), pos.y()));
-    former_draw = viewer_robot->scene.addRect(t.get_pos().x()-100, t.get_pos().y()-100, 200, 200, QPen(QColor("blue")), QBrush(QColor("blue")));
+    subtarget_layer.one(&viewer_robot->scene)->setRect(t.get_pos().x()-100, t.get_pos().y()-100, 200, 200);
 
     return t;
 }
 //////////////////////////////////////// AUX /////////////////////////////////////////////////
 std::optional<Eigen::Vector2d> SpecificWorker::find_inside_target(const Eigen::Vector2d &target_in_robot,
-                                                                  const RoboCompLaser::TLaserData &ldata,
-                                                                  const QPolygonF &poly)
+                                                                  const PolylineIndex &laser)
 {
-    if(poly.containsPoint(e2q(target_in_robot), Qt::WindingFill))
+    const Eigen::Vector2f t = target_in_robot.cast<float>();
+    if(laser.contains(t))
         return {};
-    std::vector<std::tuple<Eigen::Vector2d, double, Eigen::ParametrizedLine<double, 2>>> candidates;
-    for(auto &&par : iter::sliding_window(ldata, 2))
-    {
-        Eigen::Vector2d p1(par[0].dist*sin(par[0].angle), par[0].dist*cos(par[0].angle));
-        Eigen::Vector2d p2(par[1].dist*sin(par[1].angle), par[1].dist*cos(par[1].angle));
-        double dist = (p1-p2).norm();
-        auto line = Eigen::ParametrizedLine<double, 2>::Through(p1, p2);
-        auto proj = line.projection(target_in_robot);
-        if(((proj-p1).norm() > dist) or ((proj-p2).norm() > dist))
-        {
-            if((proj-p1).norm()>(proj-p2).norm())
-                proj = p2;
-            else
-                proj = p1;
-        }
-        candidates.push_back(std::make_tuple(proj, (proj-target_in_robot).norm()/*line.squaredDistance(target_in_robot)*/, Eigen::ParametrizedLine<double, 2>::Through(target_in_robot, proj)));
-    }
-    qInfo() << __FUNCTION__ << candidates.empty() << candidates.size();
-    if(not candidates.empty())
+    // closest point of the laser contour, and 400mm beyond it along the line from the target
+    if(auto closest = laser.closest(t); closest.has_value() and closest->distance > 0)
     {
-        auto min_it = std::ranges::min_element(candidates, [](auto a, auto b){return std::get<1>(a) < std::get<1>(b);});
-        Eigen::Vector2d new_t = std::get<2>(*min_it).pointAt(std::get<double>(*min_it) + 400);
+        Eigen::Vector2d proj = closest->point.cast<double>();
+        Eigen::Vector2d new_t = target_in_robot + (proj - target_in_robot).normalized() * (closest->distance + 400);
         return new_t;
     }
     else
         return {};
 }
+const PolylineIndex &SpecificWorker::indexed_laser()
+{
+    // nothing is paid in the cycles without queries
+    if(laser_index_stale)
+    {
+        laser_index.build(laser_frame.x(), laser_frame.y(), laser_frame.angle());
+        laser_index_stale = false;
+    }
+    return laser_index;
+}
 Eigen::Vector2d SpecificWorker::from_robot_to_world(const Eigen::Vector2d &p, const Eigen::Vector2d &robot_tr, double robot_ang)
 {
     Eigen::Matrix2d matrix;
@@ -791,42 +774,27 @@ void SpecificWorker::move_robot(float adv, float rot, float side)
     catch(const Ice::Exception &e){ std::cout << e.what() << std::endl;}
 }
 std::tuple<QPolygonF, QPolygonF, RoboCompLaser::TLaserData> SpecificWorker::read_laser(const Eigen::Vector2d &robot_tr,
-                                                                                       double robot_angle,
-                                                                                       bool noise)
+                                                                                       double robot_angle)
 {
-    static std::random_device rd;
-    static std::mt19937 mt(rd());
-    static std::normal_distribution<double> normal_dist(0.0, consts.laser_noise_sigma);
-
     QPolygonF poly_robot, poly_world;
     RoboCompLaser::TLaserData ldata;
     try
     {
         ldata = laser_proxy->getLaserData();
 
-        // add radial noise la ldata
-        if(noise)
-            for(auto &l : ldata)
-                l.dist += normal_dist(mt);
-
-        // get n random angles to apply hard noise on them
-        static std::uniform_int_distribution<int> unif_dist(0, ldata.size());
-        for(int i: iter::range(consts.num_lidar_affected_rays_by_hard_noise))
-            ldata[unif_dist(mt)].dist /= 5;
+        // radial and hard noise, as set in the config
+        laser_noise.apply(ldata);
 
         // Simplify laser contour with Ramer-Douglas-Peucker
         //poly_robot = ramer_douglas_peucker(ldata, consts.max_RDP_deviation);
-        // Build raw polygon
-        for(auto &l : ldata)
-            poly_robot << QPointF(l.dist*sin(l.angle), l.dist*cos(l.angle));
-
-            // compute poly_world
-        poly_world.resize(poly_robot.size());
-        for (auto &&[i, p] : poly_robot | iter::enumerate)
-            poly_world[i] = e2q(from_robot_to_world(Eigen::Vector2d(p.x(), p.y()),  robot_tr, robot_angle));
+        // cartesian points, robot and world polygons, shared by the rest of the cycle
+        laser_frame.update(ldata);
+        laser_frame.set_pose(robot_tr.x(), robot_tr.y(), robot_angle);
+        poly_robot = laser_frame.polygon();
+        poly_world = laser_frame.external_polygon();
+        laser_index_stale = true;
 
         poly_robot << QPointF(0, 0);
-        draw_laser(poly_robot);
     }
     catch (const Ice::Exception &e) { std::cout << e.what() << std::endl; }
     return std::make_tuple(poly_robot, poly_world, ldata);
@@ -842,8 +810,6 @@ std::tuple<RoboCompGenericBase::TBaseState, Eigen::Vector3d> SpecificWorker::rea
         current_pose_meters[0] = current_pose.x / 1000;
         current_pose_meters[1] = current_pose.z / 1000;
         current_pose_meters[2] = current_pose.alpha;
-        robot_polygon->setRotation(current_pose.alpha * 180 / M_PI);
-        robot_polygon->setPos(current_pose.x, current_pose.z);
     }
     catch(const Ice::Exception &e){ qInfo() << "Error connecting to base"; std::cout << e.what() << std::endl;}
     return std::make_tuple(current_pose, current_pose_meters);
@@ -874,7 +840,6 @@ bool SpecificWorker::read_bill(const RoboCompGenericBase::TBaseState &bState)
 }
 SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &poly_robot)
 {
-    TPPLPartition partition;
     TPPLPoly poly_part;
     TPPLPolyList parts;
 
@@ -886,7 +851,12 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &p
         poly_part[i].y = l.y();
     }
     poly_part.SetOrientation(TPPL_CCW);
-    partition.ConvexPartition_HM(&poly_part, &parts);
+    // ear clipping is kept as the fallback if the monotone partition rejects the contour
+    if(partition_mode == PartitionMode::HM or not partition.ConvexPartition_MONO(&poly_part, &parts))
+    {
+        parts.clear();
+        partition.ConvexPartition_HM(&poly_part, &parts);
+    }
     //partition.ConvexPartition_OPT(&poly_part, &parts);
     //int r = partition.Triangulate_OPT(&poly_part, &parts);
     //qInfo() << __FUNCTION__ << "Ok: " << r << "Num vertices:" << poly_part.GetNumPoints() << "Num res polys: " << parts.size();
@@ -899,7 +869,7 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &p
 
         // generate QPolygons for drawing
         QPolygonF poly_draw(num_points);
-        std::generate(poly_draw.begin(), poly_draw.end(), [poly_res, k=0, robot = robot_polygon]() mutable
+        std::generate(poly_draw.begin(), poly_draw.end(), [&poly_res, k=0, robot = robot_polygon]() mutable
         {
             auto &p = poly_res.GetPoint(k++);
             return robot->mapToScene(QPointF(p.x, p.y));  //convert to world coordinates
@@ -907,7 +877,7 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &p
 
         // generate vector of <A,B,C> tuples
         Lines line(num_points);
-        std::generate(line.begin(), line.end(),[poly_res, k=0, num_points]() mutable
+        std::generate(line.begin(), line.end(),[&poly_res, k=0, num_points]() mutable
         {
             float x1 = poly_res.GetPoint(k).x /1000;
             float y1 = poly_res.GetPoint(k).y /1000;
@@ -922,24 +892,21 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &p
 }
 void SpecificWorker::draw_partitions(const Obstacles &obstacles, const QColor &color, bool print)
 {
-    static std::vector<QGraphicsPolygonItem *> polys_ptr{};
-    for (auto p: polys_ptr)
-        viewer_robot->scene.removeItem(p);
-    polys_ptr.clear();
-
     const QColor color_inside("LightBlue");
     const QColor color_outside("LightPink");
+    partitions_layer.begin(&viewer_robot->scene);
     for(auto &obs : obstacles)
     {
         bool inside = true;
         for (auto &[A, B, C] : std::get<Lines>(obs))
             inside = inside and C > 0; // since ABC were computed in the robot's coordinate frame
 
-        if (inside)
-            polys_ptr.push_back(viewer_robot->scene.addPolygon(std::get<QPolygonF>(obs), QPen(color_inside, 0), QBrush(color_inside)));
-        else
-            polys_ptr.push_back(viewer_robot->scene.addPolygon(std::get<QPolygonF>(obs), QPen(color, 0), QBrush(color_outside)));
+        auto poly = partitions_layer.next();
+        poly->setPolygon(std::get<QPolygonF>(obs));
+        poly->setPen(QPen(inside ? color_inside : color, 0));
+        poly->setBrush(inside ? color_inside : color_outside);
     }
+    partitions_layer.end();
     if(print)
     {
         qInfo() << "--------- LINES ------------";
@@ -958,53 +925,12 @@ QPolygonF SpecificWorker::ramer_douglas_peucker(const RoboCompLaser::TLaserData
         qWarning() << __FUNCTION__ << "Not enough points to simplify";
         return QPolygonF();
     }
-    std::vector<Point> pointList(ldata.size());
-    for (auto &&[i, l] : ldata | iter::enumerate)
-        pointList[i] = std::make_pair(l.dist * sin(l.angle), l.dist * cos(l.angle));
-    std::vector<Point> pointListOut;
-    ramer_douglas_peucker_rec(pointList, epsilon, pointListOut);
-    QPolygonF poly(pointListOut.size());
-    for (auto &&[i, p] : pointListOut | iter::enumerate)
-        poly[i] = QPointF(p.first, p.second);
+    const auto &kept = rdp.simplify_scan(ldata, epsilon);
+    QPolygonF poly(kept.size());
+    for (auto &&[k, i] : kept | iter::enumerate)
+        poly[k] = QPointF(rdp.points_x()[i], rdp.points_y()[i]);
     return poly;
 }
-void SpecificWorker::ramer_douglas_peucker_rec(const vector<Point> &pointList, double epsilon, std::vector<Point> &out)
-{
-    // Find the point with the maximum distance from line between start and end
-    auto line = Eigen::ParametrizedLine<float, 2>::Through(Eigen::Vector2f(pointList.front().first, pointList.front().second),
-                                                           Eigen::Vector2f(pointList.back().first, pointList.back().second));
-    auto max = std::max_element(pointList.begin()+1, pointList.end(), [line](auto &a, auto &b)
-        { return line.distance(Eigen::Vector2f(a.first, a.second)) < line.distance(Eigen::Vector2f(b.first, b.second));});
-
-    // If max distance is greater than epsilon, recursively simplify
-    float dmax =  line.distance(Eigen::Vector2f((*max).first, (*max).second));
-    if(dmax > epsilon)
-    {
-        // Recursive call
-        std::vector<Point> recResults1;
-        std::vector<Point> recResults2;
-        std::vector<Point> firstLine(pointList.begin(), max + 1);
-        std::vector<Point> lastLine(max, pointList.end());
-        ramer_douglas_peucker_rec(firstLine, epsilon, recResults1);
-        ramer_douglas_peucker_rec(lastLine, epsilon, recResults2);
-
-        // Build the result list
-        out.assign(recResults1.begin(), recResults1.end() - 1);
-        out.insert(out.end(), recResults2.begin(), recResults2.end());
-        if (out.size() < 2)
-        {
-            qWarning() << __FUNCTION__ << "Problem assembling output";
-            return;
-        }
-    }
-    else
-    {
-        //Just return start and end points
-        out.clear();
-        out.push_back(pointList.front());
-        out.push_back(pointList.back());
-    }
-}
 float SpecificWorker::gaussian(float x)
 {
     const double xset = consts.xset_gaussian;
@@ -1021,77 +947,51 @@ void SpecificWorker::new_target_slot(QPointF t)
 ////////////////////////////// DRAW ///////////////////////////////////
 void SpecificWorker::draw_laser(const QPolygonF &poly_world) // robot coordinates
 {
-    static QGraphicsItem *laser_polygon = nullptr;
-    if (laser_polygon != nullptr)
-        viewer_robot->scene.removeItem(laser_polygon);
-
-    QColor color("LightGreen");
-    color.setAlpha(40);
-    laser_polygon = viewer_robot->scene.addPolygon(laser_in_robot_polygon->mapToScene(poly_world), QPen(QColor("DarkGreen"), 30), QBrush(color));
-    laser_polygon->setZValue(3);
+    laser_layer.one(&viewer_robot->scene)->setPolygon(laser_in_robot_polygon->mapToScene(poly_world));
 }
-void SpecificWorker::draw_path(const std::vector<double> &path, const Eigen::Vector2d &tr_world, double my_rot, const Balls &balls)
+void SpecificWorker::fill_path(const std::vector<double> &path, const Eigen::Vector2d &tr_world, double my_rot, const Balls &balls, Frame &frame)
 {
-    static std::vector<QGraphicsItem *> path_paint, ball_paint, ball_grads, ball_centers;
-    static QString path_color = "Orange";
-    static QString ball_color = "LightBlue";
-
-    for(auto p : path_paint)
-        viewer_robot->scene.removeItem(p);
-    path_paint.clear();
-    for(auto p : ball_paint)
-        viewer_robot->scene.removeItem(p);
-    ball_paint.clear();
-    for(auto p : ball_grads)
-        viewer_robot->scene.removeItem(p);
-    ball_grads.clear();
-    for(auto p : ball_centers)
-        viewer_robot->scene.removeItem(p);
-    ball_centers.clear();
-
-    uint s = 100;
-    std::vector<Eigen::Vector2d> qpath(path.size()/2);
-    std::vector<Eigen::Vector2d> path_centers;
-    for(auto &&[i, p] : iter::chunked(path, 2) | iter::enumerate)
+    frame.path.clear();
+    for(auto &&p : iter::chunked(path, 2))
     {
         auto pw = from_robot_to_world(Eigen::Vector2d(p[0]*1000, p[1]*1000), tr_world, my_rot);  // in mm
-        path_centers.push_back(pw);
-        path_paint.push_back(viewer_robot->scene.addEllipse(pw.x()-s/2, pw.y()-s/2, s , s, QPen(path_color), QBrush(QColor(path_color))));
-        path_paint.back()->setZValue(30);
+        frame.path.push_back(e2q(pw));
     }
-    uint i=0;
-    auto balls_temp = balls;
-    balls_temp.erase(balls_temp.begin());
-    for(auto &[center, r, grad] : balls_temp)
-    {
-        auto bc = from_robot_to_world(center*1000, tr_world, my_rot);
-        auto nr = r * 1000;
-        ball_paint.push_back(viewer_robot->scene.addEllipse(bc.x()-nr, bc.y()-nr, nr*2 , nr*2, QPen(QBrush("DarkBlue"),15), QBrush(QColor(ball_color))));
-        ball_paint.back()->setZValue(15);
-        ball_paint.back()->setOpacity(0.07);
-
-        // grads
-        //auto p2 = from_robot_to_world(center*1000 + grad*100, tr_world, my_rot);
-        //ball_grads.push_back(viewer_robot->scene.addLine(bc.x(), bc.y(), p2.x(), p2.y(), QPen(QBrush("Magenta"), 20)));
-        if(i < path_centers.size())
-        {
-            ball_grads.push_back(viewer_robot->scene.addLine(path_centers[i].x(), path_centers[i].y(), bc.x(), bc.y(), QPen(QBrush("Magenta"), 20)));
-            i++;
-        }
-        //ball_grads.back()->setZValue(30);
 
-        // centers
-        //ball_centers.push_back(viewer_robot->scene.addEllipse(bc.x()-20, bc.y()-20, 40, 40, QPen(QColor("Magenta")), QBrush(QColor("Magenta"))));
-        //ball_centers.back()->setZValue(30);
+    // balls but the first one, and a line from each path point to its ball
+    frame.ball_centers.clear(); frame.ball_radii.clear(); frame.grads.clear();
+    for(std::size_t k = 1; k < balls.size(); k++)
+    {
+        auto &[center, r, grad] = balls[k];
+        frame.ball_centers.push_back(e2q(from_robot_to_world(center*1000, tr_world, my_rot)));
+        frame.ball_radii.push_back(r * 1000);
+        if(k-1 < frame.path.size())
+            frame.grads.emplace_back(frame.path[k-1], frame.ball_centers.back());
     }
-
+}
+void SpecificWorker::draw_path(const std::vector<QPointF> &path, const std::vector<QPointF> &centers, const std::vector<qreal> &radii,
+                               const std::vector<QLineF> &grads)
+{
+    path_layer.one(&viewer_robot->scene)->set_points(path);
+    balls_layer.one(&viewer_robot->scene)->set_circles(centers, radii);
+    grads_layer.one(&viewer_robot->scene)->set_lines(grads);
+}
+void SpecificWorker::render()
+{
+    // nothing new since the last one
+    if(not frames.fetch())
+        return;
+    const auto &f = frames.front();
+    robot_polygon->setRotation(f.pose.alpha * 180 / M_PI);
+    robot_polygon->setPos(f.pose.x, f.pose.z);
+    if(f.solved.has_value())
+        robot_polygon->setBrush(f.solved.value() ? QColor("Blue") : QColor("red"));
+    draw_laser(f.laser);
+    draw_path(f.path, f.ball_centers, f.ball_radii, f.grads);
 }
 void SpecificWorker::draw_target(const Target &target)
 {
-    static QGraphicsItem *target_rep = nullptr;
-    if (target_rep != nullptr)
-        viewer_robot->scene.removeItem(target_rep);
-    target_rep = viewer_robot->scene.addEllipse(target.get_pos().x()-100./2, target.get_pos().y()-100./2, 100. , 100., QPen("DarkRed"), QBrush(QColor("DarkRed")));
+    target_layer.one(&viewer_robot->scene)->setRect(target.get_pos().x()-100./2, target.get_pos().y()-100./2, 100. , 100.);
 }
 //////////////////////////////////////////////////////////////////////
 int SpecificWorker::startup_check()
@@ -1205,7 +1105,6 @@ int SpecificWorker::startup_check()
 // project target on closest laser perimeter point
 //     if(auto t = find_inside_target(from_world_to_robot( target.to_eigen(),
 //                                                         Eigen::Vector2d(current_pose.x, current_pose.z), current_pose.alpha),
-//                                                         ldata,
-//                                                         laser_poly_robot); t.has_value())
+//                                                         indexed_laser()); t.has_value())
 //         target.pos = e2q(from_robot_to_world(t.value(), Eigen::Vector2d(current_pose.x, current_pose.z), current_pose.alpha));
 //
\ No newline at end of file
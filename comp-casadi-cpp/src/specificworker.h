@@ -36,7 +36,14 @@
 #include <casadi/casadi.hpp>
 #include <casadi/core/optistack.hpp>
 #include <abstract_graphic_viewer/abstract_graphic_viewer.h>
-#include "polypartition.h"
+#include <polypartition/polypartition.h>
+#include <laser/rdp.h>
+#include <laser/laser_frame.h>
+#include <laser/noise.h>
+#include <laser/gaps.h>
+#include <laser/polyline_index.h>
+#include <graphics/scene_items.h>
+#include <graphics/triple_buffer.h>
 //#include <template_utilities/template_utilities.h>
 #include <Eigen/Eigenvalues>
 //#include <unsupported/Eigen/Splines>
@@ -57,6 +64,7 @@ public slots:
     int startup_check();
     void initialize(int period) override;
     void new_target_slot(QPointF);
+    void render();
 
 private:
 
@@ -96,7 +104,13 @@ private:
     inline Eigen::Vector2f q2e(const QPointF &p) const {return Eigen::Vector2f(p.x(), p.y());};
     Eigen::Vector2d from_robot_to_world(const Eigen::Vector2d &p, const Eigen::Vector2d &robot_tr, double robot_ang);
     Eigen::Vector2d from_world_to_robot(const Eigen::Vector2d &p, const Eigen::Vector2d &robot_tr, double robot_ang);
-    void draw_path(const std::vector<double> &path,  const Eigen::Vector2d &tr_world, double my_rot, const Balls &balls);
+    void draw_path(const std::vector<QPointF> &path, const std::vector<QPointF> &centers, const std::vector<qreal> &radii,
+                   const std::vector<QLineF> &grads);
+    // drawing layers, updated in place every cycle
+    ItemPool<PointsItem> path_layer{30, [](auto p){ p->set_style(100, QPen(QColor("Orange")), QBrush(QColor("Orange"))); }};
+    ItemPool<PointsItem> balls_layer{15, [](auto p)
+        { p->set_style(100, QPen(QBrush("DarkBlue"), 15), QBrush(QColor("LightBlue"))); p->setOpacity(0.07); }};
+    ItemPool<LinesItem> grads_layer{0, [](auto l){ l->set_pen(QPen(QBrush("Magenta"), 20)); }};
 
     // gaussians
     struct Gaussian
@@ -105,6 +119,8 @@ private:
         casadi::MX i_sigma;
     };
     std::vector<SpecificWorker::Gaussian> fit_gaussians_to_laser(const QPolygonF &poly_laser_robot, const RoboCompGenericBase::TBaseState &bState, bool draw);
+    ItemPool<PointsItem> tips_layer{0, [](auto p){ p->set_style(200, QPen(QColor("DarkGreen")), QBrush(QColor("DarkGreen"))); }};
+    ItemPool<QGraphicsEllipseItem> gaussians_layer{0, [](auto e){ e->setPen(QPen(QColor("blue"), 50)); }};
 
     // target
     struct Target
@@ -129,14 +145,21 @@ private:
     Target target;
 
     // convex parrtitions
-    using Point = std::pair<float, float>;  //only for RDP, change to QPointF
     using Lines = std::vector<std::tuple<float, float, float>>;
     using Obstacles = std::vector<std::tuple<Lines, QPolygonF>>;
-    std::optional<Eigen::Vector2d> find_inside_target(const Eigen::Vector2d &target_in_robot, const RoboCompLaser::TLaserData &ldata, const QPolygonF &poly);
+    std::optional<Eigen::Vector2d> find_inside_target(const Eigen::Vector2d &target_in_robot, const PolylineIndex &laser);
+    PolylineIndex laser_index;      // built on the first query after each scan, see indexed_laser()
+    bool laser_index_stale = true;
+    const PolylineIndex &indexed_laser();
     Obstacles compute_laser_partitions(QPolygonF &laser_poly);
+    TPPLPartition partition;    // kept between cycles to reuse its buffers
+    enum class PartitionMode {HM, MONO};    // ear clipping O(n²) or monotone O(n log n) triangulation, then merged
+    PartitionMode partition_mode = PartitionMode::MONO;
     QPolygonF ramer_douglas_peucker(const RoboCompLaser::TLaserData &ldata, double epsilon);
-    void ramer_douglas_peucker_rec(const vector<Point> &pointList, double epsilon, std::vector<Point> &out);
+    RamerDouglasPeucker rdp;
+    LaserFrame laser_frame;
     void draw_partitions(const Obstacles &obstacles, const QColor &color, bool print=false);
+    ItemPool<QGraphicsPolygonItem> partitions_layer;
 
     // casadi
     std::vector<double> previous_values_of_solution, previous_control_of_solution;
@@ -162,7 +185,7 @@ private:
 
     optional<tuple<double, double, casadi::OptiSol, Balls>> minimize_balls(const Target &my_target,
                                                                            const Eigen::Vector3d &current_pose_meters,
-                                                                           const RoboCompLaser::TLaserData &ldata);
+                                                                           const LaserFrame &laser);
     Ball compute_free_ball(const Eigen::Vector2d &center, const std::vector<Eigen::Vector2d> &lpoints);
 
     //robot
@@ -170,8 +193,11 @@ private:
     QGraphicsPolygonItem *robot_polygon;
     QGraphicsEllipseItem *laser_in_robot_polygon;
     void draw_laser(const QPolygonF &poly_robot);
+    ItemPool<QGraphicsPolygonItem> laser_layer{3, [](auto p)
+        { QColor color("LightGreen"); color.setAlpha(40); p->setPen(QPen(QColor("DarkGreen"), 30)); p->setBrush(color); }};
     std::tuple<RoboCompGenericBase::TBaseState, Eigen::Vector3d> read_base();
-    std::tuple<QPolygonF, QPolygonF, RoboCompLaser::TLaserData> read_laser(const Eigen::Vector2d &robot_tr, double robot_angle, bool noise=false);
+    std::tuple<QPolygonF, QPolygonF, RoboCompLaser::TLaserData> read_laser(const Eigen::Vector2d &robot_tr, double robot_angle);
+    LaserNoise laser_noise;
     float gaussian(float x);
 
 
@@ -182,13 +208,33 @@ private:
     bool read_bill(const RoboCompGenericBase::TBaseState &bState);
 
     void draw_target(const Target &target);
+    ItemPool<QGraphicsEllipseItem> target_layer{0, [](auto e){ e->setPen(QPen(QColor("DarkRed"))); e->setBrush(QColor("DarkRed")); }};
+    ItemPool<QGraphicsRectItem> subtarget_layer{0, [](auto r){ r->setPen(QPen(QColor("blue"))); r->setBrush(QColor("blue")); }};
     Target sub_target( const Target &target, const QPolygonF &poly,
                        const RoboCompLaser::TLaserData &ldata,
                        const Eigen::Vector2d &robot_tr_mm,
                        double robot_ang);
+    GapDetector gap_detector{GapDetector::Options{.threshold = consts.peak_threshold}};
 
     // Grid
     Grid grid;
 
+    // viewer. compute() leaves what has to be drawn in a frame and render() draws the last one at its own rate
+    struct Frame
+    {
+        RoboCompGenericBase::TBaseState pose;
+        QPolygonF laser;                        // robot coordinates
+        std::vector<QPointF> path;              // world coordinates from here on
+        std::vector<QPointF> ball_centers;
+        std::vector<qreal> ball_radii;
+        std::vector<QLineF> grads;
+        std::optional<bool> solved;             // whether the MPC found a solution, empty without target
+        void clear() { path.clear(); ball_centers.clear(); ball_radii.clear(); grads.clear(); solved.reset(); };
+    };
+    TripleBuffer<Frame> frames;
+    int render_fps = 25;                        // 0 for headless, nothing is drawn
+    QTimer render_timer;
+    void fill_path(const std::vector<double> &path, const Eigen::Vector2d &tr_world, double my_rot, const Balls &balls, Frame &frame);
+
 };
 #endif
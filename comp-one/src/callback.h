@@ -6,44 +6,109 @@
 #define COMPONE_CALLBACK_H
 
 #include "gurobi_c++.h"
+#include "ringbuffer.h"
+#include <functional>
+#include <array>
 
 class Callback: public GRBCallback
 {
     public:
+        // Early termination rules. Times are seconds since the solve started
+        struct Policy
+        {
+            double deadline = GRB_INFINITY;     // hard time budget
+            double gap = 0.1;                   // relative MIP gap
+            double stall = GRB_INFINITY;        // time without a new incumbent, once there is one
+            double max_nodes = 10000;           // explored nodes, once there is an incumbent
+        };
+        enum class Stop {NONE, DEADLINE, GAP, STALL, NODES, STALE};
+
+        // What is recorded for each solve. Fixed size so the callback never allocates
+        struct Telemetry
+        {
+            static constexpr std::size_t MAX_SAMPLES = 32;
+            struct GapSample { double time, gap; };
+            std::array<GapSample, MAX_SAMPLES> gap_curve;
+            std::size_t num_gap_samples = 0;
+            std::array<double, MAX_SAMPLES> incumbent_times;
+            std::size_t num_incumbents = 0;
+            int presolve_cols_removed = 0, presolve_rows_removed = 0;
+            double nodes = 0, runtime = 0, gap = GRB_INFINITY;
+            int status = 0;
+            Stop stop = Stop::NONE;
+        };
+
         double lastiter;
         double lastnode;
         int numvars;
         GRBVar* vars;
+        bool verbose = false;
+        Policy policy;
+        std::function<bool()> is_stale;     // when true the current solve is aborted, e.g. it was superseded by a newer snapshot
+        RingBuffer<Telemetry, 64> telemetry;    // written by the solver thread, read by compute()
+
         Callback(int xnumvars, GRBVar* xvars)
         {
             lastiter = lastnode = -GRB_INFINITY;
             numvars = xnumvars;
             vars = xvars;
         }
+        void begin_solve()
+        {
+            lastiter = lastnode = -GRB_INFINITY;
+            current = Telemetry();
+        }
+        // closes the record of the current solve and publishes it
+        const Telemetry &end_solve(GRBModel *model)
+        {
+            current.status = model->get(GRB_IntAttr_Status);
+            current.runtime = model->get(GRB_DoubleAttr_Runtime);
+            current.nodes = model->get(GRB_DoubleAttr_NodeCount);
+            if(model->get(GRB_IntAttr_SolCount) > 0)
+                current.gap = model->get(GRB_DoubleAttr_MIPGap);
+            telemetry.push(current);
+            return current;
+        }
+        Stop stop_reason() const { return current.stop; }
+
     protected:
+        Telemetry current;
+
+        void stop(Stop reason)
+        {
+            current.stop = reason;
+            abort();
+        }
         void callback ()
         {
             try {
+                if (is_stale and is_stale())
+                {
+                    stop(Stop::STALE);
+                    return;
+                }
                 if (where == GRB_CB_POLLING)
                 {
                     // Ignore polling callback
+                    return;
+                }
+                const double runtime = getDoubleInfo(GRB_CB_RUNTIME);
+                if (runtime > policy.deadline)
+                {
+                    stop(Stop::DEADLINE);
+                    return;
                 }
-                else if (where == GRB_CB_PRESOLVE)
+                if (where == GRB_CB_PRESOLVE)
                 {
                     // Presolve callback
-                    int cdels = getIntInfo(GRB_CB_PRE_COLDEL);
-                    int rdels = getIntInfo(GRB_CB_PRE_ROWDEL);
-                    if (cdels || rdels)
-                    {
-                        // cout << cdels << " columns and " << rdels
-                        //     << " rows are removed" << endl;
-                    }
+                    current.presolve_cols_removed = getIntInfo(GRB_CB_PRE_COLDEL);
+                    current.presolve_rows_removed = getIntInfo(GRB_CB_PRE_ROWDEL);
                 }
                 else if (where == GRB_CB_SIMPLEX)
                 {
                     // Simplex callback
                     double itcnt = getDoubleInfo(GRB_CB_SPX_ITRCNT);
-                    if (itcnt - lastiter >= 100)
+                    if (verbose and itcnt - lastiter >= 100)
                     {
                         lastiter = itcnt;
                         double obj = getDoubleInfo(GRB_CB_SPX_OBJVAL);
@@ -65,7 +130,7 @@ class Callback: public GRBCallback
                     double objbst = getDoubleInfo(GRB_CB_MIP_OBJBST);
                     double objbnd = getDoubleInfo(GRB_CB_MIP_OBJBND);
                     int solcnt = getIntInfo(GRB_CB_MIP_SOLCNT);
-                    if (nodecnt - lastnode >= 100)
+                    if (verbose and nodecnt - lastnode >= 100)
                     {
                         lastnode = nodecnt;
                         int actnodes = (int) getDoubleInfo(GRB_CB_MIP_NODLFT);
@@ -75,39 +140,36 @@ class Callback: public GRBCallback
                              << " " << objbst << " " << objbnd << " "
                              << solcnt << " " << cutcnt << endl;
                     }
-                    if (fabs(objbst - objbnd) < 0.1 * (1.0 + fabs(objbst)))
-                    {
-                        cout << "Stop early - 10% gap achieved" << endl;
-                        abort();
-                    }
-                    if (nodecnt >= 10000 && solcnt) {
-                        cout << "Stop early - 10000 nodes explored" << endl;
-                        abort();
-                    }
+                    if (solcnt == 0)
+                        return;
+                    // gap versus time, sampled when it changes
+                    const double gap = fabs(objbst - objbnd) / (1e-10 + fabs(objbst));
+                    auto &n = current.num_gap_samples;
+                    if (n < Telemetry::MAX_SAMPLES and (n == 0 or current.gap_curve[n-1].gap != gap))
+                        current.gap_curve[n++] = {runtime, gap};
+                    const double last_incumbent = current.num_incumbents > 0 ? current.incumbent_times[current.num_incumbents-1] : 0.0;
+                    if (fabs(objbst - objbnd) < policy.gap * (1.0 + fabs(objbst)))
+                        stop(Stop::GAP);
+                    else if (runtime - last_incumbent > policy.stall)
+                        stop(Stop::STALL);
+                    else if (nodecnt >= policy.max_nodes)
+                        stop(Stop::NODES);
                 }
                 else if (where == GRB_CB_MIPSOL)
                 {
                     // MIP solution callback
-                    int nodecnt = (int) getDoubleInfo(GRB_CB_MIPSOL_NODCNT);
-                    double obj = getDoubleInfo(GRB_CB_MIPSOL_OBJ);
-                    int solcnt = getIntInfo(GRB_CB_MIPSOL_SOLCNT);
-                    double* x = getSolution(vars, numvars);
-                    cout << "**** New solution at node " << nodecnt
-                         << ", obj " << obj << ", sol " << solcnt
-                         << ", x[0] = " << x[0] << " ****" << endl;
-                    delete[] x;
-                }
-                else if (where == GRB_CB_MIPNODE)
-                {
-                    // MIP node callback
-                    cout << "**** New node ****" << endl;
-                    if (getIntInfo(GRB_CB_MIPNODE_STATUS) == GRB_OPTIMAL) {
-                        double* x = getNodeRel(vars, numvars);
-                        setSolution(vars, x, numvars);
-                        delete[] x;
+                    if (current.num_incumbents < Telemetry::MAX_SAMPLES)
+                        current.incumbent_times[current.num_incumbents++] = runtime;
+                    if (verbose)
+                    {
+                        int nodecnt = (int) getDoubleInfo(GRB_CB_MIPSOL_NODCNT);
+                        double obj = getDoubleInfo(GRB_CB_MIPSOL_OBJ);
+                        int solcnt = getIntInfo(GRB_CB_MIPSOL_SOLCNT);
+                        cout << "**** New solution at node " << nodecnt
+                             << ", obj " << obj << ", sol " << solcnt << " ****" << endl;
                     }
                 }
-                else if (where == GRB_CB_BARRIER)
+                else if (where == GRB_CB_BARRIER and verbose)
                 {
                     // Barrier callback
                     int itcnt = getIntInfo(GRB_CB_BARRIER_ITRCNT);
@@ -119,11 +181,6 @@ class Callback: public GRBCallback
                     cout << itcnt << " " << primobj << " " << dualobj << " "
                          << priminf << " " << dualinf << " " << cmpl << endl;
                 }
-                else if (where == GRB_CB_MESSAGE)
-                {
-                    // Message callback
-                    string msg = getStringInfo(GRB_CB_MSG_STRING);
-                }
             } catch (GRBException e) {
                 cout << "Error number: " << e.getErrorCode() << endl;
                 cout << e.getMessage() << endl;
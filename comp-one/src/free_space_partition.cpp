@@ -0,0 +1,113 @@
+//
+// Convex decomposition of the free space of the static map, computed once in world coordinates
+//
+
+#include "free_space_partition.h"
+#include <polypartition/polypartition.h>
+#include <cppitertools/enumerate.hpp>
+#include <cppitertools/reversed.hpp>
+#include <algorithm>
+#include <cmath>
+
+bool FreeSpacePartition::set_map(const QRectF &world_, const std::vector<QPolygonF> &obstacles_)
+{
+    if (valid and world_ == world and obstacles_ == obstacles)
+        return false;
+    world = world_;
+    obstacles = obstacles_;
+    compute();
+    valid = true;
+    return true;
+}
+
+void FreeSpacePartition::compute()
+{
+    // external contour
+    QPolygonF pe(world);
+    pe.pop_back();
+    TPPLPoly external_poly;
+    external_poly.Init(pe.size());
+    for(auto &&[i, p] : iter::enumerate(iter::reversed(pe)))
+    {
+        external_poly[i].x = p.x();
+        external_poly[i].y = p.y();
+    }
+    external_poly.SetHole(false);
+    external_poly.SetOrientation(TPPL_CCW);
+    TPPLPolyList external_poly_list{ external_poly};
+
+    // map obstacles as holes
+    for(auto &poly : obstacles)
+    {
+        TPPLPoly hole;
+        hole.Init(poly.size());
+        for(auto &&[i, l] : iter::enumerate(iter::reversed(poly)))  // clock wise order of vertices
+        {
+            hole[i].x = l.x();
+            hole[i].y = l.y();
+        }
+        hole.SetHole(true);
+        external_poly_list.insert( external_poly_list.end(), hole );
+    }
+
+    TPPLPartition partition;
+    TPPLPolyList convex_result;
+    partition.ConvexPartition_HM(&external_poly_list, &convex_result);
+
+    regions.clear();
+    for(auto &poly_res : convex_result)
+    {
+        if(poly_res.IsHole())
+            continue;
+        // remove small polygons
+        const long num_points = poly_res.GetNumPoints();
+        double area = 0.0;
+        for(long i = 0, j = num_points-1; i < num_points; j = i++)
+            area += (poly_res[j].x + poly_res[i].x) * (poly_res[j].y - poly_res[i].y);
+        if(std::fabs(area) / 2 < MIN_AREA)
+            continue;
+
+        Region region;
+        region.polygon.resize(num_points);
+        region.lines.resize(num_points);
+        for(long k = 0; k < num_points; k++)
+        {
+            const auto &p1 = poly_res[k], &p2 = poly_res[(k + 1) % num_points];
+            region.polygon[k] = QPointF(p1.x, p1.y);
+            const double a = p1.y - p2.y, b = p2.x - p1.x;
+            const double norm = std::hypot(a, b);
+            region.lines[k] = std::make_tuple(a/norm, b/norm, -(a*p1.x + b*p1.y)/norm);
+        }
+        region.box = region.polygon.boundingRect();
+        regions.emplace_back(std::move(region));
+    }
+}
+
+FreeSpacePartition::Obstacles FreeSpacePartition::robot_frame(const QTransform &robot_to_world, float roi) const
+{
+    // a world line A x + B y + C = 0, with world = M robot + t, is (A M11 + B M12) x + (A M21 + B M22) y + (A dx + B dy + C) = 0
+    // in the robot frame. M is a rotation, so the normal keeps its length
+    const QPointF robot = robot_to_world.map(QPointF(0, 0));
+    const float m11 = robot_to_world.m11(), m12 = robot_to_world.m12(), m21 = robot_to_world.m21(), m22 = robot_to_world.m22();
+    const float dx = robot_to_world.dx(), dy = robot_to_world.dy();
+    Obstacles obstacles;
+    obstacles.reserve(regions.size());
+    for(const auto &region : regions)
+    {
+        if(roi > 0.f)
+        {
+            const float ox = std::max({region.box.left() - robot.x(), 0.0, robot.x() - region.box.right()});
+            const float oy = std::max({region.box.top() - robot.y(), 0.0, robot.y() - region.box.bottom()});
+            if(ox*ox + oy*oy > roi*roi)
+                continue;
+        }
+        Lines lines(region.lines.size());
+        for(auto &&[k, l] : iter::enumerate(region.lines))
+        {
+            const auto &[a, b, c] = l;
+            lines[k] = std::make_tuple(a*m11 + b*m12, a*m21 + b*m22, a*dx + b*dy + c);
+        }
+        obstacles.emplace_back(std::move(lines), region.polygon);
+    }
+    return obstacles;
+}
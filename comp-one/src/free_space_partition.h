@@ -0,0 +1,44 @@
+//
+// Convex decomposition of the free space of the static map: the world rectangle minus the map obstacles. It is computed
+// once in world coordinates and kept until the map changes. Each cycle the line equations of the regions are moved to the
+// robot frame with the robot transform, three products per line, and regions too far from the robot can be left out
+//
+
+#ifndef COMPONE_FREE_SPACE_PARTITION_H
+#define COMPONE_FREE_SPACE_PARTITION_H
+
+#include <QPolygonF>
+#include <QRectF>
+#include <QTransform>
+#include <tuple>
+#include <vector>
+
+class FreeSpacePartition
+{
+    public:
+        using Lines = std::vector<std::tuple<float, float, float>>;     // A x + B y + C = 0, with A² + B² = 1
+        using Obstacles = std::vector<std::tuple<Lines, QPolygonF>>;    // lines in robot frame, polygon in world frame
+
+        // recomputes the decomposition only if the map is not the one of the previous call. Returns true if it did
+        bool set_map(const QRectF &world, const std::vector<QPolygonF> &obstacles);
+        // regions with their lines in the robot frame. robot_to_world is the robot pose, e.g. the robot item sceneTransform().
+        // With roi > 0, regions whose bounding box is farther than roi mm from the robot are left out
+        Obstacles robot_frame(const QTransform &robot_to_world, float roi = 0.f) const;
+        std::size_t size() const                { return regions.size(); };
+
+    private:
+        static constexpr float MIN_AREA = 250000;     // mm². Smaller regions are dropped
+        struct Region
+        {
+            Lines lines;                // world frame
+            QPolygonF polygon;          // world frame
+            QRectF box;
+        };
+        std::vector<Region> regions;
+        QRectF world;
+        std::vector<QPolygonF> obstacles;
+        bool valid = false;
+        void compute();
+};
+
+#endif //COMPONE_FREE_SPACE_PARTITION_H
@@ -0,0 +1,37 @@
+//
+// Single-slot, lock-free mailbox. The writer always replaces the content, so the reader only ever sees
+// the latest value. Used to hand snapshots to the optimizer thread and solutions back to compute()
+//
+
+#ifndef COMPONE_MAILBOX_H
+#define COMPONE_MAILBOX_H
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+template <typename T>
+class Mailbox
+{
+    public:
+        Mailbox() = default;
+        Mailbox(const Mailbox &) = delete;
+        Mailbox& operator=(const Mailbox &) = delete;
+        ~Mailbox()                                  { delete slot.exchange(nullptr); };
+
+        // overwrites any value not yet consumed
+        void put(T &&value)                         { delete slot.exchange(new T(std::move(value)), std::memory_order_acq_rel); };
+        void put(const T &value)                    { delete slot.exchange(new T(value), std::memory_order_acq_rel); };
+        std::optional<T> try_get()
+        {
+            std::unique_ptr<T> p(slot.exchange(nullptr, std::memory_order_acq_rel));
+            if(p == nullptr) return {};
+            return std::move(*p);
+        };
+        bool empty() const                          { return slot.load(std::memory_order_acquire) == nullptr; };
+
+    private:
+        std::atomic<T*> slot{nullptr};
+};
+
+#endif //COMPONE_MAILBOX_H
@@ -0,0 +1,46 @@
+//
+// Bounded single-producer/single-consumer ring buffer without locks. When full, push() drops the new
+// element and counts it, so the producer (the solver thread) never waits for the consumer
+//
+
+#ifndef COMPONE_RINGBUFFER_H
+#define COMPONE_RINGBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <optional>
+
+template <typename T, std::size_t N>
+class RingBuffer
+{
+    static_assert((N & (N-1)) == 0, "RingBuffer capacity must be a power of two");
+    public:
+        bool push(const T &value)
+        {
+            const auto head = write_idx.load(std::memory_order_relaxed);
+            if(head - read_idx.load(std::memory_order_acquire) == N)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            buffer[head & (N-1)] = value;
+            write_idx.store(head + 1, std::memory_order_release);
+            return true;
+        };
+        std::optional<T> pop()
+        {
+            const auto tail = read_idx.load(std::memory_order_relaxed);
+            if(tail == write_idx.load(std::memory_order_acquire))
+                return {};
+            T value = buffer[tail & (N-1)];
+            read_idx.store(tail + 1, std::memory_order_release);
+            return value;
+        };
+        std::size_t num_dropped() const             { return dropped.load(std::memory_order_relaxed); };
+
+    private:
+        std::array<T, N> buffer;
+        std::atomic<std::size_t> write_idx{0}, read_idx{0}, dropped{0};
+};
+
+#endif //COMPONE_RINGBUFFER_H
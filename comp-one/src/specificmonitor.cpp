@@ -90,6 +90,28 @@ void SpecificMonitor::readConfig(RoboCompCommonBehavior::ParameterList &params )
 	aux.editable = true;
 	configGetString( "","InnerModelPath", aux.value, "nofile");
 	params["InnerModelPath"] = aux;
+	configGetString( "","Formulation", aux.value, "GENERAL");
+	params["Formulation"] = aux;
+	configGetString( "","Footprint", aux.value, "POINTS");
+	params["Footprint"] = aux;
+	configGetString( "","Partition", aux.value, "MONO");
+	params["Partition"] = aux;
+	configGetString( "","SolveDeadline", aux.value, "");
+	params["SolveDeadline"] = aux;
+	configGetString( "","SolveGap", aux.value, "0.1");
+	params["SolveGap"] = aux;
+	configGetString( "","SolveStall", aux.value, "");
+	params["SolveStall"] = aux;
+	configGetString( "","SolveMaxNodes", aux.value, "10000");
+	params["SolveMaxNodes"] = aux;
+	configGetString( "","TelemetryFile", aux.value, "");
+	params["TelemetryFile"] = aux;
+	configGetString( "","RecordScenes", aux.value, "");
+	params["RecordScenes"] = aux;
+	configGetString( "","BenchmarkScenes", aux.value, "");
+	params["BenchmarkScenes"] = aux;
+	configGetString( "","RenderFPS", aux.value, "25");
+	params["RenderFPS"] = aux;
 }
 
 //Check parameters and transform them to worker structure
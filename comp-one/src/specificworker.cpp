@@ -24,6 +24,7 @@
 #include <cppitertools/reversed.hpp>
 #include <cppitertools/filter.hpp>
 #include <chrono>
+#include <fstream>
 
 using namespace std::literals;
 
@@ -42,6 +43,9 @@ SpecificWorker::SpecificWorker(TuplePrx tprx, bool startup_check) : GenericWorke
 SpecificWorker::~SpecificWorker()
 {
     //delete env;
+    stop_optimizer = true;
+    if(opt_thread.joinable())
+        opt_thread.join();
 	std::cout << "Destroying SpecificWorker" << std::endl;
 }
 
@@ -55,6 +59,38 @@ bool SpecificWorker::setParams(RoboCompCommonBehavior::ParameterList params)
 
 	}
 	catch(const std::exception &e) { qFatal("Error reading config params"); }
+
+    // optional MIQP formulation and scene recording/benchmarking
+    if(auto f = params.find("Formulation"); f != params.end())
+    {
+        if(f->second.value == "BIG_M") formulation = Formulation::BIG_M;
+        else if(f->second.value == "CONVEX_HULL") formulation = Formulation::CONVEX_HULL;
+        else formulation = Formulation::GENERAL;
+    }
+    if(auto f = params.find("Footprint"); f != params.end())
+        footprint = f->second.value == "MINKOWSKI" ? Footprint::MINKOWSKI : Footprint::POINTS;
+    if(auto f = params.find("Partition"); f != params.end())
+        partition_mode = f->second.value == "HM" ? PartitionMode::HM : PartitionMode::MONO;
+    // early termination of each solve. Empty means no limit
+    auto read_limit = [&params](const std::string &name, double &value)
+            { if(auto f = params.find(name); f != params.end() and not f->second.value.empty()) value = std::stod(f->second.value); };
+    read_limit("SolveDeadline", solve_policy.deadline);
+    read_limit("SolveGap", solve_policy.gap);
+    read_limit("SolveStall", solve_policy.stall);
+    read_limit("SolveMaxNodes", solve_policy.max_nodes);
+    // a solve is superseded once its snapshot has outlived the solve budget, or the plan age if there is none
+    if(solve_policy.deadline < GRB_INFINITY)
+        max_snapshot_age = std::chrono::milliseconds(static_cast<long>(solve_policy.deadline * 1000));
+    else
+        max_snapshot_age = MAX_PLAN_AGE;
+    if(auto f = params.find("TelemetryFile"); f != params.end())
+        telemetry_file = f->second.value;
+    if(auto f = params.find("RecordScenes"); f != params.end())
+        record_scenes_file = f->second.value;
+    if(auto f = params.find("BenchmarkScenes"); f != params.end())
+        benchmark_scenes_file = f->second.value;
+    if(auto f = params.find("RenderFPS"); f != params.end() and not f->second.value.empty())
+        render_fps = std::stoi(f->second.value);
 	return true;
 }
 
@@ -80,9 +116,28 @@ void SpecificWorker::initialize(int period)
     // model
     read_base();
     auto laser_poly = read_laser();
+    if(not benchmark_scenes_file.empty())
+    {
+        benchmark_formulations(benchmark_scenes_file);
+        QTimer::singleShot(200, qApp, SLOT(quit()));
+        return;
+    }
     initialize_model(StateVector(0,0,0));
+    callback = new Callback(model->get(GRB_IntAttr_NumVars), model->getVars());
+    callback->policy = solve_policy;
+    model->setCallback(callback);
+    opt_thread = std::thread(&SpecificWorker::optimizer_loop, this);
 
-    this->Period = 0;
+    // viewer, drawn at its own rate from the frames left by compute()
+    if(render_fps > 0)
+    {
+        connect(&render_timer, &QTimer::timeout, this, &SpecificWorker::render);
+        render_timer.start(1000 / render_fps);
+    }
+    else
+        qInfo() << __FUNCTION__ << "Headless, nothing will be drawn";
+
+    this->Period = CONTROL_PERIOD;
 	if(this->startup_check_flag)
 		this->startup_check();
 	else
@@ -92,20 +147,22 @@ void SpecificWorker::initialize(int period)
 void SpecificWorker::compute()
 {
     static std::vector<QPointF> path(NUM_STEPS, QPoint(0,0));
-    static bool solution_achieved = true;
-    static std::chrono::time_point<std::chrono::high_resolution_clock> t;
-    static std::future<void> future_result;
-
+    static std::optional<Solution> plan;
 
     auto bState = read_base();
     auto [laser_poly, laser_data] = read_laser();  // returns poly in robot coordinates
-    draw_laser(laser_poly);
+
+    // what this cycle leaves for the viewer
+    auto &frame = frames.back();
+    frame.laser = robot_polygon->mapToScene(laser_poly);
+    frame.path.clear();
+    frame.sample.reset();
     //auto laser_free_regions = compute_laser_partitions(laser_poly);
     auto external_free_regions = compute_external_partitions(dim, map_obstacles, laser_poly, robot_polygon);
     std::vector<tuple<Lines, QPolygonF>> free_regions;
     // free_regions.insert(free_regions.begin(), laser_free_regions.begin(), laser_free_regions.end());
     free_regions.insert(free_regions.begin(), external_free_regions.begin(), external_free_regions.end());
-    draw_partitions(free_regions, QColor("Magenta"),false);
+    frame.partitions = free_regions;
 
     // fill_grid(laser_poly);
 
@@ -115,6 +172,7 @@ void SpecificWorker::compute()
         //set target
         target.setX(t.value().x()); target.setY(t.value().y());
         draw_target(bState, t.value());
+        plan.reset();
     }
     if(not atTarget)
     {
@@ -127,72 +185,42 @@ void SpecificWorker::compute()
             stop_robot();
         else
         {
-            // if(solution_achieved)
-            // {
-            //     //qInfo() << __FUNCTION__ << "new call to async";
-            //     t = std::chrono::high_resolution_clock::now();
-            //     future_result = std::async(std::launch::async, &SpecificWorker::optimize,
-            //                                this, StateVector(rtarget.x(), rtarget.z(), target_ang),
-            //                                free_regions, path);
-            //     solution_achieved = false;
-            // }
-            // if(future_result.wait_for(std::chrono::milliseconds(200)) != std::future_status::ready)
-            // {   // move the robot along previous path or stop it if none
-            //     if( not path.empty() )
-            //     {
-            //         local_controller(path, laser_data, QPointF(bState.x, bState.z), QPointF(rtarget.x(), rtarget.z()));
-            //         //omnirobot_proxy->setSpeedBase(side_vel, adv_vel, rot_vel);
-            //     }
-            //     else
-            //     {
-            //         omnirobot_proxy->setSpeedBase(0, 0, 0);
-            //         qInfo() << __FUNCTION__ << "Not path ready yet";
-            //     }
-            // }
-            // else //move with new controller
+            // hand the latest scene to the optimizer thread. This loop never waits for the MIQP
+            const auto region = robot_polygon->mapFromScene(QPolygonF(QRectF(dim.HMIN, dim.VMIN, dim.WIDTH, dim.HEIGHT)));
+            const auto target_state = StateVector(rtarget.x(), rtarget.z(), target_ang);
+            if(not record_scenes_file.empty())
+                record_scene(target_state, free_regions, region);
+            snapshots.put(Snapshot{std::chrono::steady_clock::now(), target_state, std::move(free_regions), region,
+                                   robot_polygon->sceneTransform(), path});
+
+            auto now = std::chrono::steady_clock::now();
+            if(auto s = solutions.try_get(); s.has_value())
             {
-                auto now = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - t).count();
-                //std::cout << __FUNCTION__ << " Completed in " << duration << " ms" << std::endl;
-                optimize(StateVector(rtarget.x(), rtarget.z(), target_ang), free_regions, path);
-                solution_achieved = true;
-                int status = model->get(GRB_IntAttr_Status);
-                if (status != GRB_OPTIMAL)
+                if (not s->valid)
+                    qInfo() << __FUNCTION__ << "Result status:" << s->status;
+                else    // move with the new plan
                 {
-                    //omnirobot_proxy->setSpeedBase(0, 0, 0);
-                    //local_controller(path, laser_data, QPointF(bState.x, bState.z), QPointF(rtarget.x(), rtarget.z()));
-                    qInfo() << __FUNCTION__ << "Result status:" << status;
-                }
-                else
-                {
-                    float x = control_vars[0].get(GRB_DoubleAttr_X);
-                    float y = control_vars[1].get(GRB_DoubleAttr_X);
-                    float a = control_vars[2].get(GRB_DoubleAttr_X);
-
-                    path.clear();
-                    path = compute_path();
-                    local_controller(y, x, a, laser_data);
-                    qInfo() << __FUNCTION__ << "Control " << x << y << a;
-                    // for(uint e=FIRST_NEAR; e<=LAST_NEAR; e++)
-                    // {
-                    //     qDebug()<<"control near"<<e<<control_vars[e*CONTROL_DIM].get(GRB_DoubleAttr_X)<<control_vars[e*CONTROL_DIM+1].get(GRB_DoubleAttr_X)<<control_vars[e*CONTROL_DIM+2].get(GRB_DoubleAttr_X);
-                    //     qDebug()<<"state near"<<e<<state_vars[e*STATE_DIM].get(GRB_DoubleAttr_X)<<state_vars[e*STATE_DIM+1].get(GRB_DoubleAttr_X)<<state_vars[e*STATE_DIM+2].get(GRB_DoubleAttr_X);
-                    // }
-                    // for(uint e=FIRST_FAR; e<=LAST_FAR; e++)
-                    // {
-                    //     qDebug()<<"control far"<<e<<control_vars[e*CONTROL_DIM].get(GRB_DoubleAttr_X)<<control_vars[e*CONTROL_DIM+1].get(GRB_DoubleAttr_X)<<control_vars[e*CONTROL_DIM+2].get(GRB_DoubleAttr_X);
-                    //     qDebug()<<"state far"<<e<<state_vars[e*STATE_DIM].get(GRB_DoubleAttr_X)<<state_vars[e*STATE_DIM+1].get(GRB_DoubleAttr_X)<<state_vars[e*STATE_DIM+2].get(GRB_DoubleAttr_X);
-                    // }
-
-                    // draw
-                    auto now = std::chrono::high_resolution_clock::now();
-                    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - t).count();
-                    draw_signals(ControlVector(x, y, a), pos_error, rot_error, duration);
+                    plan = std::move(s);
+                    path = plan->path;
+                    const auto &control = plan->control;
+                    local_controller(control.y(), control.x(), control[2], laser_data);
+                    qInfo() << __FUNCTION__ << "Control " << control.x() << control.y() << control[2];
+                    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - plan->stamp).count();
+                    frame.sample = Frame::Sample{control, (float)pos_error, (float)rot_error, (float)duration};
                 }
             }
-            draw_path(path);
+            else if (plan.has_value() and now - plan->stamp < MAX_PLAN_AGE)  // keep tracking the last valid plan
+                local_controller(path, laser_data, QPointF(bState.x, bState.z), target);
+            else
+            {
+                omnirobot_proxy->setSpeedBase(0, 0, 0);
+                qInfo() << __FUNCTION__ << "Not path ready yet";
+            }
+            frame.path = path;
         }
     }
+    frames.publish();
+    read_telemetry();
 }
 
 void SpecificWorker::local_controller( const std::vector<QPointF> &path, const RoboCompLaser::TLaserData &laser_data,
@@ -334,8 +362,9 @@ void SpecificWorker::initialize_model(const StateVector &target)
     // model->addConstr(state_vars[(NUM_STEPS - 1) * STATE_DIM] == target.x(), "c1x");
     // model->addConstr(state_vars[(NUM_STEPS - 1) * STATE_DIM + 1] == target.y(), "c1y");
     // model->addConstr(state_vars[(NUM_STEPS / 4) * STATE_DIM + 2] == target[2], "c1a");
-    model->addConstr(state_vars[(FIRST_FAR+LAST_FAR)/3 * STATE_DIM + 2] == target[2], "c1aF");
-    model->addConstr(state_vars[(LAST_NEAR+1) * STATE_DIM + 2] == state_vars[(FIRST_FAR+1) * STATE_DIM + 2], "c1aN");
+    // target angle is updated through the RHS of c1aF in optimize()
+    target_angle_constr = model->addConstr(state_vars[(FIRST_FAR+LAST_FAR)/2 * STATE_DIM + 2] == target[2], "c1aF");
+    model->addConstr(state_vars[(FIRST_NEAR+1) * STATE_DIM + 2] == state_vars[(FIRST_FAR+1) * STATE_DIM + 2], "c1aN");
 
     // model dynamics constraint x = Ax + Bu
     for (uint e = 0; e < NUM_STEPS - 1; e++)
@@ -362,14 +391,39 @@ void SpecificWorker::initialize_model(const StateVector &target)
 
     }
 
-    // Quadratic expression to be minimized as the sum of the squared modules of all controls
-    //for(auto &&e : iter::chunked(iter::slice(control_vars, 0, NUM_STEPS-1), 3))
-//    for (uint e = 0; e < NUM_STEPS - 1; e++)
-//    {
-//        this->obj += control_vars[e * CONTROL_DIM] * control_vars[e * CONTROL_DIM] * 0.002;     // compensation factors as de R matrix
-//        this->obj += control_vars[e * CONTROL_DIM + 1] * control_vars[e * CONTROL_DIM + 1] * 0.002;
-//        this->obj += control_vars[e * CONTROL_DIM + 2] * control_vars[e * CONTROL_DIM + 2];
-//    }
+    // Quadratic part of the objective. It does not depend on the target, so it is set once here and
+    // optimize() only rewrites the linear coefficients of the far states: (x-tx)^2 = x^2 - 2*tx*x + tx^2
+    this->obj = GRBQuadExpr();
+    for (uint e = FIRST_FAR+1; e < LAST_FAR ; e++)
+    {
+        this->obj += control_vars[e * CONTROL_DIM] * control_vars[e * CONTROL_DIM] * 0.1;
+        this->obj += control_vars[e * CONTROL_DIM + 1] * control_vars[e * CONTROL_DIM + 1] * 0.1;
+        this->obj += control_vars[e * CONTROL_DIM + 2] * control_vars[e * CONTROL_DIM + 2];  // angular modulus
+    }
+    for (uint e = FIRST_NEAR+1; e < LAST_FAR ; e++)
+    {
+        this->obj += control_vars[e * CONTROL_DIM] * control_vars[e * CONTROL_DIM] * 0.1;
+        this->obj += control_vars[e * CONTROL_DIM + 1] * control_vars[e * CONTROL_DIM + 1] * 0.1;
+        this->obj += control_vars[e * CONTROL_DIM + 2] * control_vars[e * CONTROL_DIM + 2];  // angular modulus
+    }
+    for (uint e = FIRST_FAR; e < LAST_FAR-1 ; e++)
+    {
+        this->obj += (control_vars[e * CONTROL_DIM] - control_vars[(e+1) * CONTROL_DIM]) * (control_vars[e * CONTROL_DIM] - control_vars[(e+1) * CONTROL_DIM]);
+        this->obj += (control_vars[e * CONTROL_DIM + 1] - control_vars[(e+1) * CONTROL_DIM + 1 ]) * (control_vars[e * CONTROL_DIM +1] - control_vars[(e+1) * CONTROL_DIM + 1]);
+    }
+    for (uint e = FIRST_NEAR; e <= LAST_NEAR ; e++)
+    {
+        this->obj += (state_vars[e * STATE_DIM] - state_vars[(FIRST_FAR+1) * STATE_DIM]) * (state_vars[e * STATE_DIM] - state_vars[(FIRST_FAR+1) * STATE_DIM]); // x state modulus
+        this->obj += (state_vars[e * STATE_DIM + 1] - state_vars[(FIRST_FAR+1) * STATE_DIM+1]) * (state_vars[e * STATE_DIM + 1] - state_vars[(FIRST_FAR+1) * STATE_DIM +1 ]); // y state modulus
+    }
+    for (uint e = FIRST_FAR; e <= LAST_FAR ; e++)
+    {
+        this->obj += state_vars[e * STATE_DIM] * state_vars[e * STATE_DIM];
+        this->obj += state_vars[e * STATE_DIM + 1] * state_vars[e * STATE_DIM + 1];
+    }
+    model->setObjective(obj, GRB_MINIMIZE);
+
+    initialize_free_space_constraints();
     model->update();
     //model->set(GRB_DoubleParam_TimeLimit, 1.0);
 
@@ -379,124 +433,263 @@ void SpecificWorker::initialize_model(const StateVector &target)
     //model->setCallback(callback);
 }
 
-void SpecificWorker::optimize(const StateVector &target_state, const Obstacles &obstacles, const std::vector<QPointF> &path)
+/// Drains the per-solve records left by the optimizer thread. One line per solve goes to telemetry_file:
+///     status stop runtime nodes gap presolve_cols presolve_rows | t gap ... | incumbent_t ...
+void SpecificWorker::read_telemetry()
 {
-    //qInfo() << "states " << obstacles.size();
-    try
+    static const char *stop_names[] = {"NONE", "DEADLINE", "GAP", "STALL", "NODES", "STALE"};
+    static std::ofstream out;
+    if(not telemetry_file.empty() and not out.is_open())
+        out.open(telemetry_file, std::ios::app);
+    while(auto t = callback->telemetry.pop())
     {
-        // remove endpoint restrictions
-        // model->remove(model->getConstrByName("c1x"));
-        // model->remove(model->getConstrByName("c1y"));
-        model->remove(model->getConstrByName("c1aF"));
-        model->remove(model->getConstrByName("c1aN"));
-
-        // remove all obstacle restrictions
-        for (auto &constr : obs_contraints)
-            constr.clear(model);
-        obs_contraints.clear();
-        model->update();
-
-        // add target state restriction
-        //model->addConstr(state_vars[(NUM_STEPS - 1) * STATE_DIM] == target_state.x(), "c1x");
-        //model->addConstr(state_vars[(NUM_STEPS - 1) * STATE_DIM + 1] == target_state.y(), "c1y");
-        model->addConstr(state_vars[(FIRST_FAR+LAST_FAR)/2 * STATE_DIM + 2] == target_state[2], "c1aF");
-        model->addConstr(state_vars[(FIRST_NEAR+1) * STATE_DIM + 2] == state_vars[(FIRST_FAR+1) * STATE_DIM + 2], "c1aN");
+        qInfo() << __FUNCTION__ << "Solve:" << t->runtime*1000 << "ms" << t->nodes << "nodes gap" << t->gap
+                << "stop" << stop_names[static_cast<int>(t->stop)];
+        if(not out.is_open())
+            continue;
+        out << t->status << " " << stop_names[static_cast<int>(t->stop)] << " " << t->runtime << " " << t->nodes << " " << t->gap
+            << " " << t->presolve_cols_removed << " " << t->presolve_rows_removed << " |";
+        for(std::size_t i = 0; i < t->num_gap_samples; i++)
+            out << " " << t->gap_curve[i].time << " " << t->gap_curve[i].gap;
+        out << " |";
+        for(std::size_t i = 0; i < t->num_incumbents; i++)
+            out << " " << t->incumbent_times[i];
+        out << "\n";
+    }
+}
 
-        this->obj = GRBQuadExpr();
-        for (uint e = FIRST_FAR+1; e < LAST_FAR ; e++)
+/// Solver thread. Consumes the latest snapshot, solves it and publishes the plan in world coordinates
+void SpecificWorker::optimizer_loop()
+{
+    while(not stop_optimizer)
+    {
+        auto snap = snapshots.try_get();
+        if(not snap.has_value())
         {
-            this->obj += control_vars[e * CONTROL_DIM] * control_vars[e * CONTROL_DIM] * 0.1;
-            this->obj += control_vars[e * CONTROL_DIM + 1] * control_vars[e * CONTROL_DIM + 1] * 0.1;
-            this->obj += control_vars[e * CONTROL_DIM + 2] * control_vars[e * CONTROL_DIM + 2];  // angular modulus
+            std::this_thread::sleep_for(2ms);
+            continue;
         }
-
-        for (uint e = FIRST_NEAR+1; e < LAST_FAR ; e++)
+        // stop if the robot has moved on: a newer snapshot is waiting and this one is too old
+        callback->is_stale = [this, stamp = snap->stamp]()
+                { return not snapshots.empty() and std::chrono::steady_clock::now() - stamp > max_snapshot_age; };
+        callback->begin_solve();
+        optimize(snap->target_state, snap->obstacles, snap->region, snap->path);
+        callback->end_solve(model);
+
+        // an interrupted solve is still usable if it was stopped with an incumbent, whatever the reason.
+        // A superseded solve is only discarded when it has none
+        Solution sol;
+        sol.stamp = snap->stamp;
+        sol.status = model->get(GRB_IntAttr_Status);
+        sol.valid = sol.status == GRB_OPTIMAL or
+                    (sol.status == GRB_INTERRUPTED and model->get(GRB_IntAttr_SolCount) > 0);
+        if(sol.valid)
         {
-            this->obj += control_vars[e * CONTROL_DIM] * control_vars[e * CONTROL_DIM] * 0.1;
-            this->obj += control_vars[e * CONTROL_DIM + 1] * control_vars[e * CONTROL_DIM + 1] * 0.1;
-            this->obj += control_vars[e * CONTROL_DIM + 2] * control_vars[e * CONTROL_DIM + 2];  // angular modulus
+            sol.control = ControlVector(control_vars[0].get(GRB_DoubleAttr_X), control_vars[1].get(GRB_DoubleAttr_X), control_vars[2].get(GRB_DoubleAttr_X));
+            sol.path.resize(NUM_STEPS);
+            for(uint e = 0; e < NUM_STEPS; e++)
+                sol.path[e] = snap->robot_to_world.map(QPointF(state_vars[e*STATE_DIM].get(GRB_DoubleAttr_X), state_vars[e*STATE_DIM+1].get(GRB_DoubleAttr_X)));
         }
+        solutions.put(std::move(sol));
+    }
+}
 
-
-        for (uint e = FIRST_FAR; e < LAST_FAR-1 ; e++)
+void SpecificWorker::initialize_free_space_constraints()
+{
+    // one block per robot point and step. Avoids restriction over state[0] and the first far state
+    const std::vector<std::tuple<float,float>> points = footprint == Footprint::MINKOWSKI ? std::vector<std::tuple<float,float>>{{0.f, 0.f}} : robot_points;
+    for(auto &&[dx, dy] : points)  // each point of the robot has to be inside a free polygon in all states
+        for (uint e = 1; e < NUM_STEPS-1; e++)
         {
-            this->obj += (control_vars[e * CONTROL_DIM] - control_vars[(e+1) * CONTROL_DIM]) * (control_vars[e * CONTROL_DIM] - control_vars[(e+1) * CONTROL_DIM]);
-            this->obj += (control_vars[e * CONTROL_DIM + 1] - control_vars[(e+1) * CONTROL_DIM + 1 ]) * (control_vars[e * CONTROL_DIM +1] - control_vars[(e+1) * CONTROL_DIM + 1]);
-            //this->obj += (control_vars[e * CONTROL_DIM + 2] - control_vars[(e+1) * CONTROL_DIM + 2]) * (control_vars[e * CONTROL_DIM + 2] - control_vars[(e+1) * CONTROL_DIM + 2]);  // angular modulus
+            if(e==FIRST_NEAR or e==FIRST_FAR)
+                continue;
+
+            const auto &x = state_vars[e * STATE_DIM];
+            const auto &y = state_vars[e * STATE_DIM + 1];
+            ObsData obs_data;
+            obs_data.step = e; obs_data.dx = dx; obs_data.dy = dy;
+            obs_data.pdata.resize(max_polygons);
+            std::vector<GRBVar> and_vars(max_polygons);
+            GRBLinExpr sum_z, sum_px, sum_py;
+            for (auto &&[k, pdata] : iter::enumerate(obs_data.pdata))
+            {
+                // polygon binary. Disabled (UB = 0) until the slot is used
+                pdata.and_var = model->addVar(0.0, 0.0, 0.0, GRB_BINARY);
+                and_vars[k] = pdata.and_var;
+                sum_z += pdata.and_var;
+                pdata.line_constraints.resize(max_lines);
+                // placeholder coefficients, rewritten in update_free_space_constraints()
+                switch (formulation)
+                {
+                    case Formulation::GENERAL:
+                        pdata.line_vars.resize(max_lines);
+                        pdata.dist_vars.resize(max_lines);
+                        pdata.indicator_constraints.resize(max_lines);
+                        for (uint l = 0; l < max_lines; l++)
+                        {
+                            pdata.line_vars[l] = model->addVar(0.0, 1.0, 0.0, GRB_BINARY);
+                            pdata.dist_vars[l] = model->addVar(-GRB_INFINITY, GRB_INFINITY, 0.0, GRB_CONTINUOUS);
+                            pdata.line_constraints[l] = model->addConstr(pdata.dist_vars[l] - x - y == 0);
+                            pdata.indicator_constraints[l] = model->addGenConstrIndicator(pdata.line_vars[l], 1, pdata.dist_vars[l], GRB_GREATER_EQUAL, 0);
+                        }
+                        pdata.and_constraint = model->addGenConstrAnd(pdata.and_var, pdata.line_vars.data(), max_lines);
+                        break;
+                    case Formulation::BIG_M:
+                        for (uint l = 0; l < max_lines; l++)   // A*x + B*y - M*z >= -(M + A*dx + B*dy + C)
+                            pdata.line_constraints[l] = model->addConstr(x + y - pdata.and_var >= 0);
+                        break;
+                    case Formulation::CONVEX_HULL:
+                        pdata.px = model->addVar(-GRB_INFINITY, GRB_INFINITY, 0.0, GRB_CONTINUOUS);
+                        pdata.py = model->addVar(-GRB_INFINITY, GRB_INFINITY, 0.0, GRB_CONTINUOUS);
+                        sum_px += pdata.px; sum_py += pdata.py;
+                        for (uint l = 0; l < max_lines; l++)   // A*px + B*py + C*z >= 0
+                            pdata.line_constraints[l] = model->addConstr(pdata.px + pdata.py + pdata.and_var >= 0);
+                        pdata.box_constraints = { model->addConstr(pdata.px - pdata.and_var <= 0), model->addConstr(pdata.px - pdata.and_var >= 0),
+                                                  model->addConstr(pdata.py - pdata.and_var <= 0), model->addConstr(pdata.py - pdata.and_var >= 0) };
+                        break;
+                }
+            }
+            switch (formulation)
+            {
+                case Formulation::GENERAL:   // OR variable and constraint with all AND variables
+                    obs_data.or_var = model->addVar(0.0, 1.0, 0.0, GRB_BINARY);
+                    obs_data.or_constraint = model->addGenConstrOr(obs_data.or_var, and_vars.data(), max_polygons);
+                    obs_data.final_constraint = model->addConstr(obs_data.or_var, GRB_EQUAL,  1.0);
+                    break;
+                case Formulation::BIG_M:
+                    obs_data.final_constraint = model->addConstr(sum_z >= 1);
+                    break;
+                case Formulation::CONVEX_HULL:   // the robot point is the sum of its per-polygon copies
+                    obs_data.final_constraint = model->addConstr(sum_z == 1);
+                    obs_data.sum_constraints = { model->addConstr(sum_px - x == dx), model->addConstr(sum_py - y == dy) };
+                    break;
+            }
+            obs_contraints.emplace_back(std::move(obs_data));
         }
+}
 
-
-        for (uint e = FIRST_NEAR; e <= LAST_NEAR ; e++)
+void SpecificWorker::remove_free_space_constraints()
+{
+    for(auto &obs_data : obs_contraints)
+    {
+        for(auto &pdata : obs_data.pdata)
         {
-
-            this->obj += (state_vars[e * STATE_DIM] - state_vars[(FIRST_FAR+1) * STATE_DIM]) * (state_vars[e * STATE_DIM] - state_vars[(FIRST_FAR+1) * STATE_DIM]); // x state modulus
-            this->obj += (state_vars[e * STATE_DIM + 1] - state_vars[(FIRST_FAR+1) * STATE_DIM+1]) * (state_vars[e * STATE_DIM + 1] - state_vars[(FIRST_FAR+1) * STATE_DIM +1 ]); // y state modulus
-
+            for(auto &c : pdata.line_constraints) model->remove(c);
+            for(auto &c : pdata.indicator_constraints) model->remove(c);
+            for(auto &c : pdata.box_constraints) model->remove(c);
+            for(auto &v : pdata.line_vars) model->remove(v);
+            for(auto &v : pdata.dist_vars) model->remove(v);
+            if(formulation == Formulation::GENERAL)
+                model->remove(pdata.and_constraint);
+            if(formulation == Formulation::CONVEX_HULL)
+            { model->remove(pdata.px); model->remove(pdata.py); }
+            model->remove(pdata.and_var);
         }
+        for(auto &c : obs_data.sum_constraints) model->remove(c);
+        model->remove(obs_data.final_constraint);
+        if(formulation == Formulation::GENERAL)
+        { model->remove(obs_data.or_constraint); model->remove(obs_data.or_var); }
+    }
+    obs_contraints.clear();
+}
 
-        //std::vector<uint> p = {FIRST_FAR+1, LAST_FAR};
-        for (uint e = FIRST_FAR; e <= LAST_FAR ; e++)
-        {
-
-            this->obj += (state_vars[e * STATE_DIM] - target_state.x()) * (state_vars[e * STATE_DIM] - target_state.x()); // x state modulus
-            this->obj += (state_vars[e * STATE_DIM + 1] - target_state.y()) * (state_vars[e * STATE_DIM + 1] - target_state.y()); // y state modulus
+void SpecificWorker::update_free_space_constraints(const Obstacles &obstacles, const QPolygonF &region)
+{
+    // a partition that does not fit grows the pool. The capacity never shrinks, so rebuilds are rare
+    std::size_t num_lines = 0;
+    for(const auto &[lines, poly] : obstacles)
+        num_lines = std::max(num_lines, lines.size());
+    if(obstacles.size() > max_polygons or num_lines > max_lines)
+    {
+        max_polygons = std::max<uint>(max_polygons, obstacles.size());
+        max_lines = std::max<uint>(max_lines, num_lines);
+        qInfo() << __FUNCTION__ << "Free-space pool grown to" << max_polygons << "polygons of" << max_lines << "lines";
+        remove_free_space_constraints();
+        initialize_free_space_constraints();
+        model->update();
+    }
 
-        }
-        // this->obj += (state_vars[(NUM_STEPS - 1) * STATE_DIM] - target_state.x())*(state_vars[(NUM_STEPS - 1) * STATE_DIM] - target_state.x());
-        // this->obj += (state_vars[(NUM_STEPS - 1) * STATE_DIM + 1] - target_state.y())*(state_vars[(NUM_STEPS - 1) * STATE_DIM + 1] - target_state.y());
-
-        // add new obstacle restrictions
-        const float DW = 300.f, DL = 300.f;
-        static std::vector<std::tuple<float,float>> desp = {{0, 0}, {-DW, -DL}, {-DW, DL}, {DW, -DL}, {DW, DL}, {0, -DL}, {0, DL}, {-DW, 0}, {DW, 0}};
-        obs_contraints.resize((NUM_STEPS-2) * desp.size()); // avoids restriction over state[0]
-        for(auto &&[i, d] : iter::enumerate(desp))  // each point of the robot has to be inside a free polygon in all states
+    // Tight big-M per line: the largest violation A*px + B*py + C can reach inside the world rectangle
+    // (region, in robot coordinates). A linear function peaks at a vertex of the convex region
+    auto big_m = [region](float A, float B, float C)
+            {
+                double m = 0.0;
+                for(const auto &q : region)
+                    m = std::max(m, -(A * q.x() + B * q.y() + C));
+                return m;
+            };
+    const QRectF box = region.boundingRect();
+
+    // coefficients are batched in a single chgCoeffs call
+    std::vector<GRBConstr> constrs; std::vector<GRBVar> vars; std::vector<double> vals;
+    const std::size_t num_entries = obs_contraints.size() * max_polygons * (max_lines * 3 + 4);
+    constrs.reserve(num_entries); vars.reserve(num_entries); vals.reserve(num_entries);
+    auto chg = [&constrs, &vars, &vals](const GRBConstr &c, const GRBVar &v, double val)
+            { constrs.push_back(c); vars.push_back(v); vals.push_back(val); };
+    for(auto &obs_data : obs_contraints)
+    {
+        const auto &x = state_vars[obs_data.step * STATE_DIM];
+        const auto &y = state_vars[obs_data.step * STATE_DIM + 1];
+        for (auto &&[k, pdata] : iter::enumerate(obs_data.pdata))
         {
-            auto &[dx, dy] = d;
-            for (uint e = 1; e < NUM_STEPS-1; e++)   // avoids restriction over state[0]
+            const bool used = k < obstacles.size();
+            pdata.and_var.set(GRB_DoubleAttr_UB, used ? 1.0 : 0.0);
+            for (uint l = 0; l < max_lines; l++)
             {
-                if(e==FIRST_NEAR or e==FIRST_FAR)
-                {
-                    obs_contraints[(e-1)*desp.size()+i].null_constraint = true;
-                    continue;
-                }
-
-                ObsData obs_data;
-                obs_data.pdata.resize(obstacles.size());
-                GRBVar temp_and_vars[obstacles.size()];
-                for (auto &&[k, obs] : iter::enumerate(obstacles))
+                float A = 0.f, B = 0.f, C = 1.f;   // unused line: always satisfied
+                if (used and l < std::get<Lines>(obstacles[k]).size())
+                    std::tie(A, B, C) = std::get<Lines>(obstacles[k])[l];
+                const auto &row = pdata.line_constraints[l];
+                switch (formulation)
                 {
-                    auto obs_line = std::get<Lines>(obs);  // get Lines form the tupla
-                    ObsData::PolyData pdata;
-                    pdata.line_vars.resize(obs_line.size());
-                    pdata.line_constraints.resize(obs_line.size());
-                    GRBVar temp_line_vars[obs_line.size()];  // to feed the and constraint and avoid a copy
-                    // create line variables for the current polygon and make them equal to robot's distance to line
-                    for (auto &&[l, lines] : obs_line | iter::enumerate)
+                    case Formulation::GENERAL:
+                        chg(row, x, -A); chg(row, y, -B);
+                        row.set(GRB_DoubleAttr_RHS, A * obs_data.dx + B * obs_data.dy + C);
+                        break;
+                    case Formulation::BIG_M:
                     {
-                        auto line_var = model->addVar(0.0, 1.0, 0.0, GRB_BINARY);
-                        auto &[A, B, C] = lines;
-                        GRBGenConstr l_constr = model->addGenConstrIndicator(line_var, 1,
-                                                                                 (A * state_vars[e * STATE_DIM] + B * state_vars[e * STATE_DIM + 1] +
-                                                                                  A * dx + B * dy + C),
-                                                                                 GRB_GREATER_EQUAL, 0);
-                        pdata.line_vars[l] = line_var;
-                        pdata.line_constraints[l] = l_constr;
-                        temp_line_vars[l] = line_var;
+                        const double c = A * obs_data.dx + B * obs_data.dy + C;
+                        const double M = big_m(A, B, C);
+                        chg(row, x, A); chg(row, y, B); chg(row, pdata.and_var, -M);
+                        row.set(GRB_DoubleAttr_RHS, -(M + c));
+                        break;
                     }
-                    // The polygon is finished. Create the AND variable for the polygon and AND constraint with all former line variables
-                    pdata.and_var = model->addVar(0.0, 1.0, 0.0, GRB_BINARY);
-                    temp_and_vars[k] = pdata.and_var;
-                    pdata.and_constraint = model->addGenConstrAnd(pdata.and_var, temp_line_vars, pdata.line_vars.size());
-                    obs_data.pdata[k] = pdata;
+                    case Formulation::CONVEX_HULL:
+                        chg(row, pdata.px, A); chg(row, pdata.py, B); chg(row, pdata.and_var, C);
+                        break;
                 }
-                // All polygons are finished. Now we create the OR variable and constraint with all AND variables
-                obs_data.or_var = model->addVar(0.0, 1.0, 0.0, GRB_BINARY);
-                obs_data.or_constraint = model->addGenConstrOr(obs_data.or_var, temp_and_vars, obs_data.pdata.size());
-                obs_data.final_constraint = model->addConstr(obs_data.or_var, GRB_EQUAL,  1.0);  //
-                obs_data.null_constraint = false;
-                obs_contraints[(e-1)*desp.size()+i] = obs_data;
             }
-        }  // All points of the robot are finished
+            if(formulation == Formulation::CONVEX_HULL)
+            {
+                chg(pdata.box_constraints[0], pdata.and_var, -box.right());
+                chg(pdata.box_constraints[1], pdata.and_var, -box.left());
+                chg(pdata.box_constraints[2], pdata.and_var, -box.bottom());
+                chg(pdata.box_constraints[3], pdata.and_var, -box.top());
+            }
+        }
+    }
+    model->chgCoeffs(constrs.data(), vars.data(), vals.data(), constrs.size());
+}
+
+void SpecificWorker::optimize(const StateVector &target_state, const Obstacles &obstacles, const QPolygonF &region, const std::vector<QPointF> &path)
+{
+    //qInfo() << "states " << obstacles.size();
+    try
+    {
+        // target restrictions and linear part of the objective
+        target_angle_constr.set(GRB_DoubleAttr_RHS, target_state[2]);
+        for (uint e = FIRST_FAR; e <= LAST_FAR ; e++)
+        {
+            state_vars[e * STATE_DIM].set(GRB_DoubleAttr_Obj, -2.0 * target_state.x());
+            state_vars[e * STATE_DIM + 1].set(GRB_DoubleAttr_Obj, -2.0 * target_state.y());
+        }
+        model->set(GRB_DoubleAttr_ObjCon, (LAST_FAR - FIRST_FAR + 1) * (target_state.x() * target_state.x() + target_state.y() * target_state.y()));
+
+        // obstacle restrictions
+        if(footprint == Footprint::MINKOWSKI)
+            update_free_space_constraints(shrink_by_footprint(obstacles), region);
+        else
+            update_free_space_constraints(obstacles, region);
 
         // Warm start
          for (uint e = 0; e < NUM_STEPS-1; e++)
@@ -509,7 +702,6 @@ void SpecificWorker::optimize(const StateVector &target_state, const Obstacles &
          }
 
         model->update();
-        model->setObjective(obj, GRB_MINIMIZE);
         model->optimize();
 
     }
@@ -523,11 +715,129 @@ void SpecificWorker::optimize(const StateVector &target_state, const Obstacles &
     { std::cout << "Exception during optimization" << std::endl;   }
 }
 
+/// Erodes each convex free polygon by the robot rectangle [-DW,DW]x[-DL,DL]. With normalized lines
+/// A*x + B*y + C >= 0, the rectangle support along the inward normal is DW*|A| + DL*|B|, so the offset
+/// polygon is just C shifted by it. Polygons that vanish are dropped
+SpecificWorker::Obstacles SpecificWorker::shrink_by_footprint(const Obstacles &obstacles) const
+{
+    Obstacles shrunk;
+    shrunk.reserve(obstacles.size());
+    for(const auto &[lines, poly] : obstacles)
+    {
+        Lines offset(lines.size());
+        for(auto &&[i, l] : iter::enumerate(lines))
+        {
+            auto &[A, B, C] = l;
+            offset[i] = std::make_tuple(A, B, C - (DW * fabs(A) + DL * fabs(B)));
+        }
+        // non empty iff some vertex, i.e. the crossing of two lines, satisfies all of them
+        auto inside = [&offset](float x, float y)
+                { return std::ranges::all_of(offset, [x, y](auto &l){ auto &[A, B, C] = l; return A*x + B*y + C >= -1.f; }); };
+        bool empty = true;
+        for(std::size_t i = 0; i < offset.size() and empty; i++)
+            for(std::size_t j = i+1; j < offset.size() and empty; j++)
+            {
+                auto &[A1, B1, C1] = offset[i];
+                auto &[A2, B2, C2] = offset[j];
+                const float det = A1*B2 - A2*B1;
+                if(fabs(det) < 1e-6)
+                    continue;
+                empty = not inside((B1*C2 - B2*C1) / det, (A2*C1 - A1*C2) / det);
+            }
+        if(not empty)
+            shrunk.emplace_back(std::make_tuple(offset, poly));
+    }
+    return shrunk;
+}
+
+/// Appends the optimizer input of one cycle to record_scenes_file:
+///     scene tx ty ta
+///     region n x0 y0 ... xn yn
+///     poly n A0 B0 C0 ... An Bn Cn    (one line per free polygon)
+///     end
+void SpecificWorker::record_scene(const StateVector &target_state, const Obstacles &obstacles, const QPolygonF &region)
+{
+    std::ofstream out(record_scenes_file, std::ios::app);
+    out << "scene " << target_state.x() << " " << target_state.y() << " " << target_state[2] << "\n";
+    out << "region " << region.size();
+    for(const auto &p : region)
+        out << " " << p.x() << " " << p.y();
+    out << "\n";
+    for(const auto &[lines, _] : obstacles)
+    {
+        out << "poly " << lines.size();
+        for(const auto &[A, B, C] : lines)
+            out << " " << A << " " << B << " " << C;
+        out << "\n";
+    }
+    out << "end\n";
+}
+
+/// Replays the recorded scenes with each formulation and prints node count and solve time
+void SpecificWorker::benchmark_formulations(const std::string &file_name)
+{
+    struct Scene { StateVector target; QPolygonF region; Obstacles obstacles; };
+    std::vector<Scene> scenes;
+    std::ifstream in(file_name);
+    std::string tag;
+    while(in >> tag)
+    {
+        if(tag == "scene")
+        {
+            scenes.emplace_back();
+            in >> scenes.back().target[0] >> scenes.back().target[1] >> scenes.back().target[2];
+        }
+        else if(tag == "region")
+        {
+            int n; in >> n;
+            for(int i=0; i<n; i++) { double x, y; in >> x >> y; scenes.back().region << QPointF(x, y); }
+        }
+        else if(tag == "poly")
+        {
+            int n; in >> n;
+            Lines lines(n);
+            for(auto &[A, B, C] : lines) in >> A >> B >> C;
+            scenes.back().obstacles.emplace_back(std::make_tuple(lines, QPolygonF()));
+        }
+    }
+    qInfo() << __FUNCTION__ << "Read" << scenes.size() << "scenes from" << QString::fromStdString(file_name);
+    if(scenes.empty())
+        return;
+
+    const std::vector<std::pair<Formulation, QString>> formulations = {{Formulation::GENERAL, "GENERAL"},
+                                                                        {Formulation::BIG_M, "BIG_M"},
+                                                                        {Formulation::CONVEX_HULL, "CONVEX_HULL"}};
+    const std::vector<QPointF> path(NUM_STEPS, QPointF(0,0));
+    for(const auto &[f, name] : formulations)
+    {
+        formulation = f;
+        obs_contraints.clear();
+        initialize_model(StateVector(0,0,0));
+        double total_time = 0, total_nodes = 0, max_time = 0;
+        int optimal = 0;
+        for(const auto &sc : scenes)
+        {
+            optimize(sc.target, sc.obstacles, sc.region, path);
+            const double t = model->get(GRB_DoubleAttr_Runtime);
+            total_time += t; max_time = std::max(max_time, t);
+            total_nodes += model->get(GRB_DoubleAttr_NodeCount);
+            if(model->get(GRB_IntAttr_Status) == GRB_OPTIMAL) optimal++;
+        }
+        qInfo() << __FUNCTION__ << name << "vars:" << model->get(GRB_IntAttr_NumBinVars) << "binaries,"
+                << "mean nodes:" << total_nodes / scenes.size()
+                << "mean time:" << total_time / scenes.size() * 1000 << "ms"
+                << "max time:" << max_time * 1000 << "ms"
+                << "optimal:" << optimal << "/" << scenes.size();
+        delete[] model_vars;
+        delete model;
+        model = nullptr;
+    }
+}
+
 //////////////////////////////////// AUXILIARY METHODS //////////////////////////////////////////////////////////////
 /// computes covex decomposition using polypartition library at https://github.com/ivanfratric/polypartition
 SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &laser_poly)  //robot coordinates
 {
-    TPPLPartition partition;
     TPPLPoly poly_part;
     TPPLPolyList parts;
 
@@ -539,7 +849,12 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &l
         poly_part[i].y = l.y();
     }
     poly_part.SetOrientation(TPPL_CCW);
-    partition.ConvexPartition_HM(&poly_part, &parts);
+    // ear clipping is kept as the fallback if the monotone partition rejects the contour
+    if(partition_mode == PartitionMode::HM or not partition.ConvexPartition_MONO(&poly_part, &parts))
+    {
+        parts.clear();
+        partition.ConvexPartition_HM(&poly_part, &parts);
+    }
     //partition.ConvexPartition_OPT(&poly_part, &parts);
     //int r = partition.Triangulate_OPT(&poly_part, &parts);
     //qInfo() << __FUNCTION__ << "Ok: " << r << "Num vertices:" << poly_part.GetNumPoints() << "Num res polys: " << parts.size();
@@ -552,7 +867,7 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &l
 
         // generate QPolygons for drawing
         QPolygonF poly_draw(num_points);
-        std::generate(poly_draw.begin(), poly_draw.end(), [poly_res, k=0, robot = robot_polygon]() mutable
+        std::generate(poly_draw.begin(), poly_draw.end(), [&poly_res, k=0, robot = robot_polygon]() mutable
         {
             auto &p = poly_res.GetPoint(k++);
             return robot->mapToScene(QPointF(p.x, p.y));  //convert to world coordinates
@@ -560,7 +875,7 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &l
 
         // generate vector of <A,B,C> tuples
         Lines line(num_points);
-        std::generate(line.begin(), line.end(),[poly_res, k=0, num_points]() mutable
+        std::generate(line.begin(), line.end(),[&poly_res, k=0, num_points]() mutable
         {
             float x1 = poly_res.GetPoint(k).x;
             float y1 = poly_res.GetPoint(k).y;
@@ -574,138 +889,14 @@ SpecificWorker::Obstacles SpecificWorker::compute_laser_partitions(QPolygonF  &l
     return obstacles;
 }
 
-/// compute covex polygons outside the laser field
+/// compute covex polygons outside the laser field. The map is static, so the decomposition is cached in world coordinates
+/// and only its line equations are moved to the robot frame each cycle
 SpecificWorker::Obstacles SpecificWorker::compute_external_partitions(Grid<>::Dimensions dim, const std::vector<QPolygonF> &map_obstacles,
                                                                       const QPolygonF &laser_poly, QGraphicsItem* robot_polygon)
 {
-    // get the complete external contour
-    QPolygonF pe = robot_polygon->mapFromScene(QPolygonF(QRectF(dim.HMIN, dim.VMIN, dim.WIDTH, dim.HEIGHT)));  // world rectangle to robot coordinates
-    pe.pop_back();
-    TPPLPoly external_poly;
-    external_poly.Init(pe.size());      // external rectangle
-    for(auto &&[i, p] : iter::enumerate(iter::reversed(pe)))
-    {
-        external_poly[i].x = p.x();
-        external_poly[i].y = p.y();
-    }
-    external_poly.SetHole(false);
-    external_poly.SetOrientation(TPPL_CCW);
-    TPPLPolyList external_poly_list{ external_poly};
-
-    // laser hole
-    TPPLPoly laser_hole;
-    laser_hole.Init(laser_poly.size());
-    for(auto &&[i, l] : iter::enumerate(iter::reversed(laser_poly)))   // clock wise order of vertices
-    {
-        laser_hole[i].x = l.x();
-        laser_hole[i].y = l.y();
-    }
-    laser_hole.SetHole(true);
-    //external_poly_list.insert( external_poly_list.end(), laser_hole);
-
-    // map obstacles as holes
-    for(auto &poly : map_obstacles)
-    {
-        auto lpoly = robot_polygon->mapFromScene(poly);  // convert to robot coordinates
-        TPPLPoly hole;
-        hole.Init(lpoly.size());
-        for(auto &&[i, l] : iter::enumerate(iter::reversed(lpoly)))  // clock wise order of vertices
-        {
-            hole[i].x = l.x();
-            hole[i].y = l.y();
-        }
-        hole.SetHole(true);
-        external_poly_list.insert( external_poly_list.end(), hole );
-    }
-
-    TPPLPartition partition;
-    TPPLPolyList convex_result;
-    partition.ConvexPartition_HM(&external_poly_list, &convex_result);
-//    qInfo() << __FUNCTION__ << "Num res polys: " << convex_result.size();
-
-    Obstacles obstacles;
-    for(auto &&[k, poly_res] : iter::enumerate(iter::filter([](auto &p){ return not p.IsHole(); }, convex_result)))
-    {
-        // remove small polygons
-        auto num_points = poly_res.GetNumPoints();
-        float area = 0.0; int j = num_points-1;
-        for(auto i: iter::range(num_points)) // compute area
-        {
-            area += (poly_res[j].x + poly_res[i].x) * (poly_res[j].y - poly_res[i].y);
-            j=i;
-        }
-        if(fabs(area) < 500000)
-            continue;
-
-        // generate QPolygons for drawing
-        QPolygonF poly_draw(num_points);
-        std::generate(poly_draw.begin(), poly_draw.end(), [poly_res, k=0, robot = robot_polygon]() mutable
-        {
-            auto &p = poly_res.GetPoint(k++);
-            return robot-> mapToScene(QPointF(p.x, p.y));
-        });
-
-        // generate vector of <A,B,C> tuples
-        Lines line(num_points);
-        std::generate(line.begin(), line.end(),[poly_res, k=0, num_points]() mutable
-        {
-            float x1 = poly_res.GetPoint(k).x;
-            float y1 = poly_res.GetPoint(k).y;
-            float x2 = poly_res.GetPoint((++k) % num_points).x;
-            float y2 = poly_res.GetPoint((k) % num_points).y;
-            float norm = sqrt(pow(y1-y2, 2) + pow(x2-x1, 2));
-            //qDebug()<<x1<<y1<<x2<<y2;
-            //qDebug()<<(y1 - y2)/norm<< (x2 - x1)/norm<< -((y1 - y2)*x1 + (x2 - x1)*y1)/norm;
-            return std::make_tuple((y1 - y2)/norm, (x2 - x1)/norm, -((y1 - y2)*x1 + (x2 - x1)*y1)/norm);
-        });
-        obstacles.emplace_back(std::make_tuple(line, poly_draw));
-    }
-    //qInfo() << __FUNCTION__ << "Obstacles: " << obstacles.size();
-    return obstacles;
-}
-void SpecificWorker::ramer_douglas_peucker(const vector<Point> &pointList, double epsilon, vector<Point> &out)
-{
-    if(pointList.size()<2)
-    {
-        qWarning() << "Not enough points to simplify";
-        return;
-    }
-
-    // Find the point with the maximum distance from line between start and end
-    auto line = Eigen::ParametrizedLine<float, 2>::Through(Eigen::Vector2f(pointList.front().first, pointList.front().second),
-                                                           Eigen::Vector2f(pointList.back().first, pointList.back().second));
-    auto max = std::max_element(pointList.begin()+1, pointList.end(), [line](auto &a, auto &b)
-             { return line.distance(Eigen::Vector2f(a.first, a.second)) < line.distance(Eigen::Vector2f(b.first, b.second));});
-    float dmax =  line.distance(Eigen::Vector2f((*max).first, (*max).second));
-
-    // If max distance is greater than epsilon, recursively simplify
-    if(dmax > epsilon)
-    {
-        // Recursive call
-        vector<Point> recResults1;
-        vector<Point> recResults2;
-        vector<Point> firstLine(pointList.begin(), max + 1);
-        vector<Point> lastLine(max, pointList.end());
-
-        ramer_douglas_peucker(firstLine, epsilon, recResults1);
-        ramer_douglas_peucker(lastLine, epsilon, recResults2);
-
-        // Build the result list
-        out.assign(recResults1.begin(), recResults1.end() - 1);
-        out.insert(out.end(), recResults2.begin(), recResults2.end());
-        if (out.size() < 2)
-        {
-            qWarning() << "Problem assembling output";
-            return;
-        }
-    }
-    else
-    {
-        //Just return start and end points
-        out.clear();
-        out.push_back(pointList.front());
-        out.push_back(pointList.back());
-    }
+    if(free_space.set_map(QRectF(dim.HMIN, dim.VMIN, dim.WIDTH, dim.HEIGHT), map_obstacles))
+        qInfo() << __FUNCTION__ << "Free space decomposed in" << free_space.size() << "regions";
+    return free_space.robot_frame(robot_polygon->sceneTransform(), FREE_REGIONS_ROI);
 }
 RoboCompGenericBase::TBaseState SpecificWorker::read_base()
 {
@@ -732,22 +923,13 @@ std::tuple<QPolygonF, RoboCompLaser::TLaserData> SpecificWorker::read_laser()
         ldata = laser_proxy->getLaserData();
 
         // Simplify laser contour with Ramer-Douglas-Peucker
-        std::vector<Point> plist(ldata.size());
-        std::generate(plist.begin(), plist.end(), [ldata, k=0]() mutable
-               { auto &l = ldata[k++]; return std::make_pair(l.dist * sin(l.angle), l.dist * cos(l.angle));});
-        vector<Point> pointListOut;
-        ramer_douglas_peucker(plist, MAX_RDP_DEVIATION_mm, pointListOut);
-        laser_poly.resize(pointListOut.size());
-        std::generate(laser_poly.begin(), laser_poly.end(), [pointListOut, this, k=0]() mutable
-              { auto &p = pointListOut[k++]; return QPointF(p.first, p.second);});
+        const auto &kept = rdp.simplify_scan(ldata, MAX_RDP_DEVIATION_mm);
+        laser_poly.resize(kept.size());
+        for (auto &&[k, i] : kept | iter::enumerate)
+            laser_poly[k] = QPointF(rdp.points_x()[i], rdp.points_y()[i]);
 
         // Filter out spikes. If the angle between two line segments is less than to the specified maximum angle
-        std::vector<QPointF> removed;
-        for(auto &&[k, ps] : iter::sliding_window(laser_poly,3) | iter::enumerate)
-            if( MAX_SPIKING_ANGLE_rads > acos(QVector2D::dotProduct( QVector2D(ps[0] - ps[1]).normalized(), QVector2D(ps[2] - ps[1]).normalized())))
-                removed.push_back(ps[1]);
-        for(auto &&r : removed)
-            laser_poly.erase(std::remove_if(laser_poly.begin(), laser_poly.end(), [r](auto &p) { return p == r; }), laser_poly.end());
+        laser_filter.remove_spikes(laser_poly);
     }
     catch(const Ice::Exception &e)
     { std::cout << "Error reading from Laser" << e << std::endl;}
@@ -854,40 +1036,16 @@ void SpecificWorker::init_drawing( Grid<>::Dimensions dim)
         {  custom_plot.resize(signal_frame->size()); graphicsView->fitInView(scene.sceneRect(), Qt::KeepAspectRatio); });
 }
 
-void SpecificWorker::draw_laser(const QPolygonF &poly) // robot coordinates
+void SpecificWorker::draw_laser(const QPolygonF &poly_world)
 {
-    static QGraphicsItem *laser_polygon = nullptr;
-    if (laser_polygon != nullptr)
-        scene.removeItem(laser_polygon);
-
-    QColor color("LightGreen");
-    color.setAlpha(40);
-    laser_polygon = scene.addPolygon(robot_polygon->mapToScene(poly), QPen(QColor("DarkGreen"), 30), QBrush(color));
-    laser_polygon->setZValue(3);
+    laser_layer.one(&scene)->setPolygon(poly_world);
 }
 void SpecificWorker::draw_path(const std::vector<QPointF> &path)
 {
-    static std::vector<QGraphicsEllipseItem *> path_paint;
-    static QString path_color = "DarkBlue";
-
-    for(auto p : path_paint)
-        scene.removeItem(p);
-    path_paint.clear();
-    uint s;
-    for(auto &&[e, p] : iter::enumerate(path))
-    {
-        if(e<LAST_NEAR)
-        {
-            path_color = "LightGreen";
-            s = 150;
-        }
-        else
-        {
-            path_color = "DarkBlue";
-            s = 100;        
-        }
-        path_paint.push_back(scene.addEllipse(p.x()-s/2, p.y()-s/2, s , s, QPen(path_color), QBrush(QColor(path_color))));
-    }    
+    // the first LAST_NEAR points larger and in another color
+    const auto split = path.begin() + std::min<std::size_t>(LAST_NEAR, path.size());
+    near_path_layer.one(&scene)->set_points(std::vector<QPointF>(path.begin(), split));
+    far_path_layer.one(&scene)->set_points(std::vector<QPointF>(split, path.end()));
 }
 
 void SpecificWorker::draw_target(const RoboCompGenericBase::TBaseState &bState, QPointF t)
@@ -913,17 +1071,6 @@ void SpecificWorker::draw_target(const RoboCompGenericBase::TBaseState &bState,
     timeGraph->data()->clear();
 }
 
-std::vector<QPointF> SpecificWorker::compute_path()
-{
-    std::vector<QPointF> path(NUM_STEPS);
-    std::generate(path.begin(), path.end(), [i=innerModel, s=state_vars, d=STATE_DIM, e=0]() mutable
-    {
-        QVec p =  i->transform("world", QVec::vec3(s[e*d].get(GRB_DoubleAttr_X), 0., s[e*d+1].get(GRB_DoubleAttr_X)), "robot");
-        e++;
-        return QPointF(p.x(), p.z());
-    });
-    return path;
-}
 void SpecificWorker::draw_signals(const ControlVector &control, float pos_error, float rot_error, float time_elapsed)
 {
     xGraph->addData(cont, control.x());
@@ -938,13 +1085,9 @@ void SpecificWorker::draw_signals(const ControlVector &control, float pos_error,
 
 void SpecificWorker::draw_partitions(const Obstacles &obstacles, const QColor &color, bool print)
 {
-    static std::vector<QGraphicsPolygonItem *> polys_ptr{};
-    for (auto p: polys_ptr)
-        scene.removeItem(p);
-    polys_ptr.clear();
-
     const QColor color_inside("LightBlue");
     const QColor color_outside("LightPink");
+    partitions_layer.begin(&scene);
     for(auto &obs : obstacles)
     {
         bool inside = true;
@@ -952,14 +1095,12 @@ void SpecificWorker::draw_partitions(const Obstacles &obstacles, const QColor &c
         {
             inside = inside and C > 0; // since ABC were computed in the robot's coordinate frame
         }
-        if (inside)
-            polys_ptr.push_back(scene.addPolygon(std::get<QPolygonF>(obs), QPen(color_inside, 0), QBrush(color_inside)));
-        else
-        {
-            //color.setRgb(qrand() % 255, qrand() % 255, qrand() % 255);
-            polys_ptr.push_back(scene.addPolygon(std::get<QPolygonF>(obs), QPen(color, 0), QBrush(color_outside)));
-        }
+        auto poly = partitions_layer.next();
+        poly->setPolygon(std::get<QPolygonF>(obs));
+        poly->setPen(QPen(inside ? color_inside : color, 0));
+        poly->setBrush(inside ? color_inside : color_outside);
     }
+    partitions_layer.end();
     if(print)
     {
         qInfo() << "--------- LINES ------------";
@@ -972,6 +1113,19 @@ void SpecificWorker::draw_partitions(const Obstacles &obstacles, const QColor &c
     }
 }
 
+void SpecificWorker::render()
+{
+    // nothing new since the last one
+    if(not frames.fetch())
+        return;
+    const auto &f = frames.front();
+    draw_laser(f.laser);
+    draw_partitions(f.partitions, QColor("Magenta"), false);
+    draw_path(f.path);
+    if(f.sample.has_value())
+        draw_signals(f.sample->control, f.sample->pos_error, f.sample->rot_error, f.sample->time_elapsed);
+}
+
 float SpecificWorker::exponentialFunction(float value, float xValue, float yValue, float min)
 {
     if (yValue <= 0)
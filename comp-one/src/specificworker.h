@@ -36,8 +36,16 @@
 #include <gurobi_c++.h>
 #include "qcustomplot.h"
 #include <doublebuffer/DoubleBuffer.h>
-#include "polypartition.h"
+#include <polypartition/polypartition.h>
 #include "callback.h"
+#include "mailbox.h"
+#include "free_space_partition.h"
+#include <graphics/scene_items.h>
+#include <graphics/triple_buffer.h>
+#include <laser/rdp.h>
+#include <laser/filter.h>
+#include <thread>
+#include <atomic>
 
 class MyScene : public QGraphicsScene
 {
@@ -67,6 +75,7 @@ class SpecificWorker : public GenericWorker
         void compute();
         int startup_check();
         void initialize(int period);
+        void render();
 
     protected:
         void resizeEvent(QResizeEvent * event)
@@ -130,7 +139,8 @@ class SpecificWorker : public GenericWorker
 
         // path
         void draw_path(const std::vector<QPointF> &path);
-        std::vector<QPointF> compute_path();
+        ItemPool<PointsItem> near_path_layer{0, [](auto p){ p->set_style(150, QPen(QColor("LightGreen")), QBrush(QColor("LightGreen"))); }};
+        ItemPool<PointsItem> far_path_layer{0, [](auto p){ p->set_style(100, QPen(QColor("DarkBlue")), QBrush(QColor("DarkBlue"))); }};
         bool atTarget = true;
 
         // Grid
@@ -143,10 +153,11 @@ class SpecificWorker : public GenericWorker
         std::vector<QPolygonF> map_obstacles;
 
         // convex parrtitions
-        using Point = std::pair<float, float>;  //only for RDP, change to QPointF
         using Lines = std::vector<std::tuple<float, float, float>>;
         using Obstacles = std::vector<std::tuple<Lines, QPolygonF>>;
         std::vector<tuple<Lines, QPolygonF>> world_free_regions;
+        FreeSpacePartition free_space;
+        const float FREE_REGIONS_ROI = 0;   // mm around the robot. Farther free regions are left out of the MIQP. 0 keeps all
 
         //controller
         float exponentialFunction(float value, float xValue, float yValue, float min);
@@ -154,12 +165,14 @@ class SpecificWorker : public GenericWorker
         void local_controller(const std::vector<QPointF> &path, const RoboCompLaser::TLaserData &laser_data, const QPointF &robot, const QPointF &target);
         void local_controller(float side_vel, float adv_vel, float rot_vel, const RoboCompLaser::TLaserData &laser_data);
 
-        // threads
-        std::thread opt_thread;
-
         Obstacles compute_laser_partitions(QPolygonF  &laser_poly);
+        TPPLPartition partition;    // kept between cycles to reuse its buffers
+        // laser polygon decomposition. HM merges an ear clipping triangulation, O(n²). MONO merges a monotone one, O(n log n)
+        enum class PartitionMode {HM, MONO};
+        PartitionMode partition_mode = PartitionMode::MONO;
         Obstacles compute_external_partitions(Grid<>::Dimensions dim, const std::vector<QPolygonF> &map_obstacles, const QPolygonF &laser_poly, QGraphicsItem* robot_polygon);
-        void ramer_douglas_peucker(const vector<Point> &pointList, double epsilon, vector<Point> &out);
+        RamerDouglasPeucker rdp;
+        LaserFilter laser_filter{LaserFilter::Options{.max_spiking_angle = MAX_SPIKING_ANGLE_rads}};
 
         // Model and optimizations
         using ControlVector = Eigen::Matrix<float, CONTROL_DIM, 1>;
@@ -170,47 +183,94 @@ class SpecificWorker : public GenericWorker
         GRBVar *state_vars;
         GRBVar *control_vars;
         GRBQuadExpr obj;
+        GRBConstr target_angle_constr;
+
+        // Free-space constraints are allocated for max_polygons x max_lines and reused every cycle.
+        // Only coefficients, RHS and bounds are rewritten per cycle. A partition that does not fit grows the pool,
+        // which is then rebuilt, so no free polygon is ever dropped.
+        //  GENERAL:     a binary per line, indicator -> AND per polygon -> OR, as Gurobi general constraints
+        //  BIG_M:       a binary per polygon, A*x + B*y + C >= -M*(1-z) with M tight to the world rectangle
+        //  CONVEX_HULL: a binary per polygon plus a disaggregated copy of the point per polygon
+        enum class Formulation {GENERAL, BIG_M, CONVEX_HULL};
+        Formulation formulation = Formulation::GENERAL;
+        uint max_polygons = 12;
+        uint max_lines = 8;
+        // Robot footprint. POINTS replicates every free-space constraint for 9 points of the robot, each of which
+        // may lie in a different free polygon. MINKOWSKI shrinks each free polygon by the footprint rectangle and
+        // keeps only the centre point, so the whole robot must fit inside a single polygon. That is a more
+        // conservative approximation, not an equivalent one: it loses the passages that are only free across polygons
+        enum class Footprint {POINTS, MINKOWSKI};
+        Footprint footprint = Footprint::POINTS;
+        const float DW = 300.f, DL = 300.f;
+        const std::vector<std::tuple<float,float>> robot_points = {{0, 0}, {-DW, -DL}, {-DW, DL}, {DW, -DL}, {DW, DL}, {0, -DL}, {0, DL}, {-DW, 0}, {DW, 0}};
+        Obstacles shrink_by_footprint(const Obstacles &obstacles) const;
         struct ObsData
         {
             struct PolyData
             {
+                GRBVar and_var;                              // polygon binary
+                std::vector<GRBConstr> line_constraints;     // one linear row per line, rewritten each cycle
+                // GENERAL
                 std::vector<GRBVar> line_vars;
-                std::vector<GRBGenConstr> line_constraints;
-                GRBVar and_var;
+                std::vector<GRBVar> dist_vars;               // dist - A*x - B*y == A*dx + B*dy + C
+                std::vector<GRBGenConstr> indicator_constraints;  // line_var == 1 -> dist >= 0
                 GRBGenConstr and_constraint;
+                // CONVEX_HULL
+                GRBVar px, py;
+                std::vector<GRBConstr> box_constraints;      // xmin*z <= px <= xmax*z, same for py
             };
+            uint step;
+            float dx, dy;
             std::vector<PolyData> pdata;
             GRBVar or_var;
             GRBGenConstr or_constraint;
             GRBConstr final_constraint;
-            bool null_constraint;
-            void clear(GRBModel *model)
-            {
-                if(not null_constraint)
-                {
-                    model->remove(or_var);
-                    model->remove(or_constraint);
-                    model->remove(final_constraint);
-                    for(auto &p : pdata)
-                    {
-                        model->remove(p.and_var);
-                        model->remove(p.and_constraint);
-                        for(auto &lv : p.line_vars)
-                            model->remove(lv);
-                        p.line_vars.clear();
-                        for(auto &lc : p.line_constraints)
-                            model->remove(lc);
-                        p.line_constraints.clear();
-                    }
-                    pdata.clear();
-                }
-            }
+            std::vector<GRBConstr> sum_constraints;          // CONVEX_HULL: the point is the sum of its copies
         };
         std::vector<ObsData> obs_contraints;
+        void initialize_free_space_constraints();
+        void remove_free_space_constraints();
+        void update_free_space_constraints(const Obstacles &obstacles, const QPolygonF &region);
+
+        // recorded scenes to compare formulations offline
+        std::string record_scenes_file, benchmark_scenes_file;
+        void record_scene(const StateVector &target_state, const Obstacles &obstacles, const QPolygonF &region);
+        void benchmark_formulations(const std::string &file_name);
         GRBVar *sin_cos_vars;
         void initialize_model(const StateVector &target);
-        void optimize(const StateVector &target_state,  const Obstacles &obstacles, const std::vector<QPointF> &path);
+        void optimize(const StateVector &target_state,  const Obstacles &obstacles, const QPolygonF &region, const std::vector<QPointF> &path);
         Callback *callback;
+        Callback::Policy solve_policy;
+        std::string telemetry_file;
+        void read_telemetry();
+
+        // Asynchronous planning. compute() publishes snapshots, the optimizer thread publishes plans.
+        // Both go through single-slot mailboxes so each side only sees the latest value and never blocks
+        const int CONTROL_PERIOD = 50;   // ms
+        std::chrono::milliseconds max_snapshot_age{1500};       // older solves are stopped when a newer snapshot waits. From SolveDeadline
+        const std::chrono::milliseconds MAX_PLAN_AGE{1500};      // older plans are not tracked
+        struct Snapshot
+        {
+            std::chrono::steady_clock::time_point stamp;
+            StateVector target_state;
+            Obstacles obstacles;
+            QPolygonF region;
+            QTransform robot_to_world;
+            std::vector<QPointF> path;      // warm start
+        };
+        struct Solution
+        {
+            std::chrono::steady_clock::time_point stamp;   // of the snapshot it was computed from
+            int status;
+            bool valid = false;
+            ControlVector control;
+            std::vector<QPointF> path;      // world coordinates
+        };
+        Mailbox<Snapshot> snapshots;
+        Mailbox<Solution> solutions;
+        std::thread opt_thread;
+        std::atomic<bool> stop_optimizer = false;
+        void optimizer_loop();
 
         // Draw
         QCustomPlot custom_plot;
@@ -220,11 +280,29 @@ class SpecificWorker : public GenericWorker
         void init_drawing( Grid<>::Dimensions dim);
         QGraphicsEllipseItem *target_draw = nullptr;
         void draw_target(const RoboCompGenericBase::TBaseState &bState, QPointF t);
-        void draw_laser(const QPolygonF &poly);
+        void draw_laser(const QPolygonF &poly_world);
         void draw_signals(const ControlVector &control, float pos_error, float rot_error, float time_elapsed);
         void draw_partitions(const Obstacles &obstacles, const QColor &color, bool print=false);
+        // drawing layers, updated in place every cycle
+        ItemPool<QGraphicsPolygonItem> laser_layer{3, [](auto p)
+            { QColor color("LightGreen"); color.setAlpha(40); p->setPen(QPen(QColor("DarkGreen"), 30)); p->setBrush(color); }};
+        ItemPool<QGraphicsPolygonItem> partitions_layer;
         int cont=0;
 
+        // Viewer. compute() leaves what has to be drawn in a frame, in world coordinates, and render() draws the
+        // last one at its own rate. The robot item stays in compute() since its transform is the robot pose
+        struct Frame
+        {
+            QPolygonF laser;
+            Obstacles partitions;
+            std::vector<QPointF> path;          // empty when not going to a target
+            struct Sample { ControlVector control; float pos_error, rot_error, time_elapsed; };
+            std::optional<Sample> sample;       // only in the cycles that receive a new plan
+        };
+        TripleBuffer<Frame> frames;
+        int render_fps = 25;             // 0 for headless, nothing is drawn
+        QTimer render_timer;
+
 };
 
 #endif
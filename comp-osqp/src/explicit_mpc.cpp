@@ -0,0 +1,213 @@
+//
+// Explicit MPC law stored as a binary region tree
+//
+
+#include "explicit_mpc.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+void ExplicitMPC::build(const SolveFunction &solve, const BuildOptions &options)
+{
+    for(int i = 0; i < param_dim; i++)
+    {
+        lo[i] = options.lo[i];
+        hi[i] = options.hi[i];
+    }
+    nodes.assign(1, Node{-1, 0.f, -1});
+    laws.clear();
+    build_node(0, options.lo, options.hi, 0, solve, options);
+}
+
+void ExplicitMPC::build_node(std::size_t index, const Params &cell_lo, const Params &cell_hi, int depth,
+                             const SolveFunction &solve, const BuildOptions &options)
+{
+    if(auto law = fit_law(cell_lo, cell_hi, solve, options); law.has_value())
+    {
+        nodes[index] = Node{-1, 0.f, (std::int32_t)laws.size()};
+        laws.push_back(law.value());
+        return;
+    }
+    if(depth == options.max_depth)
+    {
+        nodes[index] = Node{-1, 0.f, -1};   // online QP here
+        return;
+    }
+    // halve the widest side, measured relative to the whole box
+    int axis;
+    ((cell_hi - cell_lo).array() / (options.hi - options.lo).array()).maxCoeff(&axis);
+    const double split = (cell_lo[axis] + cell_hi[axis]) / 2.0;
+    const auto child = (std::int32_t)nodes.size();
+    nodes[index] = Node{axis, (float)split, child};
+    nodes.resize(nodes.size() + 2, Node{-1, 0.f, -1});  // invalidates references into nodes
+    Params left_hi = cell_hi, right_lo = cell_lo;
+    left_hi[axis] = split;
+    right_lo[axis] = split;
+    build_node(child, cell_lo, left_hi, depth + 1, solve, options);
+    build_node(child + 1, right_lo, cell_hi, depth + 1, solve, options);
+}
+
+std::optional<ExplicitMPC::Law> ExplicitMPC::fit_law(const Params &cell_lo, const Params &cell_hi,
+                                                     const SolveFunction &solve, const BuildOptions &options) const
+{
+    // least squares fit on the corners and the center, checked there, at the face centers and on an interior
+    // lattice with samples_per_axis points per axis placed at the centers of equal sub-intervals
+    const Params center = (cell_lo + cell_hi) / 2.0;
+    std::vector<Params> fit_points, check_points;
+    for(int c = 0; c < (1 << param_dim); c++)
+    {
+        Params p;
+        for(int i = 0; i < param_dim; i++)
+            p[i] = (c >> i) & 1 ? cell_hi[i] : cell_lo[i];
+        fit_points.push_back(p);
+    }
+    fit_points.push_back(center);
+    for(int i = 0; i < param_dim; i++)
+    {
+        Params p = center;
+        p[i] = cell_lo[i]; check_points.push_back(p);
+        p[i] = cell_hi[i]; check_points.push_back(p);
+    }
+    const int n = std::max(options.samples_per_axis, 1);
+    int num_samples = 1;
+    for(int i = 0; i < param_dim; i++)
+        num_samples *= n;
+    for(int s = 0; s < num_samples; s++)
+    {
+        Params p;
+        for(int i = 0, rest = s; i < param_dim; i++, rest /= n)
+            p[i] = cell_lo[i] + (cell_hi[i] - cell_lo[i]) * (rest % n + 0.5) / n;
+        check_points.push_back(p);
+    }
+
+    Eigen::MatrixXd M(fit_points.size(), param_dim + 1);
+    Eigen::MatrixXd U(fit_points.size(), control_dim);
+    for(std::size_t k = 0; k < fit_points.size(); k++)
+    {
+        const auto u = solve(fit_points[k]);
+        if(not u.has_value()) return {};
+        M.row(k) << fit_points[k].transpose(), 1.0;
+        U.row(k) = u.value().transpose();
+    }
+    const Eigen::MatrixXd coeffs = M.colPivHouseholderQr().solve(U);    // (param_dim + 1) x control_dim
+
+    const Control &tolerance = options.tolerance;
+    auto within_tolerance = [&coeffs, &tolerance](const Params &p, const Control &u)
+    {
+        Eigen::Matrix<double, 1, param_dim + 1> row;
+        row << p.transpose(), 1.0;
+        return (((row * coeffs).transpose() - u).cwiseAbs().array() <= tolerance.array()).all();
+    };
+    for(std::size_t k = 0; k < fit_points.size(); k++)
+        if(not within_tolerance(fit_points[k], U.row(k).transpose()))
+            return {};
+    for(const auto &p : check_points)
+    {
+        const auto u = solve(p);
+        if(not u.has_value() or not within_tolerance(p, u.value()))
+            return {};
+    }
+
+    Law law;
+    for(int r = 0; r < control_dim; r++)
+    {
+        for(int c = 0; c < param_dim; c++)
+            law.F[r * param_dim + c] = coeffs(c, r);
+        law.g[r] = coeffs(param_dim, r);
+    }
+    return law;
+}
+
+std::optional<ExplicitMPC::Control> ExplicitMPC::evaluate(const Params &theta) const
+{
+    if(nodes.empty()) return {};
+    for(int i = 0; i < param_dim; i++)
+        if(theta[i] < lo[i] or theta[i] > hi[i])
+            return {};
+    const Node *node = &nodes[0];
+    while(node->axis >= 0)
+        node = &nodes[theta[node->axis] < node->split ? node->child : node->child + 1];
+    if(node->child < 0) return {};
+
+    const Law &law = laws[node->child];
+    Control u;
+    for(int r = 0; r < control_dim; r++)
+    {
+        double v = law.g[r];
+        for(int c = 0; c < param_dim; c++)
+            v += law.F[r * param_dim + c] * theta[c];
+        u[r] = v;
+    }
+    return u;
+}
+
+std::size_t ExplicitMPC::num_leaves() const
+{
+    return std::count_if(nodes.begin(), nodes.end(), [](const auto &n){ return n.axis < 0; });
+}
+
+// file layout: magic, version, param_dim, control_dim, box lo and hi, node count, nodes, law count, laws
+namespace
+{
+    constexpr std::uint32_t MAGIC = 0x434d5045;    // "EMPC"
+    constexpr std::uint32_t VERSION = 1;
+    template<typename T> void write(std::ofstream &out, const T &v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+    template<typename T> bool read(std::ifstream &in, T &v) { return (bool)in.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+}
+
+bool ExplicitMPC::save(const std::string &file) const
+{
+    std::ofstream out(file, std::ios::binary);
+    if(not out) return false;
+    write(out, MAGIC); write(out, VERSION);
+    write(out, (std::uint32_t)param_dim); write(out, (std::uint32_t)control_dim);
+    write(out, lo); write(out, hi);
+    write(out, (std::uint32_t)nodes.size());
+    out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(Node));
+    write(out, (std::uint32_t)laws.size());
+    out.write(reinterpret_cast<const char*>(laws.data()), laws.size() * sizeof(Law));
+    return (bool)out;
+}
+
+bool ExplicitMPC::load(const std::string &file)
+{
+    std::ifstream in(file, std::ios::binary);
+    std::uint32_t magic, version, pdim, cdim, num_nodes, num_laws;
+    if(not in or not read(in, magic) or not read(in, version) or not read(in, pdim) or not read(in, cdim)
+       or magic != MAGIC or version != VERSION or pdim != param_dim or cdim != control_dim)
+    {
+        std::cout << __FUNCTION__ << " Not a valid explicit MPC file: " << file << std::endl;
+        return false;
+    }
+    std::vector<Node> new_nodes;
+    std::vector<Law> new_laws;
+    std::array<float, param_dim> new_lo, new_hi;
+    bool ok = read(in, new_lo) and read(in, new_hi) and read(in, num_nodes);
+    if(ok)
+    {
+        new_nodes.resize(num_nodes);
+        ok = (bool)in.read(reinterpret_cast<char*>(new_nodes.data()), num_nodes * sizeof(Node)) and read(in, num_laws);
+    }
+    if(ok)
+    {
+        new_laws.resize(num_laws);
+        ok = (bool)in.read(reinterpret_cast<char*>(new_laws.data()), num_laws * sizeof(Law));
+    }
+    // children come after their parent and every index is inside the arrays, so evaluate() needs no checks
+    for(std::size_t i = 0; i < new_nodes.size(); i++)
+    {
+        const auto &n = new_nodes[i];
+        if(n.axis >= param_dim or (n.axis >= 0 and (n.child <= (std::int32_t)i or n.child + 1 >= (std::int32_t)new_nodes.size()))
+           or (n.axis < 0 and n.child >= (std::int32_t)new_laws.size()))
+            ok = false;
+    }
+    if(not ok or new_nodes.empty())
+    {
+        std::cout << __FUNCTION__ << " Corrupt explicit MPC file: " << file << std::endl;
+        return false;
+    }
+    lo = new_lo; hi = new_hi;
+    nodes = std::move(new_nodes);
+    laws = std::move(new_laws);
+    return true;
+}
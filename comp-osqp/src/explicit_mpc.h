@@ -0,0 +1,73 @@
+//
+// Explicit (lookup table) version of the MPC law. The parameter box is split recursively in halves, like a k-d tree,
+// and each leaf stores an affine law u0 = F*theta + g fitted to the online QP solutions at its corners. Leaves where
+// the fit does not reach the tolerance at the maximum depth have no law, and the caller falls back to the online QP.
+// Limitation: a law is accepted after checking it against the QP on a dense lattice of interior points and the face
+// centers, not with a bound over the whole cell. The exact law is piecewise affine, so an active set boundary that
+// crosses a cell between samples can still give a larger error there. Denser sampling makes that less likely
+//
+
+#ifndef COMP_OSQP_EXPLICIT_MPC_H
+#define COMP_OSQP_EXPLICIT_MPC_H
+
+#include <Eigen/Dense>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ExplicitMPC
+{
+    public:
+        static constexpr int param_dim = 4;
+        static constexpr int control_dim = 3;
+        using Params = Eigen::Matrix<double, param_dim, 1>;
+        using Control = Eigen::Matrix<double, control_dim, 1>;
+        // online solution of the QP for a parameter vector, empty if the solver failed
+        using SolveFunction = std::function<std::optional<Control>(const Params &)>;
+
+        struct BuildOptions
+        {
+            Params lo, hi;              // parameter box
+            Control tolerance;          // max error of the affine law per control, at the verification points
+            int samples_per_axis = 4;   // interior verification lattice, samples_per_axis^param_dim points per cell
+            int max_depth = 10;         // deeper cells are left to the online QP
+        };
+
+        // offline
+        void build(const SolveFunction &solve, const BuildOptions &options);
+        bool save(const std::string &file) const;
+        // online
+        bool load(const std::string &file);
+        std::optional<Control> evaluate(const Params &theta) const;
+
+        bool empty() const                  { return nodes.empty(); };
+        std::size_t num_leaves() const;
+        std::size_t num_laws() const        { return laws.size(); };
+
+    private:
+        // internal nodes split 'axis' at 'split'; children are stored together, at 'child' and 'child'+1
+        // leaves have axis = -1 and 'child' is the index of their law, or -1 when there is none
+        struct Node
+        {
+            std::int32_t axis;
+            float split;
+            std::int32_t child;
+        };
+        struct Law
+        {
+            std::array<float, control_dim * param_dim> F;   // row major
+            std::array<float, control_dim> g;
+        };
+        std::array<float, param_dim> lo{}, hi{};
+        std::vector<Node> nodes;
+        std::vector<Law> laws;
+
+        void build_node(std::size_t index, const Params &cell_lo, const Params &cell_hi, int depth,
+                        const SolveFunction &solve, const BuildOptions &options);
+        std::optional<Law> fit_law(const Params &cell_lo, const Params &cell_hi, const SolveFunction &solve, const BuildOptions &options) const;
+};
+
+#endif //COMP_OSQP_EXPLICIT_MPC_H
@@ -90,6 +90,16 @@ void SpecificMonitor::readConfig(RoboCompCommonBehavior::ParameterList &params )
 	aux.editable = true;
 	configGetString( "","InnerModelPath", aux.value, "nofile");
 	params["InnerModelPath"] = aux;
+	configGetString( "","Formulation", aux.value, "AUTO");
+	params["Formulation"] = aux;
+	configGetString( "","Linearization", aux.value, "LTV");
+	params["Linearization"] = aux;
+	configGetString( "","Horizon", aux.value, "20");
+	params["Horizon"] = aux;
+	configGetString( "","ExplicitTable", aux.value, "");
+	params["ExplicitTable"] = aux;
+	configGetString( "","BuildExplicitTable", aux.value, "");
+	params["BuildExplicitTable"] = aux;
 }
 
 //Check parameters and transform them to worker structure
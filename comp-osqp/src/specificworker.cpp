@@ -20,6 +20,7 @@
 #include <cppitertools/range.hpp>
 #include <cppitertools/enumerate.hpp>
 #include <algorithm>
+#include <chrono>
 
 /**
 * \brief Default constructor
@@ -48,6 +49,20 @@ bool SpecificWorker::setParams(RoboCompCommonBehavior::ParameterList params)
 
     }
     catch(const std::exception &e) { qFatal("Error reading config params"); }
+    if(auto f = params.find("Formulation"); f != params.end())
+    {
+        if(f->second.value == "SPARSE") formulation = Formulation::SPARSE;
+        else if(f->second.value == "CONDENSED") formulation = Formulation::CONDENSED;
+        else formulation = Formulation::AUTO;
+    }
+    if(auto f = params.find("Linearization"); f != params.end())
+        linearization = f->second.value == "LTI" ? Linearization::LTI : Linearization::LTV;
+    if(auto f = params.find("Horizon"); f != params.end() and not f->second.value.empty())
+        horizon = std::stoi(f->second.value);
+    if(auto f = params.find("ExplicitTable"); f != params.end())
+        explicit_table_file = f->second.value;
+    if(auto f = params.find("BuildExplicitTable"); f != params.end())
+        build_explicit_table_file = f->second.value;
     return true;
 }
 
@@ -62,10 +77,20 @@ void SpecificWorker::initialize(int period)
     //view
     init_drawing(dim);
 
-    // optimizer
-    init_optmizer();
-
+    // optimizer. B depends on Period
     this->Period = 100;
+    if(not build_explicit_table_file.empty())
+    {
+        build_explicit_table(build_explicit_table_file);
+        QTimer::singleShot(200, qApp, SLOT(quit()));
+        return;
+    }
+    init_optmizer(formulation == Formulation::AUTO ? benchmark_formulations() : formulation);
+    if(not explicit_table_file.empty() and explicit_mpc.load(explicit_table_file))
+        qInfo() << __FUNCTION__ << "Explicit MPC table with" << explicit_mpc.num_leaves() << "regions," << explicit_mpc.num_laws() << "with a law";
+    if(not explicit_mpc.empty() and linearization != Linearization::LTI)
+        qWarning() << __FUNCTION__ << "Explicit MPC table built for LTI, ignored with LTV linearization";
+
     if(this->startup_check_flag)
         this->startup_check();
     else
@@ -90,8 +115,7 @@ void SpecificWorker::compute()
         xRef << t.value().x(), t.value().y(), ref_ang;
 
         solver.clearSolverVariables();
-        cast_MPC_to_QP_gradient(Q, xRef, horizon, gradient);
-        if (!solver.updateGradient(gradient)) return ;
+        if (!update_reference(xRef)) return ;
 
         // draw
         if(target_draw) scene.removeItem(target_draw);
@@ -119,16 +143,23 @@ void SpecificWorker::compute()
         }
 
         // update QP problem
-        compute_jacobians(A, B, bState.advVx*this->Period/1000, bState.advVz/this->Period/1000, bState.alpha );
-        cast_MPC_to_QP_constraint_matrix(A, B, horizon, linearMatrix);
-        if (!solver.updateLinearConstraintsMatrix(linearMatrix)) qWarning() << "SHIT";
-        update_constraint_vectors(x0, lowerBound, upperBound);
-        if (!solver.updateBounds(lowerBound, upperBound)) qWarning() << "SHIT";
-
-        // solve the QP problem
-        if (!solver.solve()) { qInfo() << "Out solve "; return;};
-        QPSolution = solver.getSolution();
-        ctr = QPSolution.block(state_dim * (horizon + 1), 0, control_dim, 1) * 2.4;
+        // explicit law where the table covers this state, online QP otherwise
+        const auto explicit_ctr = explicit_control(x0, xRef);
+        if (explicit_ctr.has_value())
+        {
+            ctr = explicit_ctr.value() * 2.4;
+            QPSolution.resize(0);   // no prediction to linearize along
+        }
+        else
+        {
+            update_linearization(bState);
+            if (!update_qp(x0)) qWarning() << "SHIT";
+
+            // solve the QP problem
+            if (!solver.solve()) { qInfo() << "Out solve "; return;};
+            QPSolution = solver.getSolution();
+            ctr = control_at(QPSolution, 0) * 2.4;
+        }
         //ctr = QPSolution.block(state_dim * (horizon + 1) + control_dim * 2, 0, control_dim, 1) * 2.4;
 
         // execute control
@@ -140,15 +171,19 @@ void SpecificWorker::compute()
         qInfo() << "\t" << " Target: " << xRef.x() << xRef.y() << xRef.z() ;
         qInfo() << "\t" << " Error: " << pos_error << rot_error;
         qInfo() << "----------------------------------------------------";
-        std::vector<std::tuple<float, float, float>> path;
-        for(std::uint32_t i=0; i<horizon*state_dim; i+=state_dim)
-            path.emplace_back(std::make_tuple(QPSolution(i, 0), QPSolution(i+1, 0), QPSolution(i+2, 0)));
-        draw_path(path);
-        for(int i=0; i<horizon*control_dim; i+=3)
+        if (QPSolution.size() > 0)
         {
-            StateSpaceVector s = QPSolution.block(i, 0, state_dim , 1);
-            ControlSpaceVector c = QPSolution.block(state_dim * (horizon + 1) + i, 0, control_dim , 1);
-            qInfo() << "------ " << (float)s.z() << (float)c.z() << ref_ang;
+            const auto states = predicted_states(QPSolution);
+            std::vector<std::tuple<float, float, float>> path;
+            for(std::uint32_t i=0; i<horizon; i++)
+                path.emplace_back(std::make_tuple(states[i].x(), states[i].y(), states[i].z()));
+            draw_path(path);
+            for(std::uint32_t i=0; i<horizon; i++)
+            {
+                const StateSpaceVector &s = states[i];
+                ControlSpaceVector c = control_at(QPSolution, i);
+                qInfo() << "------ " << (float)s.z() << (float)c.z() << ref_ang;
+            }
         }
         xGraph->addData(cont, ctr.x());
         yGraph->addData(cont, ctr.y());
@@ -160,27 +195,58 @@ void SpecificWorker::compute()
     }
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////
-void SpecificWorker::init_optmizer()
+void SpecificWorker::init_optmizer(Formulation form)
 {
+    formulation = form;
+    if (solver.isInitialized())
+    {
+        solver.clearSolver();
+        solver.data()->clearHessianMatrix();
+        solver.data()->clearLinearConstraintsMatrix();
+    }
+
     // set MPC problem quantities
     //set_dynamics_matrices(A, B);
+    x0.setZero();
+    xRef.setZero();
     compute_jacobians(A, B, 0., 0., 0.);
+    As.assign(horizon, A);
+    Bs.assign(horizon, B);
+    cs.assign(horizon, StateSpaceVector::Zero());
+    QPSolution.resize(0);
     set_inequality_constraints(xMax, xMin, uMax, uMin, Eigen::Vector3d::Zero());
     set_weight_matrices(Q, R);
 
     // cast the MPC problem as QP problem
-    cast_MPC_to_QP_hessian(Q, R, horizon, hessian);
-    cast_MPC_to_QP_gradient(Q, xRef, horizon, gradient);
-    cast_MPC_to_QP_constraint_matrix(A, B, horizon, linearMatrix);
-    cast_MPC_to_QP_constraint_vectors(xMax, xMin, uMax, uMin, x0, horizon, lowerBound, upperBound);
+    std::uint32_t num_variables = 0, num_constraints = 0;
+    switch (form)
+    {
+        case Formulation::SPARSE:
+            cast_MPC_to_QP_hessian(Q, R, horizon, hessian);
+            cast_MPC_to_QP_gradient(Q, xRef, horizon, gradient);
+            cast_MPC_to_QP_constraint_matrix(A, B, horizon, linearMatrix);
+            index_dynamic_entries(linearMatrix, horizon);
+            cast_MPC_to_QP_constraint_vectors(xMax, xMin, uMax, uMin, x0, horizon, lowerBound, upperBound);
+            num_variables = state_dim * (horizon + 1) + control_dim * horizon;
+            num_constraints = 2 * state_dim * (horizon + 1) + control_dim * horizon;
+            break;
+        case Formulation::CONDENSED:
+            cast_condensed_QP_pattern(horizon, hessian, linearMatrix);
+            update_condensed_QP(x0, xRef, horizon);
+            num_variables = control_dim * horizon;
+            num_constraints = state_dim * horizon + control_dim * horizon;
+            break;
+        case Formulation::AUTO:
+            qFatal("init_optimizer needs a concrete formulation");
+    }
 
     // settings
     //solver.settings()->setVerbosity(false);
     solver.settings()->setWarmStart(true);
 
     // set the initial data of the QP solver
-    solver.data()->setNumberOfVariables(state_dim * (horizon + 1) + control_dim * horizon);
-    solver.data()->setNumberOfConstraints(2 * state_dim * (horizon + 1) + control_dim * horizon);
+    solver.data()->setNumberOfVariables(num_variables);
+    solver.data()->setNumberOfConstraints(num_constraints);
     if (!solver.data()->setHessianMatrix(hessian)) qWarning() << "SHIT";
     if (!solver.data()->setGradient(gradient))qWarning() << "SHIT";
     if (!solver.data()->setLinearConstraintsMatrix(linearMatrix)) qWarning() << "SHIT";
@@ -191,6 +257,248 @@ void SpecificWorker::init_optmizer()
     if (!solver.initSolver()) qWarning() << "SHIT";
 }
 
+SpecificWorker::Formulation SpecificWorker::benchmark_formulations()
+{
+    // solves the same sequence of problems with both forms, a target ahead and the robot turning in place,
+    // and keeps the one with the lowest mean update + solve time
+    const int NUM_SOLVES = 50;
+    std::vector<std::pair<Formulation, double>> times;
+    for (auto form : {Formulation::SPARSE, Formulation::CONDENSED})
+    {
+        init_optmizer(form);
+        xRef << 1000, 2000, -atan2(1000, 2000);
+        solver.clearSolverVariables();
+        update_reference(xRef);
+        double total = 0;
+        for (int k = 0; k < NUM_SOLVES; k++)
+        {
+            const double alpha = 2 * M_PI * k / NUM_SOLVES;
+            x0 << 0, 0, alpha;
+            const auto begin = std::chrono::steady_clock::now();
+            compute_jacobians(A, B, 0., 0., alpha);
+            std::fill(As.begin(), As.end(), A);
+            std::fill(Bs.begin(), Bs.end(), B);
+            if (!update_qp(x0) or !solver.solve())
+            {
+                total = std::numeric_limits<double>::max();
+                break;
+            }
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
+        times.emplace_back(form, total / NUM_SOLVES);
+        qInfo() << __FUNCTION__ << (form == Formulation::SPARSE ? "SPARSE" : "CONDENSED") << times.back().second << "ms";
+    }
+    const auto best = std::ranges::min_element(times, {}, &std::pair<Formulation, double>::second);
+    qInfo() << __FUNCTION__ << "Using" << (best->first == Formulation::SPARSE ? "SPARSE" : "CONDENSED") << "formulation";
+    return best->first;
+}
+bool SpecificWorker::update_reference(const StateSpaceVector &xRef)
+{
+    switch (formulation)
+    {
+        case Formulation::SPARSE:
+            cast_MPC_to_QP_gradient(Q, xRef, horizon, gradient);
+            return solver.updateGradient(gradient);
+        default:    // the condensed gradient also depends on x0 and B, it is rebuilt in update_qp
+            return true;
+    }
+}
+bool SpecificWorker::update_qp(const StateSpaceVector &x0)
+{
+    // uses the per-step dynamics in As, Bs and cs
+    switch (formulation)
+    {
+        case Formulation::SPARSE:
+            update_constraint_vectors(x0, lowerBound, upperBound);
+            for (std::uint32_t k = 0; k < horizon; k++)     // -x_k+1 + A_k x_k + B_k u_k = -c_k
+            {
+                lowerBound.segment<state_dim>(state_dim * (k + 1)) = -cs[k];
+                upperBound.segment<state_dim>(state_dim * (k + 1)) = -cs[k];
+            }
+            return update_constraint_matrix_values(As, Bs) and solver.updateBounds(lowerBound, upperBound);
+        case Formulation::CONDENSED:
+            update_condensed_QP(x0, xRef, horizon);
+            return solver.updateHessianMatrix(hessian) and solver.updateLinearConstraintsMatrix(linearMatrix)
+                   and solver.updateGradient(gradient) and solver.updateBounds(lowerBound, upperBound);
+        default:
+            return false;
+    }
+}
+std::vector<SpecificWorker::StateSpaceVector> SpecificWorker::predicted_states(const Eigen::VectorXd &solution) const
+{
+    // x_0 ... x_horizon
+    std::vector<StateSpaceVector> states;
+    states.reserve(horizon + 1);
+    if (formulation == Formulation::CONDENSED)
+    {
+        const Eigen::VectorXd X = free_response + Su * solution;
+        states.push_back(x0);
+        for (std::uint32_t i = 0; i < horizon; i++)
+            states.emplace_back(X.segment<state_dim>(state_dim * i));
+    }
+    else
+        for (std::uint32_t i = 0; i < horizon + 1; i++)
+            states.emplace_back(solution.segment<state_dim>(state_dim * i));
+    return states;
+}
+SpecificWorker::ControlSpaceVector SpecificWorker::control_at(const Eigen::VectorXd &solution, std::uint32_t step) const
+{
+    const std::uint32_t offset = formulation == Formulation::CONDENSED ? 0 : state_dim * (horizon + 1);
+    return solution.segment<control_dim>(offset + control_dim * step);
+}
+void SpecificWorker::cast_condensed_QP_pattern(std::uint32_t horizon, Eigen::SparseMatrix<double> &hessianMatrix, Eigen::SparseMatrix<double> &constraintMatrix)
+{
+    // every entry that can be non zero is stored, so later value updates never change the pattern
+    const int nx = state_dim * horizon;
+    const int nu = control_dim * horizon;
+    hessianMatrix.resize(nu, nu);
+    hessianMatrix.reserve(Eigen::VectorXi::Constant(nu, nu));
+    for (int c = 0; c < nu; c++)
+        for (int r = 0; r < nu; r++)
+            hessianMatrix.insert(r, c) = 0;
+    hessianMatrix.makeCompressed();
+
+    // [Su; I]. Su is block lower triangular
+    constraintMatrix.resize(nx + nu, nu);
+    for (std::uint32_t j = 0; j < horizon; j++)
+        for (std::uint32_t k = 0; k < control_dim; k++)
+        {
+            const int col = control_dim * j + k;
+            for (std::uint32_t row = state_dim * j; row < (std::uint32_t)nx; row++)
+                constraintMatrix.insert(row, col) = 0;
+            constraintMatrix.insert(nx + col, col) = 1;
+        }
+    constraintMatrix.makeCompressed();
+}
+void SpecificWorker::update_condensed_QP(const StateSpaceVector &x0, const StateSpaceVector &xRef, std::uint32_t horizon)
+{
+    const int nx = state_dim * horizon;
+    const int nu = control_dim * horizon;
+
+    // x_i+1 = A_i x_i + B_i u_i + c_i, unrolled: the free response carries x0 and the c_i, Su the controls
+    free_response.resize(nx);
+    Su = Eigen::MatrixXd::Zero(nx, nu);
+    StateSpaceVector x = x0;
+    for (std::uint32_t i = 0; i < horizon; i++)
+    {
+        x = As[i] * x + cs[i];
+        free_response.segment<state_dim>(state_dim * i) = x;
+        Su.block<state_dim, control_dim>(state_dim * i, control_dim * i) = Bs[i];
+        for (std::uint32_t j = 0; j < i; j++)
+            Su.block<state_dim, control_dim>(state_dim * i, control_dim * j) = As[i] * Su.block<state_dim, control_dim>(state_dim * (i - 1), control_dim * j);
+    }
+
+    // cost over x_1 ... x_horizon and u_0 ... u_horizon-1, same weights as the sparse form
+    const Eigen::VectorXd Qbar = Q.diagonal().replicate(horizon, 1);
+    Eigen::MatrixXd H = Su.transpose() * Qbar.asDiagonal() * Su;
+    H.diagonal() += R.diagonal().replicate(horizon, 1);
+    gradient = Su.transpose() * (Qbar.asDiagonal() * (free_response - xRef.replicate(horizon, 1)));
+
+    // state bounds move with the free response, control bounds are the same
+    lowerBound.resize(nx + nu);
+    upperBound.resize(nx + nu);
+    lowerBound << xMin.replicate(horizon, 1) - free_response, uMin.replicate(horizon, 1);
+    upperBound << xMax.replicate(horizon, 1) - free_response, uMax.replicate(horizon, 1);
+
+    // write the values into the fixed patterns
+    for (int k = 0; k < hessian.outerSize(); k++)
+        for (Eigen::SparseMatrix<double>::InnerIterator it(hessian, k); it; ++it)
+            it.valueRef() = H(it.row(), it.col());
+    for (int k = 0; k < linearMatrix.outerSize(); k++)
+        for (Eigen::SparseMatrix<double>::InnerIterator it(linearMatrix, k); it; ++it)
+            if (it.row() < nx)
+                it.valueRef() = Su(it.row(), it.col());
+}
+void SpecificWorker::build_explicit_table(const std::string &file)
+{
+    // law of the LTI sparse MPC. The arena bounds on x, y are dropped so the QP only depends on the position
+    // error; explicit_control() checks them at run time. Tight tolerances and polishing give exact active sets
+    solver.settings()->setPolish(true);
+    solver.settings()->setAbsoluteTolerance(1e-6);
+    solver.settings()->setRelativeTolerance(1e-6);
+    solver.settings()->setVerbosity(false);
+    linearization = Linearization::LTI;
+    init_optmizer(Formulation::SPARSE);
+    xMax.head<2>().setConstant(OsqpEigen::INFTY);
+    xMin.head<2>().setConstant(-OsqpEigen::INFTY);
+    cast_MPC_to_QP_constraint_vectors(xMax, xMin, uMax, uMin, x0, horizon, lowerBound, upperBound);
+    if (!solver.updateBounds(lowerBound, upperBound)) qWarning() << "SHIT";
+
+    auto solve = [this](const ExplicitMPC::Params &theta) -> std::optional<ExplicitMPC::Control>
+    {
+        x0 << theta[0], theta[1], theta[2];
+        xRef << 0., 0., theta[3];
+        compute_jacobians(A, B, 0., 0., theta[2]);
+        std::fill(As.begin(), As.end(), A);
+        std::fill(Bs.begin(), Bs.end(), B);
+        if (!update_reference(xRef) or !update_qp(x0) or !solver.solve())
+            return {};
+        return control_at(solver.getSolution(), 0);
+    };
+    ExplicitMPC::BuildOptions options;
+    options.lo << -5000., -5000., -M_PI, -M_PI;
+    options.hi << 5000., 5000., M_PI, M_PI;
+    options.tolerance << 5., 5., 0.01;
+    const auto begin = std::chrono::steady_clock::now();
+    explicit_mpc.build(solve, options);
+    qInfo() << __FUNCTION__ << explicit_mpc.num_leaves() << "regions," << explicit_mpc.num_laws() << "with a law, in"
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() << "s";
+    if (not explicit_mpc.save(file))
+        qWarning() << __FUNCTION__ << "Could not write" << QString::fromStdString(file);
+}
+std::optional<SpecificWorker::ControlSpaceVector> SpecificWorker::explicit_control(const StateSpaceVector &x0, const StateSpaceVector &xRef)
+{
+    // the table is the law of the LTI model. With LTV the online QP uses other dynamics and the law does not apply
+    if (explicit_mpc.empty() or linearization != Linearization::LTI) return {};
+    const auto u = explicit_mpc.evaluate(ExplicitMPC::Params(x0.x() - xRef.x(), x0.y() - xRef.y(), x0.z(), xRef.z()));
+    if (not u.has_value()) return {};
+    const ControlSpaceVector ctr = u.value().cwiseMax(uMin).cwiseMin(uMax);
+
+    // the table ignores the arena bounds, so the next state must stay inside them
+    AMatrix A0; BMatrix B0;
+    compute_jacobians(A0, B0, 0., 0., x0.z());
+    const StateSpaceVector next = A0 * x0 + B0 * ctr;
+    if ((next.array() < xMin.array()).any() or (next.array() > xMax.array()).any())
+        return {};
+    return ctr;
+}
+void SpecificWorker::update_linearization(const RoboCompGenericBase::TBaseState &bState)
+{
+    switch (linearization)
+    {
+        case Linearization::LTI:
+            compute_jacobians(A, B, bState.advVx*this->Period/1000, bState.advVz*this->Period/1000, bState.alpha);
+            std::fill(As.begin(), As.end(), A);
+            std::fill(Bs.begin(), Bs.end(), B);
+            std::fill(cs.begin(), cs.end(), StateSpaceVector::Zero());
+            break;
+        case Linearization::LTV:
+        {
+            // previous prediction shifted one step, the last point repeated. Without one, the current pose at rest
+            std::vector<StateSpaceVector> states;
+            if (QPSolution.size() > 0)
+                states = predicted_states(QPSolution);
+            for (std::uint32_t k = 0; k < horizon; k++)
+            {
+                const bool has_previous = not states.empty();
+                const StateSpaceVector xbar = has_previous ? states[std::min(k + 1, horizon)] : x0;
+                const ControlSpaceVector ubar = has_previous ? control_at(QPSolution, std::min(k + 1, horizon - 1)) : ControlSpaceVector::Zero();
+                linearize(xbar, ubar, As[k], Bs[k], cs[k]);
+            }
+            break;
+        }
+    }
+}
+void SpecificWorker::linearize(const StateSpaceVector &xbar, const ControlSpaceVector &ubar, AMatrix &A, BMatrix &B, StateSpaceVector &c)
+{
+    // x_k+1 = x_k + R(alpha_k) (u_x, u_y) and alpha_k+1 = alpha_k + Period/100 u_w
+    const double alfa = xbar.z();
+    compute_jacobians(A, B, ubar.x(), ubar.y(), alfa);
+    A << 1., 0., -ubar.x() * sin(alfa) - ubar.y() * cos(alfa),
+         0., 1.,  ubar.x() * cos(alfa) - ubar.y() * sin(alfa),
+         0., 0.,  1.;
+    c = (AMatrix::Identity() - A) * xbar;   // f(xbar, ubar) - A xbar - B ubar
+}
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 void SpecificWorker::compute_jacobians(AMatrix &A, BMatrix &B, double u_x, double u_y, double alfa)
 {
@@ -286,7 +594,7 @@ void SpecificWorker::cast_MPC_to_QP_constraint_matrix(const AMatrix &dynamicMatr
             for(std::uint32_t k = 0; k<state_dim; k++)
             {
                 float value = dynamicMatrix(j,k);
-                if(value != 0)
+                if(value != 0 or is_A_dynamic(j, k))
                     constraintMatrix.insert(state_dim * (i+1) + j, state_dim * i + k) = value;
             }
 
@@ -295,12 +603,43 @@ void SpecificWorker::cast_MPC_to_QP_constraint_matrix(const AMatrix &dynamicMatr
             for(std::uint32_t k = 0; k < control_dim; k++)
             {
                 float value = controlMatrix(j,k);
-                if(value != 0)
+                if(value != 0 or is_B_dynamic(j, k))   // dynamic entries stay in the pattern even when zero
                     constraintMatrix.insert(state_dim*(i+1)+j, control_dim*i+k+state_dim*(horizon + 1)) = value;
             }
 
     for(std::uint32_t i = 0; i<state_dim*(horizon+1) + control_dim*horizon; i++)
         constraintMatrix.insert(i+(horizon+1)*state_dim, i) = 1;
+    constraintMatrix.makeCompressed();
+}
+void SpecificWorker::index_dynamic_entries(const Eigen::SparseMatrix<double> &constraintMatrix, std::uint32_t horizon)
+{
+    // OsqpEigen copies the compressed column-major arrays as they are, so Eigen's value index is also OSQP's
+    dynamic_value_idx.clear();
+    for(std::uint32_t i = 0; i < horizon; i++)
+        for(const auto &e : dynamic_entries)
+        {
+            const int row = state_dim*(i+1)+e.row;
+            const int col = e.in_A ? state_dim*i+e.col : control_dim*i+e.col+state_dim*(horizon + 1);
+            const auto begin = constraintMatrix.innerIndexPtr() + constraintMatrix.outerIndexPtr()[col];
+            const auto end = constraintMatrix.innerIndexPtr() + constraintMatrix.outerIndexPtr()[col+1];
+            const auto it = std::lower_bound(begin, end, row);
+            if(it == end or *it != row)
+                qFatal("Dynamic entry missing from the constraint matrix pattern");
+            dynamic_value_idx.push_back(it - constraintMatrix.innerIndexPtr());
+        }
+    dynamic_values.resize(dynamic_value_idx.size());
+}
+bool SpecificWorker::update_constraint_matrix_values(const std::vector<AMatrix> &As, const std::vector<BMatrix> &Bs)
+{
+    // writes the values in place and sends only those to OSQP, keeping its factorization pattern
+    for(std::size_t n = 0; n < dynamic_value_idx.size(); n++)
+    {
+        const auto step = n / dynamic_entries.size();
+        const auto &e = dynamic_entries[n % dynamic_entries.size()];
+        dynamic_values[n] = e.in_A ? As[step](e.row, e.col) : Bs[step](e.row, e.col);
+        linearMatrix.valuePtr()[dynamic_value_idx[n]] = dynamic_values[n];
+    }
+    return osqp_update_A(solver.workspace().get(), dynamic_values.data(), dynamic_value_idx.data(), dynamic_value_idx.size()) == 0;
 }
 void SpecificWorker::cast_MPC_to_QP_constraint_vectors(const StateConstraintsMatrix &xMax, const StateConstraintsMatrix &xMin,
                                                        const ControlConstraintsMatrix &uMax, const ControlConstraintsMatrix &uMin,
@@ -35,8 +35,10 @@
 #include "grid.h"
 #include "OsqpEigen/OsqpEigen.h"
 #include <Eigen/Dense>
+#include <array>
 #include <doublebuffer/DoubleBuffer.h>
 #include "qcustomplot.h"
+#include "explicit_mpc.h"
 
 
 class MyScene : public QGraphicsScene
@@ -141,7 +143,7 @@ private:
     using StateSpaceVector = Eigen::Matrix<double, state_dim, 1>;
     using ControlSpaceVector = Eigen::Matrix<double, control_dim, 1>;
 
-    const std::uint32_t horizon = 20;
+    std::uint32_t horizon = 20;
 
     OsqpEigen::Solver solver;
 
@@ -174,7 +176,31 @@ private:
     Eigen::VectorXd lowerBound;
     Eigen::VectorXd upperBound;
 
-    void init_optmizer();
+    // sparse: states and controls are decision variables, constraint matrix holds the dynamics
+    // condensed: only controls, states are eliminated as X = free_response + Su*U and the QP is dense
+    enum class Formulation {SPARSE, CONDENSED, AUTO};
+    Formulation formulation = Formulation::AUTO;
+    Eigen::MatrixXd Su;                 // condensed prediction X = free_response + Su*U for x_1 ... x_horizon
+    Eigen::VectorXd free_response;
+
+    void init_optmizer(Formulation form);
+    Formulation benchmark_formulations();
+    bool update_reference(const StateSpaceVector &xRef);
+    bool update_qp(const StateSpaceVector &x0);
+    std::vector<StateSpaceVector> predicted_states(const Eigen::VectorXd &solution) const;
+    ControlSpaceVector control_at(const Eigen::VectorXd &solution, std::uint32_t step) const;
+    void cast_condensed_QP_pattern(std::uint32_t horizon, Eigen::SparseMatrix<double> &hessianMatrix, Eigen::SparseMatrix<double> &constraintMatrix);
+    void update_condensed_QP(const StateSpaceVector &x0, const StateSpaceVector &xRef, std::uint32_t horizon);
+
+    // LTI: one A, B pair from the current pose for the whole horizon
+    // LTV: x_k+1 = A_k x_k + B_k u_k + c_k, linearized at each step along the previous predicted trajectory
+    enum class Linearization {LTI, LTV};
+    Linearization linearization = Linearization::LTV;
+    std::vector<AMatrix> As;
+    std::vector<BMatrix> Bs;
+    std::vector<StateSpaceVector> cs;
+    void update_linearization(const RoboCompGenericBase::TBaseState &bState);
+    void linearize(const StateSpaceVector &xbar, const ControlSpaceVector &ubar, AMatrix &A, BMatrix &B, StateSpaceVector &c);
     void set_inequality_constraints(StateConstraintsMatrix &xMax, StateConstraintsMatrix&xMin,
                                     ControlConstraintsMatrix &uMax, ControlConstraintsMatrix &uMin,
                                     const ControlConstraintsMatrix &uzero);
@@ -188,6 +214,25 @@ private:
                                       const StateSpaceVector &x0, std::uint32_t horizon, Eigen::VectorXd &lowerBound, Eigen::VectorXd &upperBound);
     double get_error_norm(const StateSpaceVector &x, const StateSpaceVector &xRef);
     void compute_jacobians(AMatrix &A, BMatrix &B, double u_x, double u_y, double alfa);
+
+    // explicit LTI law over theta = (x - x_ref, y - y_ref, alpha, alpha_ref), built offline with the same QP.
+    // Only used with Linearization=LTI, the online QP is solved otherwise
+    ExplicitMPC explicit_mpc;
+    std::string explicit_table_file, build_explicit_table_file;
+    void build_explicit_table(const std::string &file);
+    std::optional<ControlSpaceVector> explicit_control(const StateSpaceVector &x0, const StateSpaceVector &xRef);
+
+    // incremental update of the constraint matrix. Only the heading column of A and the rotation block of B
+    // change, so their entries are always present in the sparsity pattern and their CSC positions are computed once
+    struct DynamicEntry { bool in_A; int row, col; };
+    static constexpr std::array<DynamicEntry, 6> dynamic_entries{{{true, 0, 2}, {true, 1, 2},
+                                                                   {false, 0, 0}, {false, 0, 1}, {false, 1, 0}, {false, 1, 1}}};
+    static bool is_A_dynamic(int row, int col)   { return row < 2 and col == 2; };
+    static bool is_B_dynamic(int row, int col)   { return row < 2 and col < 2; };
+    std::vector<c_int> dynamic_value_idx;   // CSC value index of each dynamic entry, step by step
+    std::vector<c_float> dynamic_values;    // new values, same order as dynamic_value_idx
+    void index_dynamic_entries(const Eigen::SparseMatrix<double> &constraintMatrix, std::uint32_t horizon);
+    bool update_constraint_matrix_values(const std::vector<AMatrix> &As, const std::vector<BMatrix> &Bs);
 };
 
 
@@ -86,10 +86,18 @@ bool SpecificMonitor::sendParamsToWorker(RoboCompCommonBehavior::ParameterList p
 ///We need to supply a list of accepted values to each call
 void SpecificMonitor::readConfig(RoboCompCommonBehavior::ParameterList &params )
 {
-//	RoboCompCommonBehavior::Parameter aux;
-//	aux.editable = true;
+	RoboCompCommonBehavior::Parameter aux;
+	aux.editable = true;
 //	configGetString( "","InnerModelPath", aux.value, "nofile");
 //	params["InnerModelPath"] = aux;
+	configGetString( "","DWAAdvanceSamples", aux.value, "37");
+	params["DWAAdvanceSamples"] = aux;
+	configGetString( "","DWARotationSamples", aux.value, "21");
+	params["DWARotationSamples"] = aux;
+	configGetString( "","DWAArcStep", aux.value, "200");
+	params["DWAArcStep"] = aux;
+	configGetString( "","DWASearch", aux.value, "LATTICE");
+	params["DWASearch"] = aux;
 }
 
 //Check parameters and transform them to worker structure
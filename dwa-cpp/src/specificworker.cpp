@@ -40,6 +40,20 @@ SpecificWorker::~SpecificWorker()
 
 bool SpecificWorker::setParams(RoboCompCommonBehavior::ParameterList params)
 {
+    // dwa velocity lattice: increments in [-max, max] added to the current speeds, candidates beyond max skipped,
+    // sampling density from config
+    Rollout::Lattice lattice;
+    lattice.adv_min = -constants.max_advance_speed; lattice.adv_max = constants.max_advance_speed;
+    lattice.rot_min = -constants.max_rotation_speed; lattice.rot_max = constants.max_rotation_speed;
+    lattice.max_adv = constants.max_advance_speed;
+    lattice.max_rot = constants.max_rotation_speed;
+    lattice.adv_samples = std::stoi(params.at("DWAAdvanceSamples").value);
+    lattice.rot_samples = std::stoi(params.at("DWARotationSamples").value);
+    lattice.step_along_arc = std::stof(params.at("DWAArcStep").value);
+    lattice.time_ahead = constants.time_ahead;
+    lattice.min_distance = constants.robot_semi_width;
+    rollout.set_lattice(lattice);
+    search = params.at("DWASearch").value == "REFINED" ? Search::REFINED : Search::LATTICE;
 	return true;
 }
 
@@ -85,6 +99,7 @@ void SpecificWorker::initialize(int period)
                           QPointF(constants.robot_semi_width*1.2, constants.robot_semi_length) <<
                           QPointF(constants.robot_semi_width, -constants.robot_semi_length) <<
                           QPointF(-constants.robot_semi_width, -constants.robot_semi_length);
+        polygon_robot_in_laser = laser_draw_polygon->mapFromParent(polygon_robot);
 
         // QCustomPlot
         custom_plot.setParent(timeseries_frame);
@@ -119,6 +134,7 @@ void SpecificWorker::compute()
 
     const auto &[l_poly, ldata] = read_laser();
     laser_poly = l_poly;
+    free_space.update(ldata, constants.robot_length);   // the unseen sector behind is taken as free up to the robot's length
 
     // Bill
 //    if(auto t = read_bill(); t.has_value())
@@ -135,7 +151,7 @@ void SpecificWorker::compute()
             auto s_target_in_robot = from_world_to_robot(s_target.to_eigen(), r_state);
 
             Result res;
-            if( auto res_o =  control(s_target_in_robot, laser_poly, advance, rotation, Eigen::Vector3f(r_state.x, r_state.y, r_state.rz),
+            if( auto res_o =  control(s_target_in_robot, advance, rotation, Eigen::Vector3f(r_state.x, r_state.y, r_state.rz),
                                                      &viewer_robot->scene); not res_o.has_value())
             {   // no control
                 qInfo() << __FUNCTION__ << "NO CONTROL";
@@ -171,37 +187,19 @@ SpecificWorker::Target SpecificWorker::sub_target(const Target &target, const QP
     if(former_draw != nullptr)
         viewer_robot->scene.removeItem(former_draw);
 
+    // locate openings. Tracked from scan to scan, so updated every cycle even if the target is in sight
+    gap_detector.update(ldata);
+
     // if target inside laser_polygon return
     auto target_in_robot = from_world_to_robot( target.to_eigen(), r_state_global);
     if(poly.containsPoint(QPointF(target_in_robot.x(), target_in_robot.y()), Qt::WindingFill))
         return target;
 
-    // locate openings
-    std::vector<float> derivatives(ldata.size());
-    derivatives[0] = 0;
-    for (const auto &&[k, l]: iter::sliding_window(ldata, 2) | iter::enumerate)
-        derivatives[k + 1] = l[1].dist - l[0].dist;
-
-    // locate peaks
-    std::vector<Eigen::Vector2f> peaks;
-    for (const auto &&[k, der]: iter::enumerate(derivatives))
-        if (fabs(der) > constants.peak_threshold)
-        {
-            RoboCompLaser::TData l;
-            l = ldata.at(k - 1);
-            auto one = Eigen::Vector2f(l.dist * sin(l.angle), l.dist * cos(l.angle));
-            l = ldata.at(k);
-            auto two = Eigen::Vector2f(l.dist * sin(l.angle), l.dist * cos(l.angle));
-            peaks.push_back((one + two) / 2.f);
-        }
-
-    // if no peaks return
-    if(peaks.empty())
+    // select closest opening to target, keeping the previous one if it is still close enough
+    auto gap = gap_detector.select(target_in_robot);
+    if(not gap.has_value())
         return target;
-
-    // select closest opening to robot
-    auto min = std::ranges::min_element(peaks, [target_in_robot](auto a, auto b){ return (target_in_robot-a).norm() < (target_in_robot-b).norm();});
-    auto candidate = *min;
+    auto candidate = gap->center;
 
     // if too close to subtarget ignore
     if( candidate.norm() < 200)
@@ -214,7 +212,7 @@ SpecificWorker::Target SpecificWorker::sub_target(const Target &target, const QP
     // return target
     Target t;
     t.active = true;
-    auto pos = from_robot_to_world(*min, Eigen::Vector3f(r_state_global.x, r_state_global.y, r_state_global.rz));
+    auto pos = from_robot_to_world(candidate, Eigen::Vector3f(r_state_global.x, r_state_global.y, r_state_global.rz));
     t.pos = QPointF(pos.x(), pos.y());
     former_draw = viewer_robot->scene.addRect(t.pos.x()-100, t.pos.y()-100, 200, 200, QPen(QColor("blue")), QBrush(QColor("blue")));
 
@@ -301,18 +299,18 @@ bool SpecificWorker::do_if_stuck(float adv, float rot, const RoboCompFullPoseEst
     }
     return false;
 }
-std::optional<SpecificWorker::Result> SpecificWorker::control(const Eigen::Vector2f &target_r, const QPolygonF &laser_poly,
+std::optional<SpecificWorker::Result> SpecificWorker::control(const Eigen::Vector2f &target_r,
                                                double advance, double rot, const Eigen::Vector3f &robot,
                                                QGraphicsScene *scene)
 {
-    // compute future positions of the robot
-    auto point_list = compute_predictions(advance, rot, laser_poly);
+    // future positions of the robot, all the arcs of the lattice at once
+    const auto &samples = rollout.compute(advance, rot);
 
     // compute best value
-    auto best_choice = compute_optimus(point_list, target_r);
+    auto best_choice = compute_optimus(samples, target_r);
 
     if(scene != nullptr)
-        draw_dwa(robot, point_list, best_choice, scene);
+        draw_dwa(robot, samples, best_choice, scene);
 
     if (best_choice.has_value())
     {
@@ -322,45 +320,7 @@ std::optional<SpecificWorker::Result> SpecificWorker::control(const Eigen::Vecto
     else
         return {};
 }
-std::vector<SpecificWorker::Result> SpecificWorker::compute_predictions(float current_adv, float current_rot, const QPolygonF &laser_poly)
-{
-    std::vector<Result> list_points;
-    for (float v = -constants.max_advance_speed; v <= constants.max_advance_speed; v += 50) //advance
-    {
-        float new_adv = current_adv + v;
-        if (fabs(new_adv) > constants.max_advance_speed)
-            continue;
-        for (float w = -constants.max_rotation_speed; w <= constants.max_rotation_speed; w += 0.1) //rotation
-        {
-            float new_rot = -current_rot + w;
-            if (fabs(new_rot) > constants.max_rotation_speed)
-                continue;
-            if (fabs(w) > 0.001)  // avoid division by zero to compute the radius
-            {
-                float r = new_adv / new_rot; // radio de giro ubicado en el eje x del robot
-                float arc_length = new_rot * constants.time_ahead * r;
-                for (float t = constants.step_along_arc; t < arc_length; t += constants.step_along_arc)
-                {
-                    float x = r - r * cos(t / r);
-                    float y = r * sin(t / r);  // circle parametric coordinates
-                    auto point = std::make_tuple(x, y, new_adv, new_rot, t / r);
-                    if (sqrt(x * x + y * y) > constants.robot_semi_width and point_reachable_by_robot(point, laser_poly)) // skip points in the robot
-                        list_points.emplace_back(std::move(point));
-                }
-            } else // para evitar la división por cero en el cálculo de r
-            {
-                for (float t = constants.step_along_arc; t < new_adv * constants.time_ahead; t += constants.step_along_arc)
-                {
-                    auto point = std::make_tuple(0.f, t, new_adv, new_rot, new_rot * constants.time_ahead);
-                    if (t > constants.robot_semi_width and point_reachable_by_robot(point, laser_poly))
-                        list_points.emplace_back(std::make_tuple(0.f, t, new_adv, new_rot, new_rot * constants.time_ahead));
-                }
-            }
-        }
-    }
-    return list_points;
-}
-bool SpecificWorker::point_reachable_by_robot(const Result &point, const QPolygonF &laser_poly)
+bool SpecificWorker::point_reachable_by_robot(const Result &point) const
 {
     auto [x, y, adv, giro, ang] = point;
     auto goal_r = Eigen::Vector2f(x,y);
@@ -368,50 +328,58 @@ bool SpecificWorker::point_reachable_by_robot(const Result &point, const QPolygo
     float ang_delta = ang / parts;
     float init_ang = 0;
 
-    auto linl = laser_draw_polygon->mapFromParent(laser_poly);
-    auto lp = laser_draw_polygon->mapFromParent(polygon_robot);
-
     for(const auto &l: iter::range(0.0, 1.0, 1.0/parts))
     {
         init_ang += ang_delta;
         auto p = to_qpointf(goal_r * l);
-        auto temp_robot = QTransform().rotate(init_ang).translate(p.x(), p.y()).map(lp);  // compute incremental rotation
-        if (auto res = std::ranges::find_if_not(temp_robot, [linl](const auto &p)
-            { return linl.containsPoint(p, Qt::OddEvenFill); }); res != std::end(temp_robot))
+        auto temp_robot = QTransform().rotate(init_ang).translate(p.x(), p.y()).map(polygon_robot_in_laser);  // compute incremental rotation
+        if (auto res = std::ranges::find_if_not(temp_robot, [this](const auto &p)
+            { return free_space.is_free(p.x(), p.y()); }); res != std::end(temp_robot))
         {
             return false;
         }
     }
     return true;
 }
-std::optional<SpecificWorker::Result> SpecificWorker::compute_optimus(const std::vector<Result> &points,
+std::optional<SpecificWorker::Result> SpecificWorker::compute_optimus(const Rollout::Samples &s,
                                                                       const Eigen::Vector2f &tr)
 {
     static float prev_advance = 0, prev_rot = 0;
-    std::vector<std::tuple<float, Result>> values(points.size());
-    for(auto &&[k, point] : iter::enumerate(points))
+    auto score = [this, &tr](float x, float y, float adv, float giro)
     {
-        auto [x, y, adv, giro, ang] = point;
         float dist_to_target = (Eigen::Vector2f(x, y) - tr).norm();
         float turn_variation  = fabs(giro-prev_rot);
         float advance_variation = fabs(adv-prev_advance);
-        values[k] = std::make_tuple(constants.A_dist_factor*dist_to_target +
-                                    constants.B_turn_factor*turn_variation +
-                                    constants.C_advance_factor*advance_variation, point);
-    }
-    auto min = std::ranges::min_element(values, [](auto &a, auto &b){ return std::get<0>(a) < std::get<0>(b);});
-    if(min != values.end())
+        return constants.A_dist_factor*dist_to_target +
+               constants.B_turn_factor*turn_variation +
+               constants.C_advance_factor*advance_variation;
+    };
+    // each arc is followed until its first blocked point, scoring the points as they are found reachable
+    auto best = arc_search.search(s,
+            [this, &s](std::uint32_t i){ return point_reachable_by_robot(std::make_tuple(s.x[i], s.y[i], s.adv[i], s.rot[i], s.ang[i])); },
+            [&s, &score](std::uint32_t i){ return score(s.x[i], s.y[i], s.adv[i], s.rot[i]); });
+    if(not best.valid())
+        return {};
+
+    const auto i = best.index;
+    Result r = std::make_tuple(s.x[i], s.y[i], s.adv[i], s.rot[i], s.ang[i]);
+    if(search == Search::REFINED)
     {
-        Result r = std::get<Result>(*min);
-        auto &[x, y, adv, giro, ang] = r;
-        prev_advance = adv;
-        prev_rot = giro;
-        return r;
+        auto c = refiner.refine({s.x[i], s.y[i], s.adv[i], s.rot[i], s.ang[i], best.cost}, s.t[i], rollout.get_lattice(),
+                                [this, &score](float x, float y, float adv, float giro, float ang)
+                                {
+                                    if(not point_reachable_by_robot(std::make_tuple(x, y, adv, giro, ang)))
+                                        return std::numeric_limits<float>::infinity();
+                                    return score(x, y, adv, giro);
+                                });
+        r = std::make_tuple(c.x, c.y, c.adv, c.rot, c.ang);
     }
-    else
-        return {};
+    auto &[x, y, adv, giro, ang] = r;
+    prev_advance = adv;
+    prev_rot = giro;
+    return r;
 }
-void SpecificWorker::draw_dwa(const Eigen::Vector3f &robot, const std::vector <Result> &puntos,
+void SpecificWorker::draw_dwa(const Eigen::Vector3f &robot, const Rollout::Samples &samples,
                               const std::optional<Result> &best, QGraphicsScene *scene)
 {
     static std::vector<QGraphicsEllipseItem *> arcs_vector;
@@ -420,15 +388,18 @@ void SpecificWorker::draw_dwa(const Eigen::Vector3f &robot, const std::vector <R
         scene->removeItem(arc);
     arcs_vector.clear();
 
+    // reachable part of each arc in the last search
     QColor col("Blue");
-    for (auto &[x, y, vx, wx, a] : puntos)
-    {
-        //QPointF centro = robot_draw_polygon_draw->mapToScene(x, y);
-        QPointF centro = to_qpointf(from_robot_to_world(Eigen::Vector2f(x, y), robot));
-        auto arc = scene->addEllipse(centro.x(), centro.y(), 50, 50, QPen(col, 10));
-        arc->setZValue(30);
-        arcs_vector.push_back(arc);
-    }
+    const auto &reachable = arc_search.reachable_points();
+    for (std::size_t a = 0; a < samples.num_arcs(); a++)
+        for (auto i = samples.arc_begin[a]; i < samples.arc_begin[a] + reachable[a]; i++)
+        {
+            //QPointF centro = robot_draw_polygon_draw->mapToScene(x, y);
+            QPointF centro = to_qpointf(from_robot_to_world(Eigen::Vector2f(samples.x[i], samples.y[i]), robot));
+            auto arc = scene->addEllipse(centro.x(), centro.y(), 50, 50, QPen(col, 10));
+            arc->setZValue(30);
+            arcs_vector.push_back(arc);
+        }
 
     if(best.has_value())
     {
@@ -482,14 +453,9 @@ std::tuple<QPolygonF, RoboCompLaser::TLaserData> SpecificWorker::read_laser()
     try
     {
         ldata = laser_proxy->getLaserData();
-        float dist_ant = 50;
+        laser_filter.filter_beams(ldata);
         for (auto &&l : ldata)
-        {
-            if (l.dist < 50)
-                l.dist = dist_ant;
-            dist_ant = l.dist;
             poly_robot << QPointF(l.dist * sin(l.angle), l.dist * cos(l.angle));
-        }
         // Simplify laser contour with Ramer-Douglas-Peucker
         //poly_robot = ramer_douglas_peucker(ldata, constants.MAX_RDP_DEVIATION_mm);
         // add robot contour  wrt laser_location
@@ -542,59 +508,20 @@ QPolygonF SpecificWorker::ramer_douglas_peucker(RoboCompLaser::TLaserData &ldata
         qWarning() << __FUNCTION__ << "Not enough points to simplify";
         return QPolygonF();
     }
-    std::vector<Point> pointList(ldata.size());
     float dist_ant = 50;
-    for (auto &&[i, l] : ldata | iter::enumerate) {
+    for (auto &l : ldata)
+    {
         if (l.dist < 30)
             l.dist = dist_ant;
         else
             dist_ant = l.dist;
-        pointList[i] = std::make_pair(l.dist * sin(l.angle), l.dist * cos(l.angle));
     }
-    std::vector<Point> pointListOut;
-    ramer_douglas_peucker_rec(pointList, epsilon, pointListOut);
-    QPolygonF poly(pointListOut.size());
-    for (auto &&[i, p] : pointListOut | iter::enumerate)
-        poly[i] = QPointF(p.first, p.second);
+    const auto &kept = rdp.simplify_scan(ldata, epsilon);
+    QPolygonF poly(kept.size());
+    for (auto &&[k, i] : kept | iter::enumerate)
+        poly[k] = QPointF(rdp.points_x()[i], rdp.points_y()[i]);
     return poly;
 }
-void SpecificWorker::ramer_douglas_peucker_rec(const vector<Point> &pointList, double epsilon, std::vector<Point> &out)
-{
-    // Find the point with the maximum distance from line between start and end
-    auto line = Eigen::ParametrizedLine<float, 2>::Through(Eigen::Vector2f(pointList.front().first, pointList.front().second),
-                                                           Eigen::Vector2f(pointList.back().first, pointList.back().second));
-    auto max = std::max_element(pointList.begin()+1, pointList.end(), [line](auto &a, auto &b)
-    { return line.distance(Eigen::Vector2f(a.first, a.second)) < line.distance(Eigen::Vector2f(b.first, b.second));});
-
-    // If max distance is greater than epsilon, recursively simplify
-    float dmax =  line.distance(Eigen::Vector2f((*max).first, (*max).second));
-    if(dmax > epsilon)
-    {
-        // Recursive call
-        std::vector<Point> recResults1;
-        std::vector<Point> recResults2;
-        std::vector<Point> firstLine(pointList.begin(), max + 1);
-        std::vector<Point> lastLine(max, pointList.end());
-        ramer_douglas_peucker_rec(firstLine, epsilon, recResults1);
-        ramer_douglas_peucker_rec(lastLine, epsilon, recResults2);
-
-        // Build the result list
-        out.assign(recResults1.begin(), recResults1.end() - 1);
-        out.insert(out.end(), recResults2.begin(), recResults2.end());
-        if (out.size() < 2)
-        {
-            qWarning() << __FUNCTION__ << "Problem assembling output";
-            return;
-        }
-    }
-    else
-    {
-        //Just return start and end points
-        out.clear();
-        out.push_back(pointList.front());
-        out.push_back(pointList.back());
-    }
-}
 Eigen::Vector2f SpecificWorker::from_world_to_robot(const Eigen::Vector2f &p,
                                                     const RoboCompFullPoseEstimation::FullPoseEuler &r_state)
 {
@@ -636,7 +563,7 @@ RoboCompMoveTowards::Command SpecificWorker::MoveTowards_move(float x, float y,
     RoboCompMoveTowards::Command command{0.0, 0.0};
     Result res;
 
-    if( auto res_o =  control(target.to_eigen(), laser_poly, global_advance, global_rotation,
+    if( auto res_o =  control(target.to_eigen(), global_advance, global_rotation,
                               Eigen::Vector3f(r_state_global.x, r_state_global.y, r_state_global.rz),
                               &viewer_robot->scene); not res_o.has_value())
         return command;
@@ -30,6 +30,13 @@
 #include <Eigen/Dense>
 #include <qcustomplot/qcustomplot.h>
 #include <abstract_graphic_viewer/abstract_graphic_viewer.h>
+#include <dwa/rollout.h>
+#include <dwa/free_space.h>
+#include <dwa/arc_search.h>
+#include <dwa/refine.h>
+#include <laser/rdp.h>
+#include <laser/filter.h>
+#include <laser/gaps.h>
 #include "/home/robocomp/software/bezier/include/bezier.h"
 
 class SpecificWorker : public GenericWorker
@@ -77,9 +84,9 @@ public slots:
         bool startup_check_flag;
         std::tuple<RoboCompFullPoseEstimation::FullPoseEuler, double, double> read_base();
         std::tuple<QPolygonF, RoboCompLaser::TLaserData>  read_laser();
-        using Point = std::pair<float, float>;  //only for RDP, change to QPointF
         QPolygonF ramer_douglas_peucker(RoboCompLaser::TLaserData &ldata, double epsilon);
-        void ramer_douglas_peucker_rec(const vector<Point> &pointList, double epsilon, std::vector<Point> &out);
+        RamerDouglasPeucker rdp;
+        LaserFilter laser_filter{LaserFilter::Options{.min_range = 50, .gate = LaserFilter::Gate::HOLD}};   // short readings take the previous range
         //Dynamic_Window dwa;
 
         //robot
@@ -113,12 +120,18 @@ public slots:
         std::optional<SpecificWorker::Target> read_bill();
 
         //dwa
-        std::optional<Result> control(const Eigen::Vector2f &target_r, const QPolygonF &laser_poly, double advance, double rot,
+        std::optional<Result> control(const Eigen::Vector2f &target_r, double advance, double rot,
                        const Eigen::Vector3f &robot, QGraphicsScene *scene);
-        std::vector<Result> compute_predictions(float current_adv, float current_rot, const QPolygonF &laser_poly);
-        bool point_reachable_by_robot(const Result &point, const QPolygonF &laser_poly);
-        std::optional<Result> compute_optimus(const std::vector<Result> &points, const Eigen::Vector2f &tr);
-        void draw_dwa(const Eigen::Vector3f &robot, const std::vector <Result> &puntos, const std::optional<Result> &best, QGraphicsScene *scene);
+        Rollout rollout;
+        FreeSpace free_space;                   // rebuilt from each scan, laser frame
+        QPolygonF polygon_robot_in_laser;       // polygon_robot in the laser frame
+        ArcSearch arc_search;
+        VelocityRefiner refiner;
+        enum class Search {LATTICE, REFINED};   // REFINED looks for a better (adv, rot) inside the winner's lattice cell
+        Search search = Search::LATTICE;
+        bool point_reachable_by_robot(const Result &point) const;
+        std::optional<Result> compute_optimus(const Rollout::Samples &samples, const Eigen::Vector2f &tr);
+        void draw_dwa(const Eigen::Vector3f &robot, const Rollout::Samples &samples, const std::optional<Result> &best, QGraphicsScene *scene);
         inline QPointF to_qpointf(const Eigen::Vector2f &p) const {return QPointF(p.x(), p.y());}
 
         bool do_if_stuck(float adv, float rot, const RoboCompFullPoseEstimation::FullPoseEuler &r_state, bool lhit, bool rhit);
@@ -130,6 +143,7 @@ public slots:
         void draw_timeseries(float rot, float adv, int lhit, int rhit, int stuck);
         void lateral_bumpers(float &rot, bool &lhit, bool &rhit);
         Target sub_target(const Target &target, const QPolygonF &poly, const RoboCompLaser::TLaserData &ldata);
+        GapDetector gap_detector{GapDetector::Options{.threshold = constants.peak_threshold}};
         Eigen::Vector2f bezier(const vector<QPointF> &path);
 };
 
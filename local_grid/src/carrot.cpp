@@ -6,9 +6,7 @@
 #include <cppitertools/sliding_window.hpp>
 #include <QtCore>
 
-std::tuple<float, float, float> Carrot::update(const std::vector<Eigen::Vector2f> &path_robot, /*path in robot RS*/
-                                               QGraphicsPolygonItem *robot_polygon,
-                                               QGraphicsScene *scene)
+std::tuple<float, float, float, std::optional<Eigen::Vector2f>> Carrot::update(const std::vector<Eigen::Vector2f> &path_robot /*path in robot RS*/)
 {
     if (not path_robot.empty())
     {
@@ -24,7 +22,6 @@ std::tuple<float, float, float> Carrot::update(const std::vector<Eigen::Vector2f
             index++;
         }
         Eigen::Vector2f target_r = path_robot.at(index);
-        if(scene != nullptr) draw_target(target_r, robot_polygon, scene);
 
         float dist = target_r.norm();
         float beta = atan2(target_r.x(), target_r.y());
@@ -32,7 +29,7 @@ std::tuple<float, float, float> Carrot::update(const std::vector<Eigen::Vector2f
         float k2 = 0.8;
         float f1 = std::clamp(dist / 1000, 0.f, 1.f);
         float f2 = gaussian_break(k2*beta);
-        return std::make_tuple(constants.max_advance_speed*f1*f2, k2*beta, 0.f);
+        return std::make_tuple(constants.max_advance_speed*f1*f2, k2*beta, 0.f, target_r);
     }
     else  //empty path
         return {};
@@ -45,12 +42,3 @@ float Carrot::gaussian_break(float x)
     const double s = -xset*xset/log(yset);
     return exp(-x*x/s);
 }
-void Carrot::draw_target(const Eigen::Vector2f &target_r, QGraphicsPolygonItem *robot_polygon, QGraphicsScene *scene)
-{
-    static QGraphicsRectItem *target_draw;
-    if(target_draw != nullptr)
-        scene->removeItem(target_draw);
-
-    auto target_world = robot_polygon->mapToScene(QPointF(target_r.x(), target_r.y()));
-    target_draw = scene->addRect(target_world.x()-100, target_world.y()-100, 200 , 200, QPen(QColor("Orange")), QBrush(QColor("Orange")));
-}
\ No newline at end of file
@@ -9,16 +9,13 @@
 #include <Eigen/Dense>
 #include <QDebug>
 #include <QLineF>
-#include <QGraphicsPolygonItem>
-#include <QGraphicsScene>
+#include <optional>
 
 class Carrot
 {
     public:
-        // returns adv, rot and side velocities;
-        std::tuple<float, float, float> update (const std::vector<Eigen::Vector2f> &path,
-                                                QGraphicsPolygonItem *robot_polygon = nullptr,
-                                                QGraphicsScene *scene = nullptr);
+        // returns adv, rot and side velocities, and the point of the path it heads to, in robot coordinates
+        std::tuple<float, float, float, std::optional<Eigen::Vector2f>> update (const std::vector<Eigen::Vector2f> &path);
         void set_max_advance_speed(float max_advance_speed_) {constants.max_advance_speed = max_advance_speed_;};
         void final_distance_to_target(float final_distance_to_target_) {constants.final_distance_to_target = final_distance_to_target_;};
         void min_distance_to_target(float min_distance_to_target_) {constants.final_distance_to_target = min_distance_to_target_;};
@@ -40,7 +37,6 @@ class Carrot
 
         float gaussian_break(float x);
         inline QPointF e2q(const Eigen::Vector2f &p) const {return QPointF(p.x(), p.y());};
-        void draw_target(const Eigen::Vector2f &target_r, QGraphicsPolygonItem *robot_polygon, QGraphicsScene *scene);
 };
 
 
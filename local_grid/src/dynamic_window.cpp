@@ -4,8 +4,8 @@
 
 #include "dynamic_window.h"
 #include <QtCore>
-#include <cppitertools/enumerate.hpp>
 #include <cppitertools/range.hpp>
+#include <cppitertools/enumerate.hpp>
 
 Dynamic_Window::Dynamic_Window()
 {
@@ -13,13 +13,26 @@ Dynamic_Window::Dynamic_Window()
                       QPointF(constants.robot_semi_width, constants.robot_semi_width) <<
                       QPointF(constants.robot_semi_width, -constants.robot_semi_width) <<
                       QPointF(-constants.robot_semi_width, -constants.robot_semi_width);
+    Rollout::Lattice lattice;
+    lattice.adv_min = -100; lattice.adv_max = 800; lattice.adv_samples = 10;
+    lattice.rot_min = -2; lattice.rot_max = 2; lattice.rot_samples = 21;
+    lattice.step_along_arc = constants.step_along_arc;
+    lattice.time_ahead = constants.time_ahead;
+    lattice.min_distance = constants.robot_semi_width;
+    rollout.set_lattice(lattice);
+}
+void Dynamic_Window::set_sampling_density(int adv_samples, int rot_samples, float step_along_arc)
+{
+    auto lattice = rollout.get_lattice();
+    lattice.adv_samples = adv_samples;
+    lattice.rot_samples = rot_samples;
+    lattice.step_along_arc = step_along_arc;
+    rollout.set_lattice(lattice);
 }
 
-std::tuple<float, float, float> Dynamic_Window::update(const std::vector<Eigen::Vector2f> &path_robot,
+std::tuple<float, float, float, std::optional<Eigen::Vector2f>> Dynamic_Window::update(const std::vector<Eigen::Vector2f> &path_robot,
                                                const RoboCompLaser::TLaserData &ldata,
-                                               float current_adv, float current_rot,
-                                               QGraphicsPolygonItem *robot_polygon,
-                                               QGraphicsScene *scene)
+                                               float current_adv, float current_rot)
 {
     static float previous_turn = 0;
     //float robot_angle = robot_pos[2];
@@ -32,23 +45,14 @@ std::tuple<float, float, float> Dynamic_Window::update(const std::vector<Eigen::
         current_rot = 0.f; current_adv = 0.f;
     }
 
-    // compute future positions of the robot
-    QPolygonF laser_poly;
-    for(const auto &l : ldata)
-        laser_poly << QPointF(l.dist*sin(l.angle), l.dist*cos(l.angle));
-    auto point_list = compute_predictions(current_adv, current_rot, laser_poly);
-
-    // compute best value
+    // compute best value among the reachable future positions of the robot
+    free_space.update(ldata);
     Eigen::Vector2f target_r;
     if(path_robot.size()>5)
         target_r = path_robot[5];
     else
         target_r = path_robot.back();
-    auto best_choice = compute_optimus(point_list, target_r, previous_turn);
-
-    // draw target
-    if(scene != nullptr)
-        draw_target(target_r, robot_polygon, scene);
+    auto best_choice = compute_optimus(current_adv, current_rot, target_r, previous_turn);
 
     if (best_choice.has_value())
     {
@@ -61,19 +65,10 @@ std::tuple<float, float, float> Dynamic_Window::update(const std::vector<Eigen::
         float dist_break = std::clamp(dist / 1000, 0.f, 1.f);
         v = constants.max_advance_velocity * dist_break * gaussian(w);
         previous_turn = w;
-        return std::make_tuple(v, w, 0.f);
+        return std::make_tuple(v, w, 0.f, target_r);
     }
     else
-        return {};
-}
-void Dynamic_Window::draw_target(const Eigen::Vector2f &target_r, QGraphicsPolygonItem *robot_polygon, QGraphicsScene *scene)
-{
-    static QGraphicsRectItem *target_draw;
-    if(target_draw != nullptr)
-        scene->removeItem(target_draw);
-
-    auto target_world = robot_polygon->mapToScene(QPointF(target_r.x(), target_r.y()));
-    target_draw = scene->addRect(target_world.x()-100, target_world.y()-100, 200 , 200, QPen(QColor("Orange")), QBrush(QColor("Orange")));
+        return std::make_tuple(0.f, 0.f, 0.f, target_r);
 }
 float Dynamic_Window::gaussian(float x)
 {
@@ -83,39 +78,6 @@ float Dynamic_Window::gaussian(float x)
     return exp(-x*x/s);
 }
 
-std::vector<Dynamic_Window::Result> Dynamic_Window::compute_predictions(float current_adv, float current_rot, const QPolygonF &laser_poly)
-{
-    std::vector<Result> list_points;
-
-    for (float v = -100; v <= 800; v += 100) //advance
-        for (float w = -2; w <= 2; w += 0.2) //rotation
-        {
-            float new_adv = current_adv + v;
-            float new_rot = -current_rot + w;
-            if (fabs(w) > 0.001)  // avoid division by zero to compute the radius
-            {
-                float r = new_adv / new_rot; // radio de giro ubicado en el eje x del robot
-                float arc_length = new_rot * constants.time_ahead * r;
-                for (float t = constants.step_along_arc; t < arc_length; t += constants.step_along_arc)
-                {
-                    float x = r - r * cos(t / r); float y= r * sin(t / r);  // circle parametric coordinates
-                    auto point = std::make_tuple(x, y, new_adv, new_rot, t / r);
-                    if(sqrt(x*x + y*y)> constants.robot_semi_width and point_reachable_by_robot(point, laser_poly)) // skip points in the robot
-                        list_points.emplace_back(std::move(point));
-                }
-            }
-            else // para evitar la división por cero en el cálculo de r
-            {
-                for(float t = constants.step_along_arc; t < new_adv * constants.time_ahead; t+=constants.step_along_arc)
-                {
-                    auto point = std::make_tuple(0.f, t, new_adv, new_rot, new_rot * constants.time_ahead);
-                    if (t > constants.robot_semi_width and point_reachable_by_robot(point, laser_poly))
-                        list_points.emplace_back(std::make_tuple(0.f, t, new_adv, new_rot, new_rot * constants.time_ahead));
-                }
-            }
-        }
-    return list_points;
-}
 //bool Dynamic_Window::point_reachable_by_robot(const Result &point, const QPolygonF &laser_poly)
 //{
 //    auto [x, y, adv, giro, ang] = point;
@@ -130,7 +92,7 @@ std::vector<Dynamic_Window::Result> Dynamic_Window::compute_predictions(float cu
 //    return true;
 //}
 
-bool Dynamic_Window::point_reachable_by_robot(const Result &point, const QPolygonF &laser_poly)
+bool Dynamic_Window::point_reachable_by_robot(const Result &point) const
 {
     auto [x, y, adv, giro, ang] = point;
     Eigen::Vector2f robot_r(0.0,0.0);
@@ -138,37 +100,50 @@ bool Dynamic_Window::point_reachable_by_robot(const Result &point, const QPolygo
     float parts = Eigen::Vector2f(x,y).norm()/(constants.robot_semi_width/6.0);
     Eigen::Vector2f rside(260, 100);
     Eigen::Vector2f lside(-260, 100);
-    QPointF p,q,r;
+    Eigen::Vector2f p,q,r;
     for(const auto &l: iter::range(0.0, 1.0, 1.0/parts))
     {
-        p = to_qpointf(robot_r*(1-l) + goal_r*l);
-        q = to_qpointf((robot_r+rside)*(1-l) + (goal_r+rside)*l);
-        r = to_qpointf((robot_r+lside)*(1-l) + (goal_r+lside)*l);
-        if( not laser_poly.containsPoint(p, Qt::OddEvenFill) or
-            not laser_poly.containsPoint(q, Qt::OddEvenFill) or
-            not laser_poly.containsPoint(r, Qt::OddEvenFill))
+        p = robot_r*(1-l) + goal_r*l;
+        q = (robot_r+rside)*(1-l) + (goal_r+rside)*l;
+        r = (robot_r+lside)*(1-l) + (goal_r+lside)*l;
+        if( not free_space.is_free(p.x(), p.y()) or
+            not free_space.is_free(q.x(), q.y()) or
+            not free_space.is_free(r.x(), r.y()))
         return false;
     }
     return true;
 }
 
-std::optional<Dynamic_Window::Result> Dynamic_Window::compute_optimus(const std::vector<Result> &points, const Eigen::Vector2f &tr,
+std::optional<Dynamic_Window::Result> Dynamic_Window::compute_optimus(float current_adv, float current_rot, const Eigen::Vector2f &tr,
                                                                       float previous_turn)
 {
     const float A=1, B=5;  // CHANGE
-    std::vector<std::tuple<float, Result>> values(points.size());
-    for(auto &&[k, point] : iter::enumerate(points))
+    auto score = [&tr, previous_turn, A, B](float x, float y, float giro)
     {
-        auto [x, y, adv, giro, ang] = point;
         float dist_to_target = (Eigen::Vector2f(x, y) - tr).norm();
         float dist_to_previous_turn =  fabs(giro - previous_turn);
-        values[k] = std::make_tuple(A*dist_to_target + B*dist_to_previous_turn, point);
-    }
-    auto min = std::ranges::min_element(values, [](auto &a, auto &b){ return std::get<0>(a) < std::get<0>(b);});
-    if(min != values.end())
-        return std::get<Result>(*min);
-    else
+        return A*dist_to_target + B*dist_to_previous_turn;
+    };
+    // all the arc points of the lattice at once, already without those inside the robot
+    const auto &s = rollout.compute(current_adv, current_rot);
+    // each arc is followed until its first blocked point
+    auto best = arc_search.search(s,
+            [this, &s](std::uint32_t i){ return point_reachable_by_robot(std::make_tuple(s.x[i], s.y[i], s.adv[i], s.rot[i], s.ang[i])); },
+            [&s, &score](std::uint32_t i){ return score(s.x[i], s.y[i], s.rot[i]); });
+    if(not best.valid())
         return {};
+
+    const auto i = best.index;
+    if(search == Search::LATTICE)
+        return std::make_tuple(s.x[i], s.y[i], s.adv[i], s.rot[i], s.ang[i]);
+    auto r = refiner.refine({s.x[i], s.y[i], s.adv[i], s.rot[i], s.ang[i], best.cost}, s.t[i], rollout.get_lattice(),
+                            [this, &score](float x, float y, float adv, float giro, float ang)
+                            {
+                                if(not point_reachable_by_robot(std::make_tuple(x, y, adv, giro, ang)))
+                                    return std::numeric_limits<float>::infinity();
+                                return score(x, y, giro);
+                            });
+    return std::make_tuple(r.x, r.y, r.adv, r.rot, r.ang);
 }
 Eigen::Vector2f Dynamic_Window::from_robot_to_world(const Eigen::Vector2f &p, const Eigen::Vector3f &robot)
 {
@@ -188,28 +163,20 @@ Eigen::Vector2f Dynamic_Window::from_world_to_robot(const Eigen::Vector2f &p, co
 
 void Dynamic_Window::draw(const Eigen::Vector3f &robot, const std::vector <Result> &puntos,  const std::optional<Result> &best, QGraphicsScene *scene)
 {
-    static std::vector<QGraphicsEllipseItem *> arcs_vector;
-    // remove current arcs
-    for (auto arc: arcs_vector)
-        scene->removeItem(arc);
-    arcs_vector.clear();
-
-    QColor col("Blue");
-    for (auto &[x, y, vx, wx, a] : puntos)
+    // all the arc points in one item
+    std::vector<QPointF> centers(puntos.size());
+    for (auto &&[i, r] : iter::enumerate(puntos))
     {
-        //QPointF centro = robot_polygon_draw->mapToScene(x, y);
-        QPointF centro = to_qpointf(from_robot_to_world(Eigen::Vector2f(x, y), robot));
-        auto arc = scene->addEllipse(centro.x(), centro.y(), 50, 50, QPen(col, 10));
-        arc->setZValue(30);
-        arcs_vector.push_back(arc);
+        auto &[x, y, vx, wx, a] = r;
+        centers[i] = to_qpointf(from_robot_to_world(Eigen::Vector2f(x, y), robot));
     }
+    arcs_layer.one(scene)->set_points(centers);
 
     if(best.has_value())
     {
         auto &[x, y, _, __, ___] = best.value();
-        QPointF selected = to_qpointf(from_robot_to_world(Eigen::Vector2f(x, y), robot));
-        auto arc = scene->addEllipse(selected.x(), selected.y(), 180, 180, QPen(Qt::black), QBrush(Qt::black));
-        arc->setZValue(30);
-        arcs_vector.push_back(arc);
+        best_layer.one(scene)->set_points({to_qpointf(from_robot_to_world(Eigen::Vector2f(x, y), robot))});
     }
+    else
+        best_layer.hide(scene);
 }
@@ -15,30 +15,38 @@
 #include <QTransform>
 #include <QGraphicsEllipseItem>
 #include <QGraphicsScene>
+#include <graphics/scene_items.h>
 #include <Laser.h>  // quitar
+#include <dwa/rollout.h>
+#include <dwa/free_space.h>
+#include <dwa/arc_search.h>
+#include <dwa/refine.h>
 
 class Dynamic_Window
 {
     public:
         Dynamic_Window();
         using Result = std::tuple<float, float, float, float, float>;
-        // returns adv, rot, side velocities
-        std::tuple<float, float, float> update(const std::vector<Eigen::Vector2f> &path_robot, const RoboCompLaser::TLaserData &ldata,
+        // returns adv, rot, side velocities and the point of the path it heads to, in robot coordinates
+        std::tuple<float, float, float, std::optional<Eigen::Vector2f>> update(const std::vector<Eigen::Vector2f> &path_robot, const RoboCompLaser::TLaserData &ldata,
                        float current_adv = 0.f,
-                       float current_rot = 0.f,
-                       QGraphicsPolygonItem *robot_polygon = nullptr,
-                       QGraphicsScene *scene = nullptr);
+                       float current_rot = 0.f);
+        // number of advance and rotation samples in the velocity lattice and distance between points along each arc
+        void set_sampling_density(int adv_samples, int rot_samples, float step_along_arc);
+        // LATTICE keeps the best lattice sample, REFINED searches for a better (adv, rot) inside its lattice cell
+        enum class Search {LATTICE, REFINED};
+        void set_search(Search search_)   { search = search_; };
 
     private:
-        std::vector<Result> compute_predictions(float current_adv, float current_rot, const QPolygonF &laser_poly);
-        bool point_reachable_by_robot(const Result &point, const QPolygonF &laser_poly);
-        std::optional<Result> compute_optimus(const std::vector<Result> &points, const Eigen::Vector2f &target, float previous_turn);
+        bool point_reachable_by_robot(const Result &point) const;
+        std::optional<Result> compute_optimus(float current_adv, float current_rot, const Eigen::Vector2f &target, float previous_turn);
         Eigen::Vector2f from_robot_to_world(const Eigen::Vector2f &p, const Eigen::Vector3f &robot);
         Eigen::Vector2f from_world_to_robot(const Eigen::Vector2f &p, const Eigen::Vector3f &robot);
         inline QPointF to_qpointf(const Eigen::Vector2f &p) const {return QPointF(p.x(), p.y());}
         void draw(const Eigen::Vector3f &robot, const std::vector <Result> &puntos, const std::optional<Result> &best, QGraphicsScene *scene);
         float gaussian(float x);
-        void draw_target(const Eigen::Vector2f &target_r, QGraphicsPolygonItem *robot_polygon, QGraphicsScene *scene);
+        ItemPool<PointsItem> arcs_layer{30, [](auto p){ p->set_style(50, QPen(QColor("Blue"), 10), Qt::NoBrush); }};
+        ItemPool<PointsItem> best_layer{30, [](auto p){ p->set_style(180, QPen(Qt::black), QBrush(Qt::black)); }};
 
         QPolygonF polygon_robot; // to check if the point is reachable
         struct Constants
@@ -50,6 +58,11 @@ class Dynamic_Window
             const float max_rotation_velociy = 2;
         };
         Constants constants;
+        Rollout rollout;
+        FreeSpace free_space;   // rebuilt from each scan
+        ArcSearch arc_search;
+        VelocityRefiner refiner;
+        Search search = Search::LATTICE;
 };
 
 #endif //ATTENTION_CONTROL_DYNAMIC_WINDOW_H
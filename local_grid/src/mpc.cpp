@@ -12,34 +12,65 @@
 
 namespace mpc
 {
-    casadi::Opti MPC::initialize_differential(const int N)
+    casadi::Opti MPC::initialize_differential(const int N, Solver solver_)
     {
         consts.num_steps = N;
+        // fatrop is an optional plugin of CasADi. Without it the same problem is solved by IPOPT
+        if(solver_ == Solver::FATROP and not casadi::has_nlpsol("fatrop"))
+        {
+            qWarning() << __FUNCTION__ << "CasADi was built without the fatrop plugin. Using IPOPT";
+            solver_ = Solver::IPOPT;
+        }
+        solver = solver_;
         casadi::Slice all;
         this->opti = casadi::Opti();
         auto specific_options = casadi::Dict();
         auto generic_options = casadi::Dict();
-        //specific_options["accept_after_max_steps"] = 100;
-        specific_options["fixed_variable_treatment"] = "relax_bounds";
-        //specific_options["print_time"] = 0;
-        //specific_options["max_iter"] = 10000;
-        specific_options["print_level"] = 0;
-        specific_options["acceptable_tol"] = 1e-8;
-        specific_options["acceptable_obj_change_tol"] = 1e-6;
-        opti.solver("ipopt", generic_options, specific_options);
-
-        // ---- state variables ---------
-        state = opti.variable(3, N+1);
+        if(solver == Solver::FATROP)
+        {
+            // fatrop needs the problem expanded to SX and declared stage by stage: x0, u0, x1, u1, ...
+            generic_options["structure_detection"] = "auto";
+            generic_options["expand"] = true;
+            generic_options["fatrop.print_level"] = 0;
+            generic_options["fatrop.tol"] = 1e-6;
+            opti.solver("fatrop", generic_options);
+        }
+        else
+        {
+            //specific_options["accept_after_max_steps"] = 100;
+            specific_options["fixed_variable_treatment"] = "relax_bounds";
+            //specific_options["print_time"] = 0;
+            //specific_options["max_iter"] = 10000;
+            specific_options["print_level"] = 0;
+            specific_options["acceptable_tol"] = 1e-8;
+            specific_options["acceptable_obj_change_tol"] = 1e-6;
+            opti.solver("ipopt", generic_options, specific_options);
+        }
+
+        // ---- stage variables ---------
+        // x_k = [x, y, phi, adv_{k-1}, rot_{k-1}]. Carrying the previous control in the state keeps the
+        // acceleration constraints local to one stage, which is what makes the problem banded
+        // u_k = [adv, rot, slack]
+        std::vector<casadi::MX> xs, us;
+        for(const auto k : iter::range(N))
+        {
+            xs.push_back(opti.variable(5));
+            us.push_back(opti.variable(3));
+        }
+        xs.push_back(opti.variable(5));
+
+        state = casadi::MX::horzcat(xs)(casadi::Slice(0,3), all);
         pos = state(casadi::Slice(0,2), all);
         phi = state(2, all);
 
         // ---- inputs variables 2 adv and rot---------
-        control = opti.variable(2, N);
+        control = casadi::MX::horzcat(us)(casadi::Slice(0,2), all);
         adv = control(0, all);
-        // std::cout<<adv.size()<<std::endl;
-        // exit(0);
         rot = control(1, all);
 
+        // slack vector declaration
+        slack_vector = casadi::MX::vertcat(std::vector<casadi::MX>(us.begin(), us.end()))(casadi::Slice(2, 3*N, 3));
+
         // Gap closing: dynamic constraints for differential robot: dx/dt = f(x, u)   3 x 2 * 2 x 1 -> 3 x 1
         auto integrate = [](casadi::MX x, casadi::MX u) { return casadi::MX::mtimes(
                 casadi::MX::vertcat(std::vector<casadi::MX>{
@@ -48,51 +79,50 @@ namespace mpc
                         casadi::MX::horzcat(std::vector<casadi::MX>{0.0,      1.0})}
                 ), u);};
         double dt = 0.5;   // timer interval in secs
+        casadi::Slice pose(0,3), cmd(0,2);
         for(const auto k : iter::range(N))  // loop over control intervals
         {
-            auto k1 = integrate(state(all, k), control(all,k));
-            auto k2 = integrate(state(all,k) + (dt/2)* k1 , control(all, k));
-            auto k3 = integrate(state(all,k) + (dt/2)*k2, control(all, k));
-            auto k4 = integrate(state(all,k) + k3, control(all, k));
-            auto x_next = state(all, k) + dt / 6 * (k1 + 2*k2 + 2*k3 + k4);
-            //auto x_next = state(all, k) + dt * integrate(state(all,k), control(all,k));
-            opti.subject_to( state(all, k + 1) == x_next);  // close  the gaps
-        }
-        for(const auto k : iter::range(N-1))  // acceleration constraints
-        {
-            auto v1 = control(0,k);
-            auto v2 = control(0,k+1);
-            auto acc = (v2-v1)/dt;
-            //auto x_next = state(all, k) + dt * integrate(state(all,k), control(all,k));
-            opti.subject_to(opti.bounded(-3.19, acc, 3.19)); 
-            auto w1 = control(1,k);
-            auto w2 = control(1,k+1);
-            auto ang_acc = (w2-w1)/dt;
-            opti.subject_to(opti.bounded(-0.5, ang_acc, 0.5)); 
+            auto x = xs[k](pose);
+            auto u = us[k](cmd);
+            auto k1 = integrate(x, u);
+            auto k2 = integrate(x + (dt/2)* k1 , u);
+            auto k3 = integrate(x + (dt/2)*k2, u);
+            auto k4 = integrate(x + k3, u);
+            auto x_next = x + dt / 6 * (k1 + 2*k2 + 2*k3 + k4);
+            opti.subject_to( xs[k+1] == casadi::MX::vertcat(std::vector<casadi::MX>{x_next, u}));  // close  the gaps
         }
 
-
-        // control constraints -----------
-        opti.subject_to(opti.bounded(consts.min_advance_value, adv, consts.max_advance_value));  // control is limited meters
-        opti.subject_to(opti.bounded(-consts.max_rotation_value, rot, consts.max_rotation_value));         // control is limited
-
-        // forward velocity constraints -----------
-        //opti.subject_to(adv >= 0);
-
         // initial point constraints ------
-        //    auto initial_oparam = opti.parameter(3);
-        //    opti.set_value(initial_oparam, std::vector<double>{0.0, 0.0, 0.0});
-        opti.subject_to(state(all, 0) == std::vector<double>{0.0, 0.0, 0.0});
+        opti.subject_to(xs[0](pose) == std::vector<double>{0.0, 0.0, 0.0});
 
-        // slack vector declaration
-        slack_vector = opti.variable(consts.num_steps);
+        for(const auto k : iter::range(N))
+        {
+            // control constraints -----------
+            opti.subject_to(opti.bounded(consts.min_advance_value, us[k](0), consts.max_advance_value));  // control is limited meters
+            opti.subject_to(opti.bounded(-consts.max_rotation_value, us[k](1), consts.max_rotation_value));         // control is limited
 
+            // acceleration constraints against the control stored in the state
+            if(k > 0)
+            {
+                auto acc = (us[k](0) - xs[k](3))/dt;
+                opti.subject_to(opti.bounded(-3.19, acc, 3.19));
+                auto ang_acc = (us[k](1) - xs[k](4))/dt;
+                opti.subject_to(opti.bounded(-0.5, ang_acc, 0.5));
+            }
+        }
+        initialized = true;
         return opti;
     };
-
+    void MPC::set_horizon(unsigned int N)
+    {
+        if(N == consts.num_steps and initialized) return;
+        previous_values_of_solution.clear();
+        previous_control_of_solution.clear();
+        initialize_differential(N, solver);
+    }
     MPC::Result MPC::minimize_balls_path(const std::vector<Eigen::Vector2d> &path,
                                          const Eigen::Vector3d &current_pose_meters,
-                                         const RoboCompLaser::TLaserData &ldata)
+                                         const std::vector<Eigen::Vector2d> &lpoints)
     {
         std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
         auto opti_local = this->opti.copy();
@@ -103,23 +133,7 @@ namespace mpc
         std::cout<<"2"<<std::endl;
 
         // Warm start
-        if (previous_values_of_solution.empty())
-        {
-            std::cout<<"3"<<std::endl;
-
-            previous_values_of_solution.resize(consts.num_steps+1);
-            std::cout<<"4"<<std::endl;
-            double landa = 1.0 / (target_robot.norm() / consts.num_steps);
-            for (auto &&[i, step]: iter::range(0.0, 1.0, landa) | iter::enumerate)
-            {
-                auto paso = target_robot * step;
-                previous_values_of_solution[3 * i] = paso.x();
-                previous_values_of_solution[3 * i + 1] = paso.y();
-                previous_values_of_solution[3 * i + 2] = 0.0;
-               
-            }
-            std::cout<<"5"<<std::endl;
-        } 
+        warm_start(target_robot);
         
 
 
@@ -136,9 +150,6 @@ namespace mpc
         
 
         // add free balls constraints
-        std::vector<Eigen::Vector2d> lpoints(ldata.size());
-        for(auto &&[i, l] : ldata | iter::enumerate)
-            lpoints[i] = Eigen::Vector2d(l.dist*sin(l.angle)/1000.0, l.dist*cos(l.angle)/1000.0);
         Balls balls;
         balls.push_back(Ball{Eigen::Vector2d(0.0,0.0), 0.25, Eigen::Vector2d(0.2, 0.3)});  // first point on robot
         for (auto i: iter::range(0u, consts.num_steps))
@@ -194,8 +205,7 @@ namespace mpc
         try
         {
             auto solution = opti_local.solve();
-            std::string retstat = solution.stats().at("return_status");
-            if (retstat.compare("Solve_Succeeded") != 0)
+            if (not solve_succeeded(solution))
             {
                 std::cout << "NOT succeeded" << std::endl;
                 //move_robot(0, 0);  //slow down
@@ -213,8 +223,8 @@ namespace mpc
             auto rotation = std::vector<double>(solution.value(rot)).at(1);
 
             //qInfo() << std::vector<double>(solution.value(rot));
-            qInfo() << __FUNCTION__ << "Iterations:" << (int) solution.stats()["iter_count"];
-            qInfo() << __FUNCTION__ << "Status:" << QString::fromStdString(solution.stats().at("return_status"));
+            if(auto stats = solution.stats(); stats.count("iter_count") > 0)
+                qInfo() << __FUNCTION__ << "Iterations:" << (int) stats.at("iter_count");
             return std::make_tuple(advance, rotation, solution, balls);
         }
         catch (...)
@@ -235,7 +245,7 @@ namespace mpc
             return std::make_tuple(center, 1, Eigen::Vector2d());
 
         // compute the distance to all laser points for center and center +- dx, center +- dy
-        auto grad = [lpoints ](const Eigen::Vector2d &center) {
+        auto grad = [&lpoints](const Eigen::Vector2d &center) {
             auto dx = Eigen::Vector2d(0.1, 0.0);
             auto dy = Eigen::Vector2d(0.0, 0.1);
             auto min_dx_plus = std::ranges::min(lpoints, [c = center + dx](auto a, auto b) { return (a - c).norm() < (b - c).norm(); });
@@ -267,7 +277,7 @@ namespace mpc
         return std::make_tuple(new_center, current_dist, grad(new_center));
     }
 
-    MPC::Result MPC::update( float adv_prev, double slack_weight, std::vector<Eigen::Vector2d> near_obstacles, const std::vector<Eigen::Vector2f> &path_robot, QGraphicsPolygonItem *robot_polygon, QGraphicsScene *scene)
+    MPC::Result2 MPC::update( float adv_prev, double slack_weight, std::vector<Eigen::Vector2d> near_obstacles, const std::vector<Eigen::Vector2f> &path_robot)
     {
         std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
         // transform path to meters
@@ -303,18 +313,7 @@ namespace mpc
         // }
 
         // Warm start
-        if (previous_values_of_solution.empty())
-        {
-            previous_values_of_solution.resize(consts.num_steps+1);
-            double landa = 1.0 / (target_robot.norm() / consts.num_steps);
-            for (auto &&[i, step]: iter::range(0.0, 1.0, landa) | iter::enumerate)
-            {
-                auto paso = target_robot * step;
-                previous_values_of_solution[3 * i] = paso.x();
-                previous_values_of_solution[3 * i + 1] = paso.y();
-                previous_values_of_solution[3 * i + 2] = 0.0;
-            }
-        }
+        warm_start(target_robot.cast<double>());
         // auto acc = (control(0,0)-adv_prev)/0.5;
         // opti_local.subject_to((control(0,0)-adv_prev)/0.5 <= 3.19); 
         // opti_local.subject_to((control(0,0)-adv_prev)/0.5 >= -3.19); 
@@ -434,8 +433,7 @@ namespace mpc
         try
         {
             auto solution = opti_local.solve();
-            std::string retstat = solution.stats().at("return_status");
-            if (retstat.compare("Solve_Succeeded") != 0)
+            if (not solve_succeeded(solution))
             {
                 std::cout << "NOT succeeded" << std::endl;
                 //move_robot(0, 0);  //slow down
@@ -452,13 +450,11 @@ namespace mpc
             auto advance = std::vector<double>(solution.value(adv)).at(1) * 1000;
             auto rotation = std::vector<double>(solution.value(rot)).at(1);
 
-            if(scene != nullptr) draw_path(std::vector<double>(solution.value(state)), robot_polygon, scene);
-
-            qInfo() << __FUNCTION__ << "Iterations:" << (int) solution.stats()["iter_count"];
-            qInfo() << __FUNCTION__ << "Status:" << QString::fromStdString(solution.stats().at("return_status"));
+            if(auto stats = solution.stats(); stats.count("iter_count") > 0)
+                qInfo() << __FUNCTION__ << "Iterations:" << (int) stats.at("iter_count");
 
             advance = advance * gaussian(rotation);
-            return std::make_tuple(advance, rotation, solution, balls);
+            return std::make_tuple(advance, rotation, solution, balls, to_horizon(previous_values_of_solution));
         }
         catch (...)
         {
@@ -469,6 +465,28 @@ namespace mpc
         }
     }
     ////////////////////// AUX /////////////////////////////////////////////////
+    bool MPC::solve_succeeded(const casadi::OptiSol &solution) const
+    {
+        auto stats = solution.stats();
+        if(solver == Solver::FATROP)
+            return stats.count("success") > 0 and bool(stats.at("success"));
+        std::string retstat = stats.at("return_status");
+        return retstat.compare("Solve_Succeeded") == 0;
+    }
+    void MPC::warm_start(const Eigen::Vector2d &target_robot)
+    {
+        // straight line to target, one (x, y, phi) triplet per state column
+        if (not previous_values_of_solution.empty())
+            return;
+        previous_values_of_solution.resize(3*(consts.num_steps+1));
+        for (auto i: iter::range(consts.num_steps+1))
+        {
+            auto paso = target_robot * (double)i / consts.num_steps;
+            previous_values_of_solution[3 * i] = paso.x();
+            previous_values_of_solution[3 * i + 1] = paso.y();
+            previous_values_of_solution[3 * i + 2] = 0.0;
+        }
+    }
     float MPC::gaussian(float x)
     {
         const double xset = consts.xset_gaussian;
@@ -480,23 +498,14 @@ namespace mpc
     {
         return std::vector<double>{v.x(), v.y()};
     }
-    void MPC::draw_path(const std::vector<double> &path_robot_meters, QGraphicsPolygonItem *robot_polygon, QGraphicsScene *scene)
+    MPC::Horizon MPC::to_horizon(const std::vector<double> &states_meters) const
     {
-        // draw optimum N points solution
-        static std::vector<QGraphicsItem *> path_paint;
-        static QString path_color = "orange";
-
-        for(auto p : path_paint)
-            scene->removeItem(p);
-        path_paint.clear();
-
-        uint s = 100;
-        for(auto &&p : path_robot_meters | iter::chunked(3))
-        {
-            auto pw = robot_polygon->mapToScene(QPointF(p[0]*1000.f, p[1]*1000.f));
-            path_paint.push_back(scene->addEllipse(pw.x()-s/2, pw.y()-s/2, s , s, QPen(path_color), QBrush(QColor(path_color))));
-            path_paint.back()->setZValue(30);
-        }
+        // optimum N points solution, (x, y, angle) per step
+        Horizon horizon;
+        horizon.reserve(states_meters.size()/3);
+        for(auto &&p : states_meters | iter::chunked(3))
+            horizon.emplace_back(p[0]*1000.f, p[1]*1000.f);
+        return horizon;
     }
 
 } // mpc
\ No newline at end of file
@@ -21,7 +21,13 @@ namespace mpc
             using Ball = std::tuple<Eigen::Vector2d, float, Eigen::Vector2d>;
             using Balls = std::vector<Ball>;
             using Result = std::optional<std::tuple<double, double, casadi::OptiSol, MPC::Balls>>;
-            using Result2 = std::optional<std::tuple<double, double, casadi::OptiSol, MPC::Balls>>;
+            using Horizon = std::vector<Eigen::Vector2f>;     // predicted positions, robot coordinates in mm
+            using Result2 = std::optional<std::tuple<double, double, casadi::OptiSol, MPC::Balls, Horizon>>;
+
+            // NLP backend. IPOPT sees the OCP as a generic sparse NLP. FATROP is a Riccati-based interior point
+            // that detects the stage-wise (banded) structure of the multiple-shooting problem, so its cost per
+            // iteration grows linearly with the horizon
+            enum class Solver {IPOPT, FATROP};
 
             struct Constants
             {
@@ -66,16 +72,23 @@ namespace mpc
                     { return Eigen::Vector2d(pos.x()/1000, pos.y()/1000); }
             };
 
-            casadi::Opti initialize_differential(const int N);
-            Result minimize_balls_path( const std::vector<Eigen::Vector2d> &path, const Eigen::Vector3d &current_pose_meters, const RoboCompLaser::TLaserData &ldata);
-            Result2 update( float adv_prev, double slack_weight, std::vector<Eigen::Vector2d> near_obstacles, const std::vector<Eigen::Vector2f> &path, QGraphicsPolygonItem *robot_polygon = nullptr,
-                                                    QGraphicsScene *scene = nullptr);
+            // FATROP falls back to IPOPT if CasADi has no fatrop plugin
+            casadi::Opti initialize_differential(const int N, Solver solver_ = Solver::IPOPT);
+            // rebuilds the problem with N steps, with the current solver. The previous solution is dropped
+            void set_horizon(unsigned int N);
+            void set_solver(Solver solver_) { solver = solver_; initialized = false; };
+            Solver get_solver() const { return solver; };
+            unsigned int get_horizon() const { return consts.num_steps; };
+            Result minimize_balls_path( const std::vector<Eigen::Vector2d> &path, const Eigen::Vector3d &current_pose_meters, const std::vector<Eigen::Vector2d> &lpoints);  // laser in robot RS, meters
+            Result2 update( float adv_prev, double slack_weight, std::vector<Eigen::Vector2d> near_obstacles, const std::vector<Eigen::Vector2f> &path);
             casadi::MX pos;
             casadi::MX rot;
 
     private:
             Target target;
             Constants consts;
+            Solver solver = Solver::IPOPT;
+            bool initialized = false;
             casadi::Opti opti;
             std::vector<double> previous_values_of_solution, previous_control_of_solution;
             casadi::MX state;
@@ -88,8 +101,10 @@ namespace mpc
             std::vector<double> e2v(const Eigen::Vector2d &v);
             Ball compute_free_ball(const Eigen::Vector2d &center, const std::vector<Eigen::Vector2d> &lpoints);
             Ball compute_free_ball2(const Eigen::Vector2f &center, const std::vector<Eigen::Vector2d> &near_obstacles);
-            void draw_path(const std::vector<double> &path_robot_meters, QGraphicsPolygonItem *robot_polygon, QGraphicsScene *scene);
+            Horizon to_horizon(const std::vector<double> &states_meters) const;
             float gaussian(float x);
+            bool solve_succeeded(const casadi::OptiSol &solution) const;
+            void warm_start(const Eigen::Vector2d &target_robot);
     };
 
 } // mpc
@@ -102,6 +102,33 @@ void SpecificMonitor::readConfig(RoboCompCommonBehavior::ParameterList &params )
 
     configGetString( "","tile", aux.value, "100");
     params["tile"] = aux;
+
+    configGetString( "","dwa_adv_samples", aux.value, "10");
+    params["dwa_adv_samples"] = aux;
+
+    configGetString( "","dwa_rot_samples", aux.value, "21");
+    params["dwa_rot_samples"] = aux;
+
+    configGetString( "","dwa_arc_step", aux.value, "200");
+    params["dwa_arc_step"] = aux;
+
+    configGetString( "","dwa_search", aux.value, "lattice");
+    params["dwa_search"] = aux;
+
+    configGetString( "","mpc_solver", aux.value, "ipopt");
+    params["mpc_solver"] = aux;
+
+    configGetString( "","mpc_horizon", aux.value, "8");
+    params["mpc_horizon"] = aux;
+
+    configGetString( "","laser_noise", aux.value, "gaussian_hard");
+    params["laser_noise"] = aux;
+
+    configGetString( "","laser_noise_seed", aux.value, "random");
+    params["laser_noise_seed"] = aux;
+
+    configGetString( "","render_fps", aux.value, "25");
+    params["render_fps"] = aux;
 }
 
 //Check parameters and transform them to worker structure
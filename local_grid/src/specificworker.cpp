@@ -49,6 +49,19 @@ bool SpecificWorker::setParams(RoboCompCommonBehavior::ParameterList params)
     qInfo() << __FUNCTION__ << " Read parameters: " << left_x << top_y << width << height << tile;
     this->dimensions = QRectF(left_x, top_y, width, height);
     constants.tile_size = tile;
+    dwa.set_sampling_density(std::stoi(params.at("dwa_adv_samples").value), std::stoi(params.at("dwa_rot_samples").value),
+                             std::stof(params.at("dwa_arc_step").value));
+    dwa.set_search(params.at("dwa_search").value == "refined" ? Dynamic_Window::Search::REFINED : Dynamic_Window::Search::LATTICE);
+    constants.mpc_solver = params.at("mpc_solver").value == "fatrop" ? mpc::MPC::Solver::FATROP : mpc::MPC::Solver::IPOPT;
+    constants.num_steps_mpc = std::stoi(params.at("mpc_horizon").value);
+    const auto seed = params.at("laser_noise_seed").value;
+    laser_noise.set_options(LaserNoise::Options{.profile = LaserNoise::profile_from_string(params.at("laser_noise").value),
+                                                .sigma = constants.lidar_noise_sigma,
+                                                .hard_rays = constants.num_lidar_affected_rays_by_hard_noise,
+                                                .hard_probability = 3.f/11.f,
+                                                .hard_divisor = 3.f,
+                                                .seed = seed == "random" ? std::random_device{}() : std::stoull(seed)});
+    render_fps = std::stoi(params.at("render_fps").value);
     return true;
 }
 void SpecificWorker::initialize(int period)
@@ -63,7 +76,8 @@ void SpecificWorker::initialize(int period)
     laser_in_robot_polygon->setPos(0, 190);     // move this to abstract
 
     // MPC
-    mpc.initialize_differential(constants.num_steps_mpc);
+    mpc.set_solver(constants.mpc_solver);
+    mpc.set_horizon(constants.num_steps_mpc);
 
     // Global Grid
     QRectF dim(-5000, -2500, 10000, 5000);
@@ -97,6 +111,15 @@ void SpecificWorker::initialize(int period)
     custom_plot.resize(metrics_frame->size());
     custom_plot.show();
 
+    // viewer, drawn at its own rate from the frames left by compute()
+    if(render_fps > 0)
+    {
+        connect(&render_timer, &QTimer::timeout, this, &SpecificWorker::render);
+        render_timer.start(1000 / render_fps);
+    }
+    else
+        qInfo() << __FUNCTION__ << "Headless, nothing will be drawn";
+
     this->Period = period;
 	if(this->startup_check_flag)
 		this->startup_check();
@@ -106,9 +129,16 @@ void SpecificWorker::initialize(int period)
 void SpecificWorker::compute()
 {
     static std::vector<Eigen::Vector2f> current_path_grid;
-    auto ldata = read_laser(true);
+    auto ldata = read_laser();
     robot_pose = read_robot();
-    update_map(ldata);
+    update_map(laser_frame);
+
+    // what this cycle leaves for the viewer
+    auto &frame = frames.back();
+    frame.clear();
+    frame.cycle = cycles++;
+    frame.pose = robot_pose;
+    frame.laser = laser_frame.polygon();
 
     std::vector<Eigen::Vector2f> near_obstacles;
     auto g2r = from_grid_to_robot_matrix();
@@ -146,6 +176,7 @@ void SpecificWorker::compute()
             move_robot(0,0);
             target.active = false;
             qInfo() << __FUNCTION__ << "At target" << target_r.norm();
+            frames.publish();
             return;
         }
 
@@ -157,6 +188,7 @@ void SpecificWorker::compute()
             if(current_path_grid.empty())
             {
                 qWarning() << __FUNCTION__ << "No path found";
+                frames.publish();
                 return;
             }
         }
@@ -182,7 +214,9 @@ void SpecificWorker::compute()
 
         }
         // exit(0);
-        draw_path_smooth(current_path_robot);
+        frame.smooth_path.resize(current_path_robot.size());
+        for(auto &&[i, p] : iter::enumerate(current_path_robot))
+            frame.smooth_path[i] = e2q(from_robot_to_world(p));
 
         // float advf=0.f, rotf=0.f, sidef=0.f;
         if(current_path_robot[3][1]<0) //current_path_robot[5][1]<0)
@@ -217,8 +251,8 @@ void SpecificWorker::compute()
                 
                 for(int i=1; i<=3; i++){
                     
-                    auto r = mpc.update(movement.advf, slack_weight, near_obstacles_double, current_path_robot, robot_polygon, &viewer->scene);               
-                    auto [adv, rot, solution, balls] = r.value();
+                    auto r = mpc.update(movement.advf, slack_weight, near_obstacles_double, current_path_robot);
+                    auto [adv, rot, solution, balls, horizon] = r.value();
                     // advf = adv; rotf = rot; 
                     auto path = std::vector<double>(solution.value(mpc.pos));  //in meters
                     
@@ -249,26 +283,31 @@ void SpecificWorker::compute()
                 }
                 std::cout<<"############################ Selected slack_weight: "<<sel_slack<<std::endl;
 
-                auto r = mpc.update(movement.advf, sel_slack, near_obstacles_double, current_path_robot, robot_polygon, &viewer->scene);
-                auto [adv, rot, solution, balls] = r.value();
+                auto r = mpc.update(movement.advf, sel_slack, near_obstacles_double, current_path_robot);
+                auto [adv, rot, solution, balls, horizon] = r.value();
                 movement.advf = adv; movement.rotf = rot; 
                 auto path = std::vector<double>(solution.value(mpc.pos));
-                draw_solution_path(path, balls);
+                fill_solution_path(path, balls, frame);
+                frame.horizon.resize(horizon.size());
+                for(auto &&[i, p] : iter::enumerate(horizon))
+                    frame.horizon[i] = e2q(from_robot_to_world(p));
                 // exit(0);
                 // draw_solution_path(current_path_robot_double, balls);
             }
             
-            // goto_target_mpc(current_path_robot_double, ldata);
+            // goto_target_mpc(current_path_robot_double, laser_frame);
         }
         if(control == Control::DWA)
         {
-            auto [adv, rot, side] = dwa.update(current_path_robot, ldata, 0.f, 0.f, robot_polygon, &viewer->scene);
+            auto [adv, rot, side, target_r] = dwa.update(current_path_robot, ldata, 0.f, 0.f);
             movement.advf = adv; movement.rotf = rot; movement.sidef = side;
+            if(target_r.has_value()) frame.follower_target = e2q(from_robot_to_world(target_r.value()));
         }
         if(control == Control::CARROT)
         {
-            auto [adv, rot, side] = carrot.update(current_path_robot, robot_polygon, &viewer->scene);  // in robot coordinates
+            auto [adv, rot, side, target_r] = carrot.update(current_path_robot);  // in robot coordinates
             movement.advf = adv; movement.rotf = rot; movement.sidef = side;
+            if(target_r.has_value()) frame.follower_target = e2q(from_robot_to_world(target_r.value()));
         };
         }
 
@@ -276,11 +315,12 @@ void SpecificWorker::compute()
         { differentialrobot_proxy->setSpeedBase(movement.advf, movement.rotf); }
         catch (const Ice::Exception &e) { std::cout << e.what() << " Error talking to differentialrobot" << std::endl; }
 
-        // draw timeseries
-        draw_timeseries(target_r.norm(), movement.advf, movement.rotf);
+        // timeseries
+        frame.timeseries = std::array<float, 3>{target_r.norm(), movement.advf, movement.rotf};
     }
     else
         qInfo() << __FUNCTION__ << "IDLE";
+    frames.publish();
     fps.print("FPS:");
 }
 
@@ -357,7 +397,7 @@ double SpecificWorker::path_length(const std::vector<Eigen::Vector2f> &path)
         total += (p[0]-p[1]).norm();
     return total;
 }
-void SpecificWorker::goto_target_mpc(const std::vector<Eigen::Vector2d> &path_robot, const RoboCompLaser::TLaserData &ldata)  //path in robot RS
+void SpecificWorker::goto_target_mpc(const std::vector<Eigen::Vector2d> &path_robot, const LaserFrame &laser)  //path in robot RS
 {
     // lambda para unificar las dos salidas de los if
     std::cout<<"1"<<std::endl;
@@ -373,7 +413,7 @@ void SpecificWorker::goto_target_mpc(const std::vector<Eigen::Vector2d> &path_ro
     //         qInfo() << __FUNCTION__ << "Target reached";
     // };
 
-    if(auto r = mpc.minimize_balls_path(path_robot, robot_pose.to_vec3_meters(), ldata); r.has_value())
+    if(auto r = mpc.minimize_balls_path(path_robot, robot_pose.to_vec3_meters(), laser.points_meters()); r.has_value())
     {
         std::cout<<"1.1"<<std::endl;
         
@@ -387,7 +427,7 @@ void SpecificWorker::goto_target_mpc(const std::vector<Eigen::Vector2d> &path_ro
 
             // draw
             auto path = std::vector<double>(solution.value(mpc.pos));  //in meters
-            draw_solution_path(path, balls);
+            fill_solution_path(path, balls, frames.back());
         }
         catch (...)
         { std::cout << "No solution found" << std::endl; }
@@ -399,32 +439,18 @@ void SpecificWorker::goto_target_mpc(const std::vector<Eigen::Vector2d> &path_ro
     }
 }
 
-RoboCompLaser::TLaserData SpecificWorker::read_laser(bool noise)
+RoboCompLaser::TLaserData SpecificWorker::read_laser()
 {
-    static std::random_device rd;
-    static std::mt19937 mt(rd());
-    static std::normal_distribution<double> normal_dist(0.0, constants.lidar_noise_sigma);
     RoboCompLaser::TLaserData ldata;
     try
     {
         ldata = laser_proxy->getLaserData();
 
-        // add radial noise la ldata
-        if(noise)
-            for(auto &l : ldata)
-                l.dist += normal_dist(mt);
-
-        // get n random angles to apply hard noise on them
-        static std::uniform_int_distribution<int> unif_dist(0, ldata.size());
-        static std::uniform_int_distribution<int> accept_dist(0, 10);
-        static auto generator = std::bind(unif_dist, mt);
-        std::vector<int> samples(constants.num_lidar_affected_rays_by_hard_noise, unif_dist(mt));
-        std::generate_n(samples.begin(), constants.num_lidar_affected_rays_by_hard_noise, generator);
-        for(auto &s: samples)
-            if(accept_dist(mt) < 3)
-                ldata[s].dist /= 3;
-
-        draw_laser( ldata );
+        // radial and hard noise, as set in the config
+        laser_noise.apply(ldata);
+
+        // cartesian points shared by the map, the mpc and the drawing
+        laser_frame.update(ldata);
     }
     catch(const Ice::Exception &e){ std::cout << e.what() << std::endl;}
     return ldata;
@@ -461,8 +487,6 @@ SpecificWorker::Pose2D SpecificWorker::read_robot()
         bState = fullposeestimation_proxy->getFullPoseEuler();
         rp = {.ang=bState.rz, .pos=Eigen::Vector2f(bState.x, bState.y)};
         //qInfo()  << bState.x << bState.y << bState.rz;
-        robot_polygon->setRotation(bState.rz*180/M_PI);
-        robot_polygon->setPos(bState.x, bState.y);
     }
     catch(const Ice::Exception &e){ std::cout << e.what() << std::endl;}
     return rp;
@@ -559,120 +583,86 @@ Eigen::Matrix3f SpecificWorker::from_grid_to_robot_matrix()
 /////////////////////////////////////////////////////////////////////////
 void SpecificWorker::draw_path(const std::vector<Eigen::Vector2f> &path_in_robot)
 {
-    static std::vector<QGraphicsItem *> path_paint;
-    static QString path_color = "Green";
-
-    for(auto p : path_paint)
-        viewer->scene.removeItem(p);
-    path_paint.clear();
-
-    uint s = 100;
-    for(auto &&p : path_in_robot)
+    std::vector<QPointF> points(path_in_robot.size());
+    for(auto &&[i, p] : iter::enumerate(path_in_robot))
     {
         auto pw = from_robot_to_world(p);  // in mm
-        path_paint.push_back(viewer->scene.addEllipse(pw.x()-s/2, pw.y()-s/2, s , s, QPen(path_color), QBrush(QColor(path_color))));
-        path_paint.back()->setZValue(30);
+        points[i] = QPointF(pw.x(), pw.y());
     }
+    path_layer.one(&viewer->scene)->set_points(points);
 }
-void SpecificWorker::draw_path_smooth(const std::vector<Eigen::Vector2f> &path_in_robot)
+void SpecificWorker::draw_path_smooth(const std::vector<QPointF> &path)
 {
-    static std::vector<QGraphicsItem *> path_paint;
-    static QString path_color = "Blue";
-
-    for(auto p : path_paint)
-        viewer->scene.removeItem(p);
-    path_paint.clear();
-
-    uint s = 100;
-    for(auto &&p : path_in_robot)
-    {
-        auto pw = from_robot_to_world(p);  // in mm
-        path_paint.push_back(viewer->scene.addEllipse(pw.x()-s/2, pw.y()-s/2, s , s, QPen(path_color), QBrush(QColor(path_color))));
-        path_paint.back()->setZValue(30);
-    }
+    smooth_path_layer.one(&viewer->scene)->set_points(path);
 }
-void SpecificWorker::draw_laser(const RoboCompLaser::TLaserData &ldata) // robot coordinates
+void SpecificWorker::draw_laser(const QPolygonF &poly_robot) // robot coordinates
 {
-    static QGraphicsItem *laser_polygon = nullptr;
-    if (laser_polygon != nullptr)
-        viewer->scene.removeItem(laser_polygon);
-
-    QPolygonF poly;
+    QPolygonF poly = poly_robot;
     poly << QPointF(0,0);
-    for(auto &&l : ldata)
-        poly << QPointF(l.dist*sin(l.angle), l.dist*cos(l.angle));
-    poly.pop_back();
-
-    QColor color("LightGreen");
-    color.setAlpha(40);
-    laser_polygon = viewer->scene.addPolygon(laser_in_robot_polygon->mapToScene(poly), QPen(QColor("DarkGreen"), 30), QBrush(color));
-    laser_polygon->setZValue(30);
+    laser_layer.one(&viewer->scene)->setPolygon(laser_in_robot_polygon->mapToScene(poly));
 }
-void SpecificWorker::draw_timeseries(float dist, float adv, float rot)
+void SpecificWorker::draw_timeseries(long cycle, float dist, float adv, float rot)
 {
-    static int cont=0;
-
-    distance_to_target_graph->addData(cont, dist);
-    advance_speed_graph->addData(cont, adv);
-    rotation_speed_graph->addData(cont, rot*300);  // visual scale
-    cont++;
+    // one sample per drawn frame, keyed by the control cycle it comes from
+    distance_to_target_graph->addData(cycle, dist);
+    advance_speed_graph->addData(cycle, adv);
+    rotation_speed_graph->addData(cycle, rot*300);  // visual scale
     // make key axis range scroll with the data (at a constant range size of 8):
-    custom_plot.xAxis->setRange(cont, 200, Qt::AlignRight);
+    custom_plot.xAxis->setRange(cycle, 200, Qt::AlignRight);
     custom_plot.replot();
 }
-void SpecificWorker::draw_solution_path(const std::vector<double> &path, const mpc::MPC::Balls &balls)
-{
-    static std::vector<QGraphicsItem *> path_paint, ball_paint, ball_grads, ball_centers;
-    static QString path_color = "Magenta";
-    static QString ball_color = "LightBlue";
-
-    for(auto p : path_paint)
-        viewer->scene.removeItem(p);
-    path_paint.clear();
-    for(auto p : ball_paint)
-        viewer->scene.removeItem(p);
-    ball_paint.clear();
-    for(auto p : ball_grads)
-        viewer->scene.removeItem(p);
-    ball_grads.clear();
-    for(auto p : ball_centers)
-        viewer->scene.removeItem(p);
-    ball_centers.clear();
-
-    uint s = 100;
-    std::vector<Eigen::Vector2f> qpath(path.size()/2);
-    std::vector<Eigen::Vector2f> path_centers;
-    for(auto &&[i, p] : iter::chunked(path, 2) | iter::enumerate)
+void SpecificWorker::fill_solution_path(const std::vector<double> &path, const mpc::MPC::Balls &balls, Frame &frame)
+{
+    frame.solution_path.clear();
+    for(auto &&p : iter::chunked(path, 2))
     {
         auto pw = from_robot_to_world(Eigen::Vector2f(p[0]*1000, p[1]*1000));  // in mm
-        path_centers.push_back(pw);
-        path_paint.push_back(viewer->scene.addEllipse(pw.x()-s/2, pw.y()-s/2, s , s, QPen(path_color), QBrush(QColor(path_color))));
-        path_paint.back()->setZValue(30);
+        frame.solution_path.emplace_back(pw.x(), pw.y());
     }
-    uint i=0;
-    auto balls_temp = balls;
-    balls_temp.erase(balls_temp.begin());
-    for(auto &[center, r, grad] : balls_temp)
+
+    // balls but the first one, and a line from each path point to its ball
+    frame.ball_centers.clear(); frame.ball_radii.clear(); frame.grads.clear();
+    for(std::size_t k = 1; k < balls.size(); k++)
     {
+        auto &[center, r, grad] = balls[k];
         auto bc = from_robot_to_world(center.cast<float>()*1000);
-        auto nr = r*1000;
-        // std::cout<<"###############"<<nr<<std::endl;
-        ball_paint.push_back(viewer->scene.addEllipse(bc.x()-nr, bc.y()-nr, nr*2 , nr*2, QPen(QBrush("DarkBlue"),15), QBrush(QColor(ball_color))));
-        ball_paint.back()->setZValue(15);
-        ball_paint.back()->setOpacity(0.2);
-
-        // grads
-        if(i < path_centers.size())
-        {
-            ball_grads.push_back(viewer->scene.addLine(path_centers[i].x(), path_centers[i].y(), bc.x(), bc.y(), QPen(QBrush("Magenta"), 20)));
-            i++;
-        }
-
-        // centers
-        //ball_centers.push_back(viewer_robot->scene.addEllipse(bc.x()-20, bc.y()-20, 40, 40, QPen(QColor("Magenta")), QBrush(QColor("Magenta"))));
-        //ball_centers.back()->setZValue(30);
+        frame.ball_centers.emplace_back(bc.x(), bc.y());
+        frame.ball_radii.push_back(r*1000);
+        if(k-1 < frame.solution_path.size())
+            frame.grads.emplace_back(frame.solution_path[k-1], frame.ball_centers.back());
+    }
+}
+void SpecificWorker::draw_solution_path(const std::vector<QPointF> &path, const std::vector<QPointF> &centers,
+                                        const std::vector<qreal> &radii, const std::vector<QLineF> &grads)
+{
+    solution_layer.one(&viewer->scene)->set_points(path);
+    balls_layer.one(&viewer->scene)->set_circles(centers, radii);
+    grads_layer.one(&viewer->scene)->set_lines(grads);
+}
+void SpecificWorker::render()
+{
+    // nothing new since the last one
+    if(not frames.fetch())
+        return;
+    const auto &f = frames.front();
+    robot_polygon->setRotation(f.pose.ang*180/M_PI);
+    robot_polygon->setPos(f.pose.pos.x(), f.pose.pos.y());
+    draw_laser(f.laser);
+    draw_path_smooth(f.smooth_path);
+    draw_solution_path(f.solution_path, f.ball_centers, f.ball_radii, f.grads);
+    horizon_layer.one(&viewer->scene)->set_points(f.horizon);
+    if(f.follower_target.has_value())
+    {
+        const auto &t = f.follower_target.value();
+        follower_target_layer.one(&viewer->scene)->setRect(t.x()-100, t.y()-100, 200, 200);
+    }
+    else
+        follower_target_layer.hide(&viewer->scene);
+    if(f.timeseries.has_value())
+    {
+        const auto &[dist, adv, rot] = f.timeseries.value();
+        draw_timeseries(f.cycle, dist, adv, rot);
     }
-
 }
 void SpecificWorker::new_target_slot(QPointF t)
 {
@@ -692,14 +682,12 @@ void SpecificWorker::new_target_slot(QPointF t)
     qInfo() << __FUNCTION__ << " Initial grid pos:" << grid_world_pose.pos.x() << grid_world_pose.pos.y() << grid_world_pose.ang;
 
 }
-void SpecificWorker::update_map(const RoboCompLaser::TLaserData &ldata)
+void SpecificWorker::update_map(LaserFrame &laser)
 {
     // transform laser data to grid coordinates
-    Eigen::Matrix3f r2g = from_robot_to_grid_matrix();
+    laser.set_transform(from_robot_to_grid_matrix());
     Eigen::Vector2f robot_in_grid = from_world_to_grid(Eigen::Vector2f(robot_pose.pos.x(), robot_pose.pos.y()));
-    std::vector<Eigen::Vector2f> points;
-    std::ranges::transform(ldata, std::back_inserter(points), [r2g](auto l) -> Eigen::Vector2f { return (r2g * Eigen::Vector3f(l.dist*sin(l.angle), l.dist*cos(l.angle), 1.f)).head(2);});
-    grid.update_map(points, robot_in_grid, constants.max_laser_range);
+    grid.update_map(laser.external_points(), robot_in_grid, constants.max_laser_range);
     grid.update_costs();
 }
 void SpecificWorker::move_robot(float adv, float rot, float side)
@@ -48,6 +48,10 @@
 #include "mpc.h"
 #include "carrot.h"
 #include "dynamic_window.h"
+#include <laser/laser_frame.h>
+#include <laser/noise.h>
+#include <graphics/scene_items.h>
+#include <graphics/triple_buffer.h>
 #include "qcustomplot/qcustomplot.h"
 #include <unordered_map>
 
@@ -149,6 +153,7 @@ class SpecificWorker : public GenericWorker
         int startup_check();
         void initialize(int period);
         void new_target_slot(QPointF);
+        void render();
 
     private:
         bool startup_check_flag;
@@ -158,6 +163,7 @@ class SpecificWorker : public GenericWorker
         struct Constants
         {
             uint num_steps_mpc = 8;
+            mpc::MPC::Solver mpc_solver = mpc::MPC::Solver::IPOPT;    // FATROP, banded Riccati, scales to N=30-50
             const float max_advance_speed = 1500;
             float tile_size = 100;
             const float max_laser_range = 4000;
@@ -210,7 +216,7 @@ class SpecificWorker : public GenericWorker
         Pose2D robot_pose;
         Pose2D read_robot();
         void goto_target_carrot(const std::vector<Eigen::Vector2f> &path_robot);
-        void goto_target_mpc(const std::vector<Eigen::Vector2d> &path_robot, const RoboCompLaser::TLaserData &ldata);
+        void goto_target_mpc(const std::vector<Eigen::Vector2d> &path_robot, const LaserFrame &laser);
         void move_robot(float adv, float rot, float side=0);
         float gaussian(float x);
 
@@ -218,11 +224,15 @@ class SpecificWorker : public GenericWorker
         QRectF dimensions;
         Grid grid;
         Pose2D grid_world_pose;
-        void update_map(const RoboCompLaser::TLaserData &ldata);
+        void update_map(LaserFrame &laser);
 
         // laser
-        RoboCompLaser::TLaserData read_laser(bool noise=false);
-        void draw_laser(const RoboCompLaser::TLaserData &ldata);
+        LaserFrame laser_frame;
+        LaserNoise laser_noise;
+        RoboCompLaser::TLaserData read_laser();
+        void draw_laser(const QPolygonF &poly_robot);
+        ItemPool<QGraphicsPolygonItem> laser_layer{30, [](auto p)
+            { QColor color("LightGreen"); color.setAlpha(40); p->setPen(QPen(QColor("DarkGreen"), 30)); p->setBrush(color); }};
 
         // camera
         void read_camera();
@@ -240,9 +250,12 @@ class SpecificWorker : public GenericWorker
             void set_new(bool v) {is_new_var = v;}
             void draw(QGraphicsScene &scene)
             {
-                if(draw_point != nullptr) scene.removeItem(draw_point);
-                draw_point = scene.addEllipse(pos.x()-100, pos.y()-100, 200, 200, QPen(QColor("Magenta")), QBrush(QColor("magenta")));
-                draw_point->setZValue(300);
+                if(draw_point == nullptr)
+                {
+                    draw_point = scene.addEllipse(0, 0, 200, 200, QPen(QColor("Magenta")), QBrush(QColor("magenta")));
+                    draw_point->setZValue(300);
+                }
+                draw_point->setRect(pos.x()-100, pos.y()-100, 200, 200);
             };
 
             private:
@@ -259,13 +272,23 @@ class SpecificWorker : public GenericWorker
 
         // path
         void draw_path(const std::vector<Eigen::Vector2f> &path_in_robot);
-        void draw_solution_path(const vector<double> &path,  const mpc::MPC::Balls &balls);
+        void draw_solution_path(const std::vector<QPointF> &path, const std::vector<QPointF> &centers,
+                                const std::vector<qreal> &radii, const std::vector<QLineF> &grads);
         double path_length(const std::vector<Eigen::Vector2f> &path);
         std::vector<Eigen::Vector2f> smooth_spline(const std::vector<Eigen::Vector2f> &path_grid);
         std::vector<Eigen::Vector2f> alternative_path(const std::vector<Eigen::Vector2f> &path_grid);
         std::vector<Eigen::Vector2f> convert_to_robot_coordinates(const std::vector<Eigen::Vector2f> &smoothed_path_grid, const std::vector<Eigen::Vector2f> &path_grid);
         std::vector<Eigen::Vector2f> remove_points_close_to_robot(const std::vector<Eigen::Vector2f> &path_grid);
-        void draw_path_smooth(const vector<Eigen::Vector2f> &path_in_robot);
+        void draw_path_smooth(const std::vector<QPointF> &path);
+        // drawing layers, updated in place every cycle
+        ItemPool<PointsItem> path_layer{30, [](auto p){ p->set_style(100, QPen(QColor("Green")), QBrush(QColor("Green"))); }};
+        ItemPool<PointsItem> smooth_path_layer{30, [](auto p){ p->set_style(100, QPen(QColor("Blue")), QBrush(QColor("Blue"))); }};
+        ItemPool<PointsItem> solution_layer{30, [](auto p){ p->set_style(100, QPen(QColor("Magenta")), QBrush(QColor("Magenta"))); }};
+        ItemPool<PointsItem> balls_layer{15, [](auto p)
+            { p->set_style(100, QPen(QBrush("DarkBlue"), 15), QBrush(QColor("LightBlue"))); p->setOpacity(0.2); }};
+        ItemPool<LinesItem> grads_layer{0, [](auto l){ l->set_pen(QPen(QBrush("Magenta"), 20)); }};
+        ItemPool<PointsItem> horizon_layer{30, [](auto p){ p->set_style(100, QPen(QColor("orange")), QBrush(QColor("orange"))); }};
+        ItemPool<QGraphicsRectItem> follower_target_layer{0, [](auto r){ r->setPen(QPen(QColor("Orange"))); r->setBrush(QColor("Orange")); }};
 
         // mpc
         mpc::MPC mpc;
@@ -295,7 +318,33 @@ class SpecificWorker : public GenericWorker
         // QCUSTOMPLOT
         QCustomPlot custom_plot;
         QCPGraph *distance_to_target_graph, *advance_speed_graph, *rotation_speed_graph;
-        void draw_timeseries(float dist, float adv, float rot);
+        void draw_timeseries(long cycle, float dist, float adv, float rot);
+
+        // viewer. compute() leaves what has to be drawn in a frame and render() draws the last one at its own rate
+        struct Frame
+        {
+            long cycle = 0;
+            Pose2D pose;
+            QPolygonF laser;                        // robot coordinates
+            std::vector<QPointF> smooth_path;       // world coordinates from here on
+            std::vector<QPointF> solution_path;
+            std::vector<QPointF> ball_centers;
+            std::vector<qreal> ball_radii;
+            std::vector<QLineF> grads;
+            std::vector<QPointF> horizon;                       // MPC predicted states
+            std::optional<QPointF> follower_target;             // point of the path DWA or carrot head to
+            std::optional<std::array<float, 3>> timeseries;     // distance to target, advance and rotation
+            void clear()
+            {
+                smooth_path.clear(); solution_path.clear(); ball_centers.clear(); ball_radii.clear(); grads.clear();
+                horizon.clear(); follower_target.reset(); timeseries.reset();
+            };
+        };
+        TripleBuffer<Frame> frames;
+        long cycles = 0;
+        int render_fps = 25;                        // 0 for headless, nothing is drawn
+        QTimer render_timer;
+        void fill_solution_path(const std::vector<double> &path, const mpc::MPC::Balls &balls, Frame &frame);
 
 };
 